@@ -0,0 +1,159 @@
+// Command recording throughput as worker threads are added to a command_recorder. Runs on any driver, without a GPU
+// point VK_ICD_FILENAMES at a software one such as lavapipe. Nothing is submitted, only recording is timed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "headless_device.h"
+
+using namespace rhi::vk;
+
+namespace
+{
+    constexpr uint32_t jobs_per_frame { 256 };
+    constexpr uint32_t draws_per_job { 128 };
+    constexpr uint32_t warmup_frames { 5 };
+    constexpr uint32_t timed_frames { 50 };
+
+    /// A stand-in for a draw: the state commands a real draw would set, plus a barrier so the driver has work per call
+    void record_job(const VkCommandBuffer command_buffer, const uint32_t job)
+    {
+        const VkMemoryBarrier barrier {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        };
+
+        for (uint32_t draw = 0; draw < draws_per_job; ++draw)
+        {
+            const auto offset = static_cast<float>((job * draws_per_job + draw) % 1024);
+            const VkViewport viewport { offset, offset, 256.0f, 256.0f, 0.0f, 1.0f };
+            const VkRect2D scissor { { static_cast<int32_t>(offset), static_cast<int32_t>(offset) }, { 256, 256 } };
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+    }
+
+    struct frame_timing
+    {
+        double milliseconds { 0.0 };
+        bool ok { true };
+    };
+
+    /// Average time to record one frame. Without workers every job goes straight into the primary on this thread
+    [[nodiscard]] frame_timing time_frames(command_recorder& recorder, const std::vector<command_recorder::record_function>& jobs, const bool parallel)
+    {
+        const VkCommandBufferInheritanceInfo inheritance {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = nullptr,
+            .renderPass = VK_NULL_HANDLE,
+            .subpass = 0,
+            .framebuffer = VK_NULL_HANDLE,
+            .occlusionQueryEnable = VK_FALSE,
+            .queryFlags = 0,
+            .pipelineStatistics = 0,
+        };
+
+        frame_timing timing {};
+        std::chrono::steady_clock::duration total { 0 };
+        for (uint32_t frame = 0; frame < warmup_frames + timed_frames && timing.ok; ++frame)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            timing.ok = recorder.begin_frame(frame) == VK_SUCCESS;
+            auto primary_exp = recorder.begin_primary();
+            timing.ok = timing.ok && primary_exp.has_value();
+            if (!timing.ok)
+            {
+                break;
+            }
+
+            const VkCommandBuffer primary = primary_exp.unwrap();
+            if (parallel)
+            {
+                timing.ok = recorder.record_parallel(primary, inheritance, 0, jobs) == VK_SUCCESS;
+            }
+            else
+            {
+                for (uint32_t job = 0; job < jobs.size(); ++job)
+                {
+                    jobs[job](primary, job);
+                }
+            }
+            timing.ok = timing.ok && vkEndCommandBuffer(primary) == VK_SUCCESS;
+
+            if (frame >= warmup_frames)
+            {
+                total += std::chrono::steady_clock::now() - start;
+            }
+        }
+
+        timing.milliseconds = std::chrono::duration<double, std::milli>(total).count() / timed_frames;
+        return timing;
+    }
+}
+
+int main()
+{
+    auto context = rhi::tests::create_headless_device();
+    if (!context)
+    {
+        return EXIT_FAILURE;
+    }
+
+    device& dev = context->device;
+    const std::vector<command_recorder::record_function> jobs(jobs_per_frame, record_job);
+    const double commands_per_frame = static_cast<double>(jobs_per_frame) * draws_per_job * 3;
+
+    // The calling thread records alongside the workers, so n workers record on n + 1 threads. 0 workers is the
+    // baseline: the same jobs recorded inline into the primary, without secondaries
+    const uint32_t hardware_threads = std::max(std::thread::hardware_concurrency(), 2u);
+    std::vector<uint32_t> worker_counts { 0 };
+    for (uint32_t workers = 1; workers < hardware_threads - 1; workers *= 2)
+    {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(hardware_threads - 1);
+
+    std::printf("%u jobs of %u draws per frame, %u frames on %.*s\n", jobs_per_frame, draws_per_job, timed_frames,
+        static_cast<int>(dev.get_physical_device().name().size()), dev.get_physical_device().name().data());
+    std::printf("%8s %12s %16s %9s\n", "threads", "ms/frame", "Mcommands/s", "speedup");
+
+    double baseline { 0.0 };
+    bool ok { true };
+    for (const uint32_t workers : worker_counts)
+    {
+        auto recorder_exp = command_recorder::create(dev.get(), dev.graphics_family_index(), std::make_shared<rhi::thread_pool>(std::max(workers, 1u)), {});
+        if (!recorder_exp.has_value())
+        {
+            std::fprintf(stderr, "Failed to create a command recorder\n");
+            ok = false;
+            break;
+        }
+
+        auto recorder = std::move(recorder_exp).unwrap();
+        const frame_timing timing = time_frames(*recorder, jobs, workers > 0);
+        recorder->destroy();
+
+        if (!timing.ok)
+        {
+            std::fprintf(stderr, "Recording failed with %u workers\n", workers);
+            ok = false;
+            break;
+        }
+
+        baseline = workers == 0 ? timing.milliseconds : baseline;
+        std::printf("%8u %12.3f %16.1f %8.2fx%s\n", workers + 1, timing.milliseconds, commands_per_frame / timing.milliseconds / 1000.0,
+            baseline / timing.milliseconds, workers == 0 ? " (inline)" : "");
+    }
+
+    context->instance.destroy();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,71 @@
+// Cost of a log call by how far it gets: rejected by the runtime level check, or formatted and written
+// to a stream that discards everything. Build with optimizations, e.g. CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "core/log.h"
+#include "null_stream.h"
+
+namespace
+{
+    template <typename Function>
+    [[nodiscard]] double nanoseconds_per_call(const uint64_t iterations, Function&& function)
+    {
+        // Warm up caches and the branch predictor before the timed run
+        for (uint64_t i = 0; i < iterations / 10; ++i)
+        {
+            function(i);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            function(i);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    }
+}
+
+int main()
+{
+    rhi::benchmarks::null_stream discard {};
+
+    const std::string name { "swapchain" };
+
+    // print_debug is off by default, so debug calls stop at the runtime check
+    rhi::log::log_initializer {}.set_out(discard).set_err(discard).init();
+
+    const double disabled_debug = nanoseconds_per_call(500'000'000, [&name](const uint64_t i)
+    {
+        rhi::log::debug("Recreated {} with {} images", name, i);
+    });
+
+    // Same check, reached through runtime_level() instead of print_debug
+    rhi::log::log_initializer {}.set_out(discard).set_err(discard).runtime_level(rhi::log::level::WARN).init();
+
+    const double filtered_info = nanoseconds_per_call(500'000'000, [&name](const uint64_t i)
+    {
+        rhi::log::info("Recreated {} with {} images", name, i);
+    });
+
+    // Enabled: format on the stack, tag with the timestamp and thread id, write under the lock
+    rhi::log::log_initializer {}.set_out(discard).set_err(discard).init();
+
+    const double written_info = nanoseconds_per_call(2'000'000, [&name](const uint64_t i)
+    {
+        rhi::log::info("Recreated {} with {} images", name, i);
+    });
+
+    std::printf("%-40s %10.3f ns/call\n", "debug, disabled by print_debug", disabled_debug);
+    std::printf("%-40s %10.3f ns/call\n", "info, filtered by runtime_level", filtered_info);
+    std::printf("%-40s %10.3f ns/call\n", "info, formatted and written", written_info);
+
+    // Let go of the stream before it goes out of scope
+    rhi::log::log_initializer {}.init();
+    return 0;
+}
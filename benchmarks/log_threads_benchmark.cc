@@ -0,0 +1,92 @@
+// Logging throughput from 1 to 32 threads. The synchronous path writes every record under one mutex, the
+// asynchronous one only formats on the caller and hands the record to the log thread. Build with optimizations.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "core/log.h"
+#include "null_stream.h"
+
+namespace
+{
+    constexpr uint32_t messages_per_thread { 100'000 };
+
+    struct run_result
+    {
+        double milliseconds { 0.0 };
+        double nanoseconds_per_call { 0.0 };
+    };
+
+    /// Wall time until every record of every thread was written, and the mean time a call blocked its thread
+    [[nodiscard]] run_result run(const uint32_t thread_count)
+    {
+        std::vector<std::thread> threads {};
+        std::vector<std::chrono::steady_clock::duration> call_time(thread_count);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([t, &call_time]()
+            {
+                const auto thread_start = std::chrono::steady_clock::now();
+                for (uint32_t i = 0; i < messages_per_thread; ++i)
+                {
+                    rhi::log::info("Thread {} submitted frame {} with {} draws", t, i, i % 4096);
+                }
+                call_time[t] = std::chrono::steady_clock::now() - thread_start;
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        rhi::log::flush();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::chrono::steady_clock::duration total_call_time { 0 };
+        for (const auto& duration : call_time)
+        {
+            total_call_time += duration;
+        }
+
+        return {
+            .milliseconds = std::chrono::duration<double, std::milli>(elapsed).count(),
+            .nanoseconds_per_call = std::chrono::duration<double, std::nano>(total_call_time).count() / (static_cast<double>(thread_count) * messages_per_thread),
+        };
+    }
+}
+
+int main()
+{
+    rhi::benchmarks::null_stream discard {};
+
+    struct mode
+    {
+        const char* name;
+        bool async;
+    };
+
+    std::printf("%u messages per thread, written to a discarding stream\n", messages_per_thread);
+    std::printf("%-6s %8s %12s %14s %12s\n", "mode", "threads", "ms", "Mmessages/s", "ns/call");
+
+    for (const mode current : { mode { "sync", false }, mode { "async", true } })
+    {
+        // BLOCK so every record is written and the runs stay comparable. DROP would trade records for latency
+        rhi::log::log_initializer {}.set_out(discard).set_err(discard).async(current.async, 1u << 16, rhi::log::overflow_policy::BLOCK).init();
+
+        for (const uint32_t thread_count : { 1u, 2u, 4u, 8u, 16u, 32u })
+        {
+            const run_result result = run(thread_count);
+            std::printf("%-6s %8u %12.2f %14.2f %12.1f\n", current.name, thread_count, result.milliseconds,
+                static_cast<double>(thread_count) * messages_per_thread / result.milliseconds / 1000.0, result.nanoseconds_per_call);
+        }
+    }
+
+    // Stop the log thread and let go of the stream before it goes out of scope
+    rhi::log::log_initializer {}.init();
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef RHI_BENCHMARKS_NULL_STREAM_H
+#define RHI_BENCHMARKS_NULL_STREAM_H
+
+#include <ostream>
+#include <streambuf>
+
+namespace rhi::benchmarks
+{
+    /// Accepts every character and keeps none, so the numbers measure the logger and not the terminal
+    class null_buffer final : public std::streambuf
+    {
+    protected:
+        int_type overflow(const int_type c) override { return c; }
+        std::streamsize xsputn(const char*, const std::streamsize count) override { return count; }
+    };
+
+    class null_stream final : public std::ostream
+    {
+    public:
+        null_stream() : std::ostream { &_buffer } {}
+
+    private:
+        null_buffer _buffer {};
+    };
+} // namespace rhi::benchmarks
+
+#endif //RHI_BENCHMARKS_NULL_STREAM_H
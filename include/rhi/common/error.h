@@ -5,22 +5,120 @@
 #ifndef RHI_ERROR_H
 #define RHI_ERROR_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string_view>
+
 namespace rhi
 {
+    /// Failure of an rhi call. Trivially copyable and never allocates: the message is a static string chosen by
+    /// id, the backend result is kept as a number and details such as a missing extension's name are copied
+    /// into a small inline buffer, cut short if they do not fit
     struct error
     {
-        enum class code
+        /// What failed, for callers that react to errors
+        enum class code : uint16_t
         {
-            INSTANCE_FAIL
+            INSTANCE_FAIL,
+            SURFACE_FAIL,
+            DEBUG_MESSENGER_FAIL,
+            PHYSICAL_DEVICE_FAIL,
+            DEVICE_FAIL,
+            SWAPCHAIN_FAIL,
         } code;
 
-        const char* message { "[UNKNOWN RHI ERROR]" };
+        /// Why it failed, selects the static message
+        enum class message_id : uint16_t
+        {
+            UNKNOWN,
+            MISSING_VALIDATION_LAYER,
+            MISSING_INSTANCE_EXTENSION,
+            CREATE_INSTANCE_FAILED,
+            WINDOW_DATA_MISMATCH,
+            UNSUPPORTED_WINDOW_PLATFORM,
+            CREATE_SURFACE_FAILED,
+            DEBUG_EXTENSION_MISSING,
+            CREATE_DEBUG_MESSENGER_FAILED,
+            NO_SUITABLE_DEVICE,
+            DEVICE_ID_NOT_FOUND,
+            SURFACE_CAPABILITIES_FAILED,
+            BINDLESS_UNSUPPORTED,
+            CREATE_DEVICE_FAILED,
+            TRANSIENT_ALLOCATOR_FAILED,
+            COMMAND_RECORDER_FAILED,
+            DESCRIPTOR_ALLOCATOR_FAILED,
+            PIPELINE_CACHE_FAILED,
+            BINDLESS_HEAP_FAILED,
+            UPLOAD_MANAGER_FAILED,
+            NO_PRESENT_SURFACE,
+            CREATE_SWAPCHAIN_FAILED,
+            GPU_PROFILER_FAILED,
+        } id { message_id::UNKNOWN };
+
+        /// Backend result code (a VkResult on Vulkan), 0 when the failure did not come from a backend call
+        int32_t result { 0 };
 
-        [[nodiscard]] explicit error(enum code code, const char* message) noexcept
+        static constexpr size_t CONTEXT_CAPACITY = 55;
+
+        [[nodiscard]] constexpr explicit error(const enum code code, const message_id id, const int32_t result = 0) noexcept
             : code { code }
-            , message { message }
+            , id { id }
+            , result { result }
         {}
+
+        /// @brief The static text of the message id
+        [[nodiscard]] std::string_view message() const noexcept;
+
+        /// @brief Details added with with_context(), empty if there are none
+        [[nodiscard]] std::string_view context() const noexcept { return { _context, _context_size }; }
+
+        /// @brief A copy carrying the text as context
+        [[nodiscard]] constexpr error with_context(const std::string_view text) const noexcept
+        {
+            error copy { *this };
+            copy._context_size = static_cast<uint8_t>(std::min(text.size(), CONTEXT_CAPACITY));
+            std::copy_n(text.data(), copy._context_size, copy._context);
+            return copy;
+        }
+
+        /// @brief A copy carrying the formatted text as context, formatted straight into the inline buffer
+        template <typename... Args>
+        [[nodiscard]] error with_context(const std::format_string<Args...> fmt, Args&&... args) const noexcept
+        {
+            error copy { *this };
+            const auto result = std::format_to_n(copy._context, CONTEXT_CAPACITY, fmt, std::forward<Args>(args)...);
+            copy._context_size = static_cast<uint8_t>(std::min<size_t>(result.size, CONTEXT_CAPACITY));
+            return copy;
+        }
+
+    private:
+        uint8_t _context_size { 0 };
+        char _context[CONTEXT_CAPACITY] {};
     };
 } // namespace rhi
 
-#endif //RHI_ERROR_H
\ No newline at end of file
+/// Formats as "message: context (result N)", leaving out the parts that are not set
+template <>
+struct std::formatter<rhi::error> : std::formatter<std::string_view>
+{
+    template <typename FormatContext>
+    auto format(const rhi::error& error, FormatContext& ctx) const
+    {
+        auto out = std::formatter<std::string_view>::format(error.message(), ctx);
+        if (!error.context().empty())
+        {
+            out = std::format_to(out, ": {}", error.context());
+        }
+
+        if (error.result != 0)
+        {
+            out = std::format_to(out, " (result {})", error.result);
+        }
+
+        return out;
+    }
+};
+
+#endif //RHI_ERROR_H
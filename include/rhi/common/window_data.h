@@ -5,33 +5,43 @@
 #ifndef RHI_WINDOW_DATA_H
 #define RHI_WINDOW_DATA_H
 
+#include <variant>
+
 #include "core/defines.h"
 #include "core/win32.h"
 
+#if defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
+#include <X11/Xlib.h>
+#endif
+
 namespace rhi
 {
 #ifdef RHI_PLATFORM_WINDOWS
     struct window_data_win32
     {
-        HWND hwnd;
+        HWND hwnd { nullptr };
     };
 
-#elif defined(RHI_PLATFORM_LINUX)
+#elif defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
+    /// Xlib connection and window, e.g. from XOpenDisplay and XCreateWindow. Works under Xvfb as well
     struct window_data_x11
     {
+        Display* display { nullptr };
+        Window window { 0 };
     };
 #endif
 
-
+    /// Native window of the current platform. Platforms without surface support, and Linux without RHI_WITH_XLIB, only have std::monostate
     using window_data = std::variant<
 #ifdef RHI_PLATFORM_WINDOWS
         window_data_win32
-#if defined(RHI_PLATFORM_LINUX)
+#elif defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
         window_data_x11
+#else
+        std::monostate
 #endif
     >;
 
 } // rhi namespace
 
-#endif
-#endif
\ No newline at end of file
+#endif //RHI_WINDOW_DATA_H
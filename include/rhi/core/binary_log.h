@@ -0,0 +1,181 @@
+#ifndef RHI_BINARY_LOG_H
+#define RHI_BINARY_LOG_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// Layout of binary log files, shared by the writer in the library and the decoder in tools/log_decoder.
+/// A file is a file_header followed by records. Every record starts with a record_header; format records
+/// define a format string once, message records refer to it by id and carry the raw arguments.
+/// All values are in the byte order of the machine that wrote the file.
+namespace rhi::log::binary
+{
+    constexpr uint64_t FILE_MAGIC = 0x31474f4c49485252; // "RRHILOG1"
+    constexpr uint32_t FILE_VERSION = 1;
+
+    struct file_header
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t capacity;
+
+        /// End of the last reserved record, advanced atomically by the writers
+        uint64_t end;
+
+        /// Wall clock at creation in nanoseconds since the Unix epoch. Message timestamps count from here
+        uint64_t start_time;
+    };
+
+    enum class record_kind : uint8_t
+    {
+        FORMAT = 1,
+        MESSAGE = 2,
+    };
+
+    struct record_header
+    {
+        /// Size of the whole record including this header
+        uint32_t size;
+        record_kind kind;
+        uint8_t level;
+        uint8_t argument_count;
+
+        /// Set last, a record left at 0 was interrupted mid-write and is skipped by the decoder
+        uint8_t committed;
+    };
+
+    /// Followed by `length` characters
+    struct format_record
+    {
+        uint32_t id;
+        uint32_t length;
+    };
+
+    /// Followed by argument_count arguments, each an argument_type byte and its value
+    struct message_record
+    {
+        uint32_t format_id;
+
+        /// rhi::log::thread_id() of the logging thread
+        uint32_t thread_id;
+
+        /// Nanoseconds since file_header::start_time
+        uint64_t timestamp;
+    };
+
+    /// SIGNED and UNSIGNED are 8 bytes, FLOATING a double, BOOLEAN and CHARACTER one byte,
+    /// POINTER 8 bytes and STRING a uint32_t length followed by the characters
+    enum class argument_type : uint8_t
+    {
+        SIGNED,
+        UNSIGNED,
+        FLOATING,
+        BOOLEAN,
+        CHARACTER,
+        STRING,
+        POINTER,
+    };
+
+    /// Serializes arguments into a caller provided buffer. Strings that do not fit are cut short, arguments
+    /// after a full buffer are left out and the decoder shows them as missing
+    class argument_encoder
+    {
+    public:
+        [[nodiscard]] argument_encoder(std::byte* buffer, const size_t size) noexcept
+            : _begin { buffer }
+            , _next { buffer }
+            , _end { buffer + size }
+        {}
+
+        template <typename T>
+        void add(const T& value) noexcept
+        {
+            if constexpr (std::same_as<T, bool>)
+            {
+                _add_value(argument_type::BOOLEAN, static_cast<uint8_t>(value));
+            }
+            else if constexpr (std::same_as<T, char>)
+            {
+                _add_value(argument_type::CHARACTER, value);
+            }
+            else if constexpr (std::signed_integral<T>)
+            {
+                _add_value(argument_type::SIGNED, static_cast<int64_t>(value));
+            }
+            else if constexpr (std::unsigned_integral<T>)
+            {
+                _add_value(argument_type::UNSIGNED, static_cast<uint64_t>(value));
+            }
+            else if constexpr (std::floating_point<T>)
+            {
+                _add_value(argument_type::FLOATING, static_cast<double>(value));
+            }
+            else if constexpr (std::convertible_to<const T&, std::string_view>)
+            {
+                _add_string(value);
+            }
+            else if constexpr (std::is_pointer_v<T> || std::same_as<T, std::nullptr_t>)
+            {
+                _add_value(argument_type::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+            }
+            else
+            {
+                // Anything else is formatted now, like the text logger would
+                _add_string(std::vformat("{}", std::make_format_args(value)));
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return static_cast<size_t>(_next - _begin); }
+        [[nodiscard]] uint8_t count() const noexcept { return _count; }
+
+    private:
+        template <typename V>
+        void _add_value(const argument_type type, const V value) noexcept
+        {
+            if (static_cast<size_t>(_end - _next) < 1 + sizeof(V))
+            {
+                _next = _end;
+                return;
+            }
+
+            *_next++ = static_cast<std::byte>(type);
+            std::memcpy(_next, &value, sizeof(V));
+            _next += sizeof(V);
+            ++_count;
+        }
+
+        void _add_string(const std::string_view value) noexcept
+        {
+            const size_t available = static_cast<size_t>(_end - _next);
+            if (available < 1 + sizeof(uint32_t))
+            {
+                _next = _end;
+                return;
+            }
+
+            const auto length = static_cast<uint32_t>(std::min(value.size(), available - 1 - sizeof(uint32_t)));
+            *_next++ = static_cast<std::byte>(argument_type::STRING);
+            std::memcpy(_next, &length, sizeof(length));
+            _next += sizeof(length);
+            std::memcpy(_next, value.data(), length);
+            _next += length;
+            ++_count;
+        }
+
+    private:
+        std::byte* _begin { nullptr };
+        std::byte* _next { nullptr };
+        std::byte* _end { nullptr };
+        uint8_t _count { 0 };
+    };
+} // namespace rhi::log::binary
+
+#endif //RHI_BINARY_LOG_H
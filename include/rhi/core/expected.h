@@ -4,11 +4,12 @@
 
 #ifndef RHI_EXPECTED_H
 #define RHI_EXPECTED_H
+#include <concepts>
 #include <exception>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <utility>
-#include <variant>
-#include <string>
 
 namespace rhi
 {
@@ -25,327 +26,307 @@ namespace rhi
         constexpr explicit unexpected(E&& e) noexcept : _value{ std::move(e) } {}
 
         [[nodiscard]] constexpr const E& value() const & noexcept { return _value; }
-        [[nodiscard]] constexpr const E&& value() const && noexcept { return std::move(_value); }
-
-        template <typename T>
-        constexpr explicit operator expected<T, E>() const & noexcept
-        {
-            return expected<T, E>{ unexpected(_value) };
-        }
-
-        template <typename T>
-        constexpr explicit operator expected<T, E>() const && noexcept
-        {
-            return expected<T, E>{ unexpected(std::move(_value)) };
-        }
+        [[nodiscard]] constexpr E& value() & noexcept { return _value; }
+        [[nodiscard]] constexpr E&& value() && noexcept { return std::move(_value); }
 
     private:
         E _value;
     };
 
+    template <typename E>
+    unexpected(E) -> unexpected<E>;
+
+    /// Success value on its way into an expected. Pass locals with std::move, an lvalue is copied
     template <typename T>
     class ok
     {
     public:
-        constexpr ok(T& value)
-        requires std::is_copy_constructible_v<T>
-        : _value{ value } {}
-
-        constexpr ok(T& value)
-        requires (std::is_move_constructible_v<T> && !std::is_copy_constructible_v<T>)
-        : _value{ std::move(value) } {}
-
-        constexpr ok(const T& value)
-        requires std::is_copy_constructible_v<T>
-        : _value{ value } {}
-
-        constexpr ok(const T& value)
-        requires (std::is_move_constructible_v<T> && !std::is_copy_constructible_v<T>)
-        : _value{ std::move(value) } {}
-
+        constexpr ok(const T& value) requires std::copy_constructible<T> : _value{ value } {}
         constexpr ok(T&& value) : _value{ std::move(value) } {}
-        constexpr ok(const T&& value) : _value{ std::move(value) } {}
 
-        [[nodiscard]] constexpr
-        auto value() const & noexcept -> T const&
-        requires std::is_copy_constructible_v<T>
-        {
-            return _value;
-        }
+        [[nodiscard]] constexpr const T& value() const & noexcept { return _value; }
+        [[nodiscard]] constexpr T& value() & noexcept { return _value; }
+        [[nodiscard]] constexpr T&& value() && noexcept { return std::move(_value); }
 
-        [[nodiscard]] constexpr
-        auto value() & noexcept -> T&
-        requires std::is_copy_constructible_v<T>
-        {
-            return _value;
-        }
-
-        [[nodiscard]] constexpr
-        auto value() const & noexcept -> T const&
-        requires (std::is_move_constructible_v<T> && !std::is_copy_constructible_v<T>)
-        {
-            return _value;
-        }
-
-        [[nodiscard]] constexpr
-        auto value() & noexcept -> T&
-        requires (std::is_move_constructible_v<T> && !std::is_copy_constructible_v<T>)
-        {
-            return _value;
-        }
-
-        [[nodiscard]] constexpr
-        auto value() const && noexcept -> T const&&
-        {
-            return std::move(_value);
-        }
+    private:
+        T _value;
+    };
 
-        [[nodiscard]] constexpr T&& value() && noexcept
-        {
-            return std::move(_value);
-        }
+    template <typename T>
+    ok(T) -> ok<T>;
 
-        [[nodiscard]] constexpr ok& operator=(const ok& other) noexcept
-        {
-            _value = other._value;
-            return *this;
-        }
-        [[nodiscard]] constexpr ok& operator=(ok&& other) noexcept
-        {
-            _value = std::move(other._value);
-            return *this;
-        }
+    namespace detail
+    {
+        template <typename>
+        inline constexpr bool is_expected = false;
 
-        template <typename E>
-        constexpr explicit operator expected<T, E>() const & noexcept
-        {
-            return expected<T, E>( ok(_value) );
-        }
+        template <typename T, typename E>
+        inline constexpr bool is_expected<expected<T, E>> = true;
 
-        template <typename E>
-        constexpr explicit operator expected<T, E>() const && noexcept
-        {
-            return expected<T, E>( ok(std::move(_value)) );
-        }
+        // The trivial variants repeat the plain concepts so that they subsume them and win overload resolution
 
-        ~ok() = default;
+        template <typename T, typename E>
+        concept copyable_pair = std::copy_constructible<T> && std::copy_constructible<E>;
 
-    private:
-        T _value;
-    };
+        template <typename T, typename E>
+        concept trivially_copyable_pair = copyable_pair<T, E> && std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>;
 
+        template <typename T, typename E>
+        concept movable_pair = std::move_constructible<T> && std::move_constructible<E>;
 
-    template <typename T>
-    ok(T) -> ok<T>;
+        template <typename T, typename E>
+        concept trivially_movable_pair = movable_pair<T, E> && std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>;
+    }
 
+    /// Value or error without exceptions. The two share a union, so an expected of trivially copyable types
+    /// is itself trivially copyable and small ones are passed and returned in registers.
+    /// Accessors on an rvalue (std::move(exp).unwrap()) move the value out instead of copying it
     template <typename T, typename E>
     class expected
     {
     public:
-        constexpr expected() requires std::default_initializable<T> : _value {T()} {}
+        using value_type = T;
+        using error_type = E;
 
-        constexpr expected(ok<T>& value) : _value{ value.value() }, _is_ok{ true } {}
+        constexpr expected() noexcept(std::is_nothrow_default_constructible_v<T>) requires std::default_initializable<T>
+            : _value{}, _is_ok{ true } {}
 
-        constexpr expected(ok<T>&& value) : _value{ std::move(value.value()) }, _is_ok{ true } {}
+        constexpr expected(const ok<T>& value) : _value{ value.value() }, _is_ok{ true } {}
+        constexpr expected(ok<T>&& value) : _value{ std::move(value).value() }, _is_ok{ true } {}
 
-        [[nodiscard]] expected(unexpected<E> value) noexcept : _value{ value.value() }, _is_ok { false } {}
+        template <typename U>
+        requires (!std::same_as<U, T> && std::constructible_from<T, U&&>)
+        constexpr expected(ok<U>&& value) : _value{ std::move(value).value() }, _is_ok{ true } {}
 
-        template <typename U = T>
-        // requires std::same_as<U, T>
-        [[nodiscard]] explicit expected(ok<U> value) noexcept : _value{ value.value() }
-        {
-            static_assert(std::is_constructible_v<T, U>(), "Cannot construct instance  of expected<T> from non-convertible type");
-        }
+        constexpr expected(const unexpected<E>& error) : _error{ error.value() }, _is_ok{ false } {}
+        constexpr expected(unexpected<E>&& error) : _error{ std::move(error).value() }, _is_ok{ false } {}
 
-        template <typename U>
-        [[nodiscard]] explicit expected(unexpected<U> value) noexcept : _value{ value.value() }
+        template <typename G>
+        requires (!std::same_as<G, E> && std::constructible_from<E, G&&>)
+        constexpr expected(unexpected<G>&& error) : _error{ std::move(error).value() }, _is_ok{ false } {}
+
+        template <typename G>
+        requires (!std::same_as<G, E> && std::constructible_from<E, const G&>)
+        constexpr expected(const unexpected<G>& error) : _error{ error.value() }, _is_ok{ false } {}
+
+        // Special members are defaulted, and therefore trivial, when both alternatives are trivially copyable
+
+        constexpr expected(const expected&) requires detail::trivially_copyable_pair<T, E> = default;
+
+        constexpr expected(const expected& other) requires detail::copyable_pair<T, E>
+            : _is_ok{ other._is_ok }
         {
-            static_assert(std::is_constructible_v<T, U>(), "Cannot construct instance  of expected<T> from non-convertible type");
+            _construct_from(other);
         }
 
-        constexpr expected(const expected&)
-        requires (
-            std::copy_constructible<T> &&
-            std::copy_constructible<E> &&
-            std::is_trivially_copy_constructible_v<T> &&
-            std::is_trivially_copy_constructible_v<E>
-        ) = default;
-
-        constexpr expected(const expected& other)
-        requires (
-            std::copy_constructible<T> &&
-            std::copy_constructible<E>
-        ) : _is_ok{ other._is_ok }
+        constexpr expected(expected&&) requires detail::trivially_movable_pair<T, E> = default;
+
+        constexpr expected(expected&& other) noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>)
+        requires detail::movable_pair<T, E>
+            : _is_ok{ other._is_ok }
         {
-            std::construct_at(std::addressof(this->_value), other._value);
-            // _is_ok = other._is_ok;
-            // _value = other._value;
+            _construct_from(std::move(other));
         }
 
-        constexpr expected& operator=(const expected& other) noexcept
+        constexpr expected& operator=(const expected&) requires detail::trivially_copyable_pair<T, E> = default;
+
+        constexpr expected& operator=(const expected& other) requires detail::copyable_pair<T, E>
         {
-            if (*this != other)
+            if (this != &other)
             {
-                _is_ok = other._is_ok;
-                _value = other._value;
+                _assign_from(other);
             }
 
             return *this;
         }
 
-        constexpr expected(expected&& other) noexcept(
-            std::is_nothrow_move_constructible_v<T> &&
-            std::is_nothrow_move_constructible_v<E>
-        ) requires std::move_constructible<T> && std::move_constructible<E>
-            : _is_ok(other._is_ok)
-        {
-            if (_is_ok)
-            {
-                std::construct_at(std::addressof(this->_value), std::move(other._value));
-            }
-            // _value = std::move(other._value);
-        }
+        constexpr expected& operator=(expected&&) requires detail::trivially_movable_pair<T, E> = default;
 
-        constexpr expected(expected&&) noexcept(
-            std::is_nothrow_constructible_v<T> &&
-            std::is_nothrow_move_constructible_v<T>
-        ) requires (
-            std::move_constructible<T> &&
-            std::move_constructible<E> &&
-            std::is_trivially_move_constructible_v<T> &&
-            std::is_trivially_move_constructible_v<E>
-        ) = default;
-
-        constexpr expected& operator=(expected&& other) noexcept
+        constexpr expected& operator=(expected&& other) noexcept requires detail::movable_pair<T, E>
         {
-            if (*this != other)
+            if (this != &other)
             {
-                _is_ok = other._is_ok;
-                _value = std::move(other._value);
+                _assign_from(std::move(other));
             }
 
             return *this;
         }
 
-        std::string debug_print() const noexcept
-        {
-            std::string s { "" };
-            if (_is_ok)
-            {
-                s += "<OK>";
-            }
-            else
-            {
-                s += "<NOT_OK>";
-            }
+        constexpr ~expected() requires (std::is_trivially_destructible_v<T> && std::is_trivially_destructible_v<E>) = default;
 
-            return s;
+        constexpr ~expected()
+        {
+            _destroy();
         }
 
     public:
         [[nodiscard]] constexpr bool has_value() const noexcept { return _is_ok; }
+        [[nodiscard]] constexpr explicit operator bool() const noexcept { return _is_ok; }
 
+        [[nodiscard]] constexpr const T& unwrap() const & noexcept { _check(true); return _value; }
+        [[nodiscard]] constexpr T& unwrap() & noexcept { _check(true); return _value; }
+        [[nodiscard]] constexpr T&& unwrap() && noexcept { _check(true); return std::move(_value); }
 
-        constexpr auto
-        unwrap() const & noexcept -> T const&
-        requires std::is_copy_constructible_v<T>
+        template <typename U>
+        [[nodiscard]] constexpr T unwrap_or(U&& other) const & noexcept
         {
-            // static_assert(std::is_copy_constructible_v<T>, "T must be copyable");
-            if (_is_ok)
-            {
-                return std::get<T>(_value);
-            }
+            return _is_ok ? _value : static_cast<T>(std::forward<U>(other));
+        }
 
-            std::terminate();
+        template <typename U>
+        [[nodiscard]] constexpr T unwrap_or(U&& other) && noexcept
+        {
+            return _is_ok ? std::move(_value) : static_cast<T>(std::forward<U>(other));
         }
 
-        constexpr auto
-        unwrap() & noexcept -> T&
-        requires std::is_copy_constructible_v<T>
+        [[nodiscard]] constexpr const E& unwrap_error() const & noexcept { _check(false); return _error; }
+        [[nodiscard]] constexpr E& unwrap_error() & noexcept { _check(false); return _error; }
+        [[nodiscard]] constexpr E&& unwrap_error() && noexcept { _check(false); return std::move(_error); }
+
+        /// @brief f(value) -> expected<U, E>, called only on success. An error is passed through
+        template <typename F> constexpr auto and_then(F&& f) & { return _and_then(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto and_then(F&& f) const & { return _and_then(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto and_then(F&& f) && { return _and_then(std::move(*this), std::forward<F>(f)); }
+
+        /// @brief f(value) -> U, gives expected<U, E>. An error is passed through
+        template <typename F> constexpr auto transform(F&& f) & { return _transform(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto transform(F&& f) const & { return _transform(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto transform(F&& f) && { return _transform(std::move(*this), std::forward<F>(f)); }
+
+        /// @brief f(error) -> expected<T, G>, called only on failure to recover or replace the error
+        template <typename F> constexpr auto or_else(F&& f) & { return _or_else(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto or_else(F&& f) const & { return _or_else(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto or_else(F&& f) && { return _or_else(std::move(*this), std::forward<F>(f)); }
+
+        /// @brief f(error) -> G, gives expected<T, G>. A value is passed through
+        template <typename F> constexpr auto transform_error(F&& f) & { return _transform_error(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto transform_error(F&& f) const & { return _transform_error(*this, std::forward<F>(f)); }
+        template <typename F> constexpr auto transform_error(F&& f) && { return _transform_error(std::move(*this), std::forward<F>(f)); }
+
+    private:
+        template <typename Self>
+        static constexpr decltype(auto) _value_of(Self&& self) noexcept { return (std::forward<Self>(self)._value); }
+
+        template <typename Self>
+        static constexpr decltype(auto) _error_of(Self&& self) noexcept { return (std::forward<Self>(self)._error); }
+
+        template <typename Self, typename F>
+        static constexpr auto _and_then(Self&& self, F&& f)
         {
-            // static_assert(std::is_copy_constructible_v<T>, "T must be copyable");
-            if (_is_ok)
+            using result = std::remove_cvref_t<std::invoke_result_t<F, decltype(_value_of(std::forward<Self>(self)))>>;
+            static_assert(detail::is_expected<result>, "and_then needs a function returning an expected");
+            static_assert(std::same_as<typename result::error_type, E>, "and_then cannot change the error type, use transform_error");
+
+            if (self._is_ok)
             {
-                return std::get<T>(_value);
+                return std::invoke(std::forward<F>(f), _value_of(std::forward<Self>(self)));
             }
-
-            std::terminate();
+            return result { unexpected<E>(_error_of(std::forward<Self>(self))) };
         }
 
-        constexpr auto
-        unwrap() const & noexcept -> T const&&
-        requires (std::is_move_constructible_v<T> && std::is_move_assignable_v<T> && !std::is_copy_constructible_v<T>)
+        template <typename Self, typename F>
+        static constexpr auto _transform(Self&& self, F&& f)
         {
-            // static_assert(std::is_copy_constructible_v<T>, "T must be copyable");
-            if (_is_ok)
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(_value_of(std::forward<Self>(self)))>>;
+            using result = expected<U, E>;
+
+            if (self._is_ok)
             {
-                return std::move(std::get<T>(_value));
+                return result { ok<U>(std::invoke(std::forward<F>(f), _value_of(std::forward<Self>(self)))) };
             }
-
-            std::terminate();
+            return result { unexpected<E>(_error_of(std::forward<Self>(self))) };
         }
 
-        constexpr auto
-        unwrap() & noexcept -> T &&
-        requires (std::is_move_constructible_v<T> && std::is_move_assignable_v<T> && !std::is_copy_constructible_v<T>)
+        template <typename Self, typename F>
+        static constexpr auto _or_else(Self&& self, F&& f)
         {
-            // static_assert(std::is_copy_constructible_v<T>, "T must be copyable");
-            if (_is_ok)
+            using result = std::remove_cvref_t<std::invoke_result_t<F, decltype(_error_of(std::forward<Self>(self)))>>;
+            static_assert(detail::is_expected<result>, "or_else needs a function returning an expected");
+            static_assert(std::same_as<typename result::value_type, T>, "or_else cannot change the value type, use transform");
+
+            if (!self._is_ok)
             {
-                return std::move(std::get<T>(_value));
+                return std::invoke(std::forward<F>(f), _error_of(std::forward<Self>(self)));
             }
-
-            std::terminate();
+            return result { ok<T>(_value_of(std::forward<Self>(self))) };
         }
 
-        constexpr auto
-        unwrap() const && noexcept -> T const&&
+        template <typename Self, typename F>
+        static constexpr auto _transform_error(Self&& self, F&& f)
         {
-            if (_is_ok)
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(_error_of(std::forward<Self>(self)))>>;
+            using result = expected<T, G>;
+
+            if (!self._is_ok)
             {
-                return std::move(std::get<T>(_value));
+                return result { unexpected<G>(std::invoke(std::forward<F>(f), _error_of(std::forward<Self>(self)))) };
             }
-
-            std::terminate();
+            return result { ok<T>(_value_of(std::forward<Self>(self))) };
         }
 
-        constexpr auto
-        unwrap() && noexcept -> T &&
+        constexpr void _check(const bool value_expected) const noexcept
         {
-            if (_is_ok)
+            if (_is_ok != value_expected)
             {
-                return std::move(std::get<T>(_value));
+                std::terminate();
             }
-
-            std::terminate();
         }
 
-        [[nodiscard]] constexpr const T& unwrap_or(const T& other) const noexcept
+        template <typename Other>
+        constexpr void _construct_from(Other&& other)
         {
-            if (_is_ok)
+            if (other._is_ok)
             {
-                return std::get<T>(_value);
+                std::construct_at(std::addressof(_value), std::forward<Other>(other)._value);
             }
+            else
+            {
+                std::construct_at(std::addressof(_error), std::forward<Other>(other)._error);
+            }
+        }
 
-            return other;
+        template <typename Other>
+        constexpr void _assign_from(Other&& other)
+        {
+            if (_is_ok && other._is_ok)
+            {
+                _value = std::forward<Other>(other)._value;
+            }
+            else if (!_is_ok && !other._is_ok)
+            {
+                _error = std::forward<Other>(other)._error;
+            }
+            else
+            {
+                _destroy();
+                _is_ok = other._is_ok;
+                _construct_from(std::forward<Other>(other));
+            }
         }
 
-        [[nodiscard]] constexpr E unwrap_error() const noexcept
+        constexpr void _destroy() noexcept
         {
             if (_is_ok)
             {
-                std::terminate();
+                std::destroy_at(std::addressof(_value));
+            }
+            else
+            {
+                std::destroy_at(std::addressof(_error));
             }
-
-            return std::get<E>(_value);
         }
 
-        // TODO: support move-only types
+        template <typename, typename>
+        friend class expected;
 
     private:
-        std::variant<T, E> _value;
+        union
+        {
+            T _value;
+            E _error;
+        };
         bool _is_ok { false };
     };
 }
 
-#endif //RHI_EXPECTED_H
\ No newline at end of file
+#endif //RHI_EXPECTED_H
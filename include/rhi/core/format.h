@@ -10,7 +10,7 @@
 namespace rhi
 {
     template <typename... Args>
-    std::string format_str(const std::format_string<Args...> format_template, Args... args)
+    std::string format_str(const std::format_string<Args...> format_template, Args&&... args)
     {
         return std::vformat(format_template.get(), std::make_format_args(args...));
     }
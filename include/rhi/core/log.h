@@ -4,21 +4,74 @@
 
 #ifndef RHI_LOG_H
 #define RHI_LOG_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <format>
+#include <span>
+#include <string_view>
 #include <iosfwd>
 #include <iostream>
+#include "core/binary_log.h"
 #include "core/format.h"
 
 namespace rhi::log
 {
+    /// Severity of a record, lowest first. ERR because windows.h defines ERROR
+    enum class level : uint8_t
+    {
+        TRACE,
+        DEBUG,
+        INFO,
+        WARN,
+        ERR,
+        FATAL,
+    };
+
+    /// Calls for levels below RHI_LOG_MIN_LEVEL (a level value, 6 disables logging) compile to nothing
+    /// beyond evaluating their arguments
+#ifndef RHI_LOG_MIN_LEVEL
+#define RHI_LOG_MIN_LEVEL 0
+#endif
+    inline constexpr level min_level = static_cast<level>(RHI_LOG_MIN_LEVEL);
+
+    /// What the async logger does with a record when its queue is full
+    enum class overflow_policy
+    {
+        /// Discard the record and report how many were lost. Logging never stalls the caller
+        DROP,
+        /// Wait until the log thread makes room
+        BLOCK,
+    };
+
     struct log_initializer
     {
+        /// @brief Apply the settings. Call it before other threads start logging, an async logger set up earlier is flushed and stopped
         void init() const noexcept;
         [[nodiscard]] log_initializer& set_out(std::ostream& out) noexcept;
         [[nodiscard]] log_initializer& set_err(std::ostream& err) noexcept;
         [[nodiscard]] log_initializer& print_logs(bool should_print) noexcept;
         [[nodiscard]] log_initializer& print_debug(bool should_print_debug) noexcept;
 
+        /// @brief Start text records with the time since init() in seconds, to the microsecond
+        [[nodiscard]] log_initializer& print_timestamps(bool should_print_timestamps) noexcept;
+
+        /// @brief Start text records with the thread_id() of the logging thread. Binary records always carry it
+        [[nodiscard]] log_initializer& print_thread_ids(bool should_print_thread_ids) noexcept;
+
+        /// @brief Drop records below the level without formatting them. Levels removed by RHI_LOG_MIN_LEVEL stay removed
+        [[nodiscard]] log_initializer& runtime_level(level minimum) noexcept;
+
+        /// @brief Write records from a background thread instead of the logging one. Callers only format and queue the message.
+        /// Fatal records are never dropped and are written and flushed before the call returns
+        [[nodiscard]] log_initializer& async(bool enabled = true, size_t queue_capacity = 8192, overflow_policy = overflow_policy::DROP) noexcept;
+
+        /// @brief Write records to a memory mapped binary file instead of the streams. Arguments are stored unformatted,
+        /// tools/log_decoder turns the file back into text. An empty path switches back to text logging
+        [[nodiscard]] log_initializer& set_binary(const std::filesystem::path& path, size_t capacity = 64ull << 20) noexcept;
+
     private:
         struct
         {
@@ -26,50 +79,151 @@ namespace rhi::log
             std::ostream* err { &std::cerr };
             bool should_print { true };
             bool debug_print { false };
+            bool timestamps { true };
+            bool thread_ids { true };
+            level minimum { level::TRACE };
+            bool async { false };
+            size_t queue_capacity { 8192 };
+            overflow_policy overflow { overflow_policy::DROP };
+            std::filesystem::path binary_path {};
+            size_t binary_capacity { 64ull << 20 };
         } _detail;
     };
 
-    void info_impl(std::string_view) noexcept;
-    void trace_impl(std::string_view) noexcept;
-    void debug_impl(std::string_view) noexcept;
-    void warn_impl(std::string_view) noexcept;
-    void error_impl(std::string_view) noexcept;
-    void fatal_impl(std::string_view) noexcept;
+    namespace detail
+    {
+        /// Bit per level that init() enabled. Debug is off until print_debug() turns it on
+        inline std::atomic<uint32_t> g_enabled_levels { 0b111101 };
+
+        /// Set while a binary sink is installed
+        inline std::atomic<bool> g_binary_enabled { false };
+    }
+
+    /// @brief Whether records of the level are written. A single relaxed load, cheap enough to guard expensive log arguments
+    [[nodiscard]] inline bool enabled(const level record_level) noexcept
+    {
+        return (detail::g_enabled_levels.load(std::memory_order_relaxed) >> static_cast<uint32_t>(record_level)) & 1u;
+    }
+
+    /// @brief Block until every record logged so far has been written and the streams flushed
+    void flush() noexcept;
+
+    /// @brief Small id of the calling thread, handed out in the order threads first ask for one starting at 1
+    [[nodiscard]] uint32_t thread_id() noexcept;
+
+    /// @brief When init() last ran, the origin of the text timestamps. Lets other timelines such as GPU traces line up with the log
+    [[nodiscard]] std::chrono::steady_clock::time_point start_time() noexcept;
+
+    namespace detail
+    {
+        /// Output iterator filling a fixed buffer and counting what did not fit
+        struct bounded_writer
+        {
+            using difference_type = std::ptrdiff_t;
+
+            char* next { nullptr };
+            char* end { nullptr };
+            size_t count { 0 };
+
+            bounded_writer& operator=(const char c) noexcept
+            {
+                if (next != end)
+                {
+                    *next++ = c;
+                }
+                ++count;
+                return *this;
+            }
+
+            bounded_writer& operator*() noexcept { return *this; }
+            bounded_writer& operator++() noexcept { return *this; }
+            bounded_writer& operator++(int) noexcept { return *this; }
+        };
+
+        void write(level, std::string_view) noexcept;
+
+        /// Format on the stack and only fall back to a heap string for messages that do not fit
+        template <typename ...Args>
+        void format_and_write(const level record_level, const std::format_string<Args...> fmt, const Args&... args) noexcept
+        {
+            char buffer[512];
+            const bounded_writer result = std::vformat_to(bounded_writer { buffer, buffer + sizeof(buffer) }, fmt.get(), std::make_format_args(args...));
+            if (result.count <= sizeof(buffer))
+            {
+                write(record_level, std::string_view { buffer, result.count });
+                return;
+            }
+
+            write(record_level, std::vformat(fmt.get(), std::make_format_args(args...)));
+        }
+
+        void write_binary(level, std::string_view format, std::span<const std::byte> arguments, uint8_t argument_count) noexcept;
+
+        /// Serialize the arguments on the stack, the format string itself is only written once per call site
+        template <typename ...Args>
+        void encode_and_write(const level record_level, const std::string_view format, const Args&... args) noexcept
+        {
+            std::byte buffer[1024];
+            binary::argument_encoder encoder { buffer, sizeof(buffer) };
+            (encoder.add(args), ...);
+            write_binary(record_level, format, std::span { buffer, encoder.size() }, encoder.count());
+        }
+
+        template <level Level, typename ...Args>
+        void log(const std::format_string<Args...> fmt, const Args&... args) noexcept
+        {
+            if constexpr (Level >= min_level)
+            {
+                if (!enabled(Level))
+                {
+                    return;
+                }
+
+                if (g_binary_enabled.load(std::memory_order_relaxed))
+                {
+                    encode_and_write(Level, fmt.get(), args...);
+                    return;
+                }
+
+                format_and_write(Level, fmt, args...);
+            }
+        }
+    }
 
     template <typename ...Args>
-    void info(std::format_string<Args...> fmt, Args... args) noexcept
+    void info(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        info_impl(format_str(fmt, args...));
+        detail::log<level::INFO>(fmt, args...);
     }
 
     template <typename ...Args>
-    void trace(std::format_string<Args...> fmt, Args... args) noexcept
+    void trace(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        trace_impl(format_str(fmt, args...));
+        detail::log<level::TRACE>(fmt, args...);
     }
 
     template <typename ...Args>
-    void debug(std::format_string<Args...> fmt, Args... args) noexcept
+    void debug(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        debug_impl(format_str(fmt, args...));
+        detail::log<level::DEBUG>(fmt, args...);
     }
 
     template <typename ...Args>
-    void warn(std::format_string<Args...> fmt, Args... args) noexcept
+    void warn(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        warn_impl(format_str(fmt, args...));
+        detail::log<level::WARN>(fmt, args...);
     }
 
     template <typename ...Args>
-    void error(std::format_string<Args...> fmt, Args... args) noexcept
+    void error(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        error_impl(format_str(fmt, args...));
+        detail::log<level::ERR>(fmt, args...);
     }
 
     template <typename ...Args>
-    void fatal(std::format_string<Args...> fmt, Args... args) noexcept
+    void fatal(std::format_string<Args...> fmt, [[maybe_unused]] const Args&... args) noexcept
     {
-        fatal_impl(format_str(fmt, args...));
+        detail::log<level::FATAL>(fmt, args...);
     }
 } // namespace rhi::log
 
@@ -0,0 +1,79 @@
+#ifndef RHI_THREAD_POOL_H
+#define RHI_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rhi
+{
+    /// Fixed set of worker threads shared by the subsystems that need to fan work out.
+    /// Every worker owns a deque: it pushes and pops its own work at the back and steals from the
+    /// front of the others when it runs dry, so bursts submitted from one thread spread across the pool.
+    class thread_pool
+    {
+    public:
+        /// @brief Spawn the workers. 0 picks one worker per hardware thread, minus the caller
+        [[nodiscard]] explicit thread_pool(uint32_t thread_count = 0) noexcept;
+        ~thread_pool() noexcept;
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        template <typename F>
+        [[nodiscard]] auto submit(F&& function) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+        {
+            using result_type = std::invoke_result_t<std::decay_t<F>>;
+
+            auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(function));
+            std::future<result_type> future = task->get_future();
+            _enqueue([task]() { (*task)(); });
+
+            return future;
+        }
+
+        /// @brief Run function(i) for every i in [0, count) and return once all of them finished.
+        /// The calling thread helps out instead of sleeping, and a calling worker keeps running other tasks while it waits.
+        void parallel_for(uint32_t count, const std::function<void(uint32_t)>& function) noexcept;
+
+        [[nodiscard]] uint32_t size() const noexcept { return static_cast<uint32_t>(_queues.size()); }
+
+        /// @brief Index of the calling worker in [0, size()), or size() for threads outside the pool
+        [[nodiscard]] uint32_t worker_index() const noexcept;
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex {};
+            std::deque<std::function<void()>> tasks {};
+        };
+
+        void _enqueue(std::function<void()>) noexcept;
+        void _worker_loop(uint32_t index) noexcept;
+
+        /// @brief Pop from the worker's own queue, otherwise steal from the others. Runs the task if one was found
+        [[nodiscard]] bool _run_one(uint32_t index) noexcept;
+
+    private:
+        std::vector<std::thread> _threads {};
+        std::vector<std::unique_ptr<worker_queue>> _queues {};
+
+        /// Queue that the next task from outside the pool goes to
+        std::atomic<uint32_t> _next_queue { 0 };
+        std::atomic<uint32_t> _pending { 0 };
+
+        std::mutex _sleep_mutex {};
+        std::condition_variable _condition {};
+        bool _stopping { false };
+    };
+} // namespace rhi
+
+#endif //RHI_THREAD_POOL_H
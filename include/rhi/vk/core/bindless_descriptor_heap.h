@@ -0,0 +1,120 @@
+#ifndef RHI_BINDLESS_DESCRIPTOR_HEAP_H
+#define RHI_BINDLESS_DESCRIPTOR_HEAP_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/physical_device_handler.h"
+
+namespace rhi::vk
+{
+    /// Binding of each table in the bindless set. Shaders declare matching unsized arrays
+    enum class bindless_table : uint32_t
+    {
+        SAMPLED_IMAGE = 0,
+        STORAGE_BUFFER = 1,
+        SAMPLER = 2,
+    };
+
+    struct bindless_descriptor_heap_description
+    {
+        uint32_t sampled_image_count { 65536 };
+        uint32_t storage_buffer_count { 65536 };
+        uint32_t sampler_count { 1024 };
+        VkShaderStageFlags stages { VK_SHADER_STAGE_ALL };
+    };
+
+    /// One device-wide descriptor set holding partially bound, update-after-bind arrays of sampled images,
+    /// storage buffers and samplers. Resources get a slot index once and shaders index the arrays with it,
+    /// so nothing is allocated or bound per draw.
+    /// Slot allocation is a lock-free stack per table. Freed slots are parked until the GPU reaches the
+    /// retire value passed to free(), then collect() makes them available again.
+    class bindless_descriptor_heap
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<bindless_descriptor_heap>, error> create(VkDevice, const physical_device&, const bindless_descriptor_heap_description&) noexcept;
+
+        ~bindless_descriptor_heap() noexcept = default;
+        bindless_descriptor_heap(const bindless_descriptor_heap&) = delete;
+        bindless_descriptor_heap& operator=(const bindless_descriptor_heap&) = delete;
+
+        /// @brief Take a slot and write the view into it
+        /// @return slot index, or nullopt when the table is full
+        [[nodiscard]] std::optional<uint32_t> add_sampled_image(VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) noexcept;
+        [[nodiscard]] std::optional<uint32_t> add_storage_buffer(VkBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) noexcept;
+        [[nodiscard]] std::optional<uint32_t> add_sampler(VkSampler) noexcept;
+
+        /// @brief Point an existing slot at another resource. Allowed while the set is bound, as long as
+        /// the GPU does not read the slot in work that is in flight
+        void update_sampled_image(uint32_t index, VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) noexcept;
+        void update_storage_buffer(uint32_t index, VkBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) noexcept;
+        void update_sampler(uint32_t index, VkSampler) noexcept;
+
+        /// @brief Give the slot back once the GPU has passed retire_value, e.g. the frame_pacer signal value
+        /// of the last frame that used it
+        void free(bindless_table, uint32_t index, uint64_t retire_value) noexcept;
+
+        /// @brief Recycle every freed slot whose retire value the GPU has reached
+        void collect(uint64_t completed_value) noexcept;
+
+        [[nodiscard]] VkDescriptorSetLayout layout() const noexcept { return _layout; }
+        [[nodiscard]] VkDescriptorSet set() const noexcept { return _set; }
+        [[nodiscard]] uint32_t capacity(bindless_table table) const noexcept { return _tables[static_cast<uint32_t>(table)].capacity; }
+
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] bindless_descriptor_heap() noexcept = default;
+
+        static constexpr uint32_t table_count = 3;
+        static constexpr uint32_t invalid_index = UINT32_MAX;
+
+        /// Treiber stack over slot indices. The head packs the top index with a counter that changes
+        /// on every pop and push, so a stale compare-exchange cannot succeed (ABA)
+        struct index_stack
+        {
+            uint32_t capacity { 0 };
+            std::unique_ptr<std::atomic<uint32_t>[]> next { nullptr };
+            std::atomic<uint64_t> head { 0 };
+
+            void init(uint32_t count) noexcept;
+            [[nodiscard]] std::optional<uint32_t> pop() noexcept;
+            void push(uint32_t index) noexcept;
+        };
+
+        struct retired_slot
+        {
+            bindless_table table { bindless_table::SAMPLED_IMAGE };
+            uint32_t index { 0 };
+            uint64_t retire_value { 0 };
+        };
+
+        void _write(bindless_table, uint32_t index, const VkDescriptorImageInfo*, const VkDescriptorBufferInfo*) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkDescriptorSetLayout _layout { VK_NULL_HANDLE };
+        VkDescriptorPool _pool { VK_NULL_HANDLE };
+        VkDescriptorSet _set { VK_NULL_HANDLE };
+
+        std::array<index_stack, table_count> _tables {};
+
+        /// vkUpdateDescriptorSets needs the set externally synchronized, update-after-bind only lifts the
+        /// restriction against command buffers using it
+        std::mutex _write_mutex {};
+
+        std::mutex _retired_mutex {};
+        std::vector<retired_slot> _retired {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_BINDLESS_DESCRIPTOR_HEAP_H
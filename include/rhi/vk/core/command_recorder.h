@@ -0,0 +1,91 @@
+#ifndef RHI_COMMAND_RECORDER_H
+#define RHI_COMMAND_RECORDER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "core/thread_pool.h"
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    struct command_recorder_description
+    {
+        uint32_t frames_in_flight { 2 };
+    };
+
+    /// Records command buffers for one queue family across the worker threads of a thread_pool.
+    /// Every worker (plus the submitting thread) owns one VkCommandPool per frame in flight, so
+    /// recording never contends on a pool and a frame is recycled by resetting its pools in bulk.
+    class command_recorder
+    {
+    public:
+        /// Records into the given secondary command buffer. The index is the job's position in the batch
+        using record_function = std::function<void(VkCommandBuffer, uint32_t)>;
+
+        [[nodiscard]] static expected<std::shared_ptr<command_recorder>, error> create(VkDevice, uint32_t queue_family_index, std::shared_ptr<thread_pool>, const command_recorder_description&) noexcept;
+
+        ~command_recorder() noexcept = default;
+        command_recorder(const command_recorder&) = delete;
+        command_recorder& operator=(const command_recorder&) = delete;
+
+        /// @brief Switch to the frame and reset all of its pools. The GPU must be done with that frame
+        [[nodiscard]] VkResult begin_frame(uint32_t frame_index) noexcept;
+
+        /// @brief Get a primary command buffer from the current frame, already begun for one time submit.
+        /// Threads outside the thread pool share one command pool per frame: they may call this concurrently,
+        /// but must not record into the buffers they got at the same time, as Vulkan requires for one pool
+        [[nodiscard]] expected<VkCommandBuffer, std::string> begin_primary() noexcept;
+
+        /// @brief Record the jobs into secondary command buffers on the worker threads and execute them
+        /// into the primary in job order. Must be called from one thread at a time per recorder.
+        [[nodiscard]] VkResult record_parallel(
+            VkCommandBuffer primary,
+            const VkCommandBufferInheritanceInfo& inheritance,
+            VkCommandBufferUsageFlags usage,
+            std::span<const record_function> jobs
+        ) noexcept;
+
+        [[nodiscard]] uint32_t queue_family_index() const noexcept { return _queue_family_index; }
+        [[nodiscard]] uint32_t frame_index() const noexcept { return _frame; }
+        [[nodiscard]] uint32_t frames_in_flight() const noexcept { return _frames_in_flight; }
+
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] command_recorder() noexcept = default;
+
+        struct pool_slot
+        {
+            VkCommandPool pool { VK_NULL_HANDLE };
+            std::vector<VkCommandBuffer> primaries {};
+            std::vector<VkCommandBuffer> secondaries {};
+            uint32_t used_primaries { 0 };
+            uint32_t used_secondaries { 0 };
+        };
+
+        [[nodiscard]] pool_slot& _slot(uint32_t worker) noexcept;
+        [[nodiscard]] VkResult _acquire(pool_slot&, VkCommandBufferLevel, VkCommandBuffer&) const noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        uint32_t _queue_family_index { 0 };
+        uint32_t _frames_in_flight { 0 };
+        uint32_t _frame { 0 };
+
+        std::shared_ptr<thread_pool> _workers { nullptr };
+
+        /// Slots per frame: one per worker and a final one for threads outside the pool
+        uint32_t _slots_per_frame { 0 };
+        std::vector<pool_slot> _slots {};
+        std::mutex _external_mutex {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_COMMAND_RECORDER_H
@@ -0,0 +1,145 @@
+#ifndef RHI_DESCRIPTOR_ALLOCATOR_H
+#define RHI_DESCRIPTOR_ALLOCATOR_H
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "core/thread_pool.h"
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// Descriptors per set a new pool reserves for one type
+    struct descriptor_pool_ratio
+    {
+        VkDescriptorType type { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER };
+        float per_set { 1.0f };
+    };
+
+    struct descriptor_allocator_description
+    {
+        uint32_t frames_in_flight { 2 };
+
+        /// Sets in the first pool of each thread. Every further pool doubles up to max_sets_per_pool
+        uint32_t sets_per_pool { 64 };
+        uint32_t max_sets_per_pool { 4096 };
+
+        std::vector<descriptor_pool_ratio> ratios {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+            { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+            { VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+        };
+    };
+
+    /// Owns one VkDescriptorSetLayout per distinct set of bindings, so equal layouts requested from
+    /// different places resolve to the same handle. Safe to call from multiple threads
+    class descriptor_layout_cache
+    {
+    public:
+        [[nodiscard]] explicit descriptor_layout_cache(VkDevice device) noexcept
+            : _device { device }
+        {}
+
+        ~descriptor_layout_cache() noexcept = default;
+        descriptor_layout_cache(const descriptor_layout_cache&) = delete;
+        descriptor_layout_cache& operator=(const descriptor_layout_cache&) = delete;
+
+        /// @brief Get the layout for the bindings, creating it on first use. Binding order does not matter
+        [[nodiscard]] expected<VkDescriptorSetLayout, std::string> get(std::span<const VkDescriptorSetLayoutBinding>, VkDescriptorSetLayoutCreateFlags = 0) noexcept;
+
+        [[nodiscard]] size_t size() const noexcept;
+
+        void destroy() noexcept;
+
+    private:
+        struct layout_key
+        {
+            VkDescriptorSetLayoutCreateFlags flags { 0 };
+            std::vector<VkDescriptorSetLayoutBinding> bindings {};
+
+            [[nodiscard]] bool operator==(const layout_key&) const noexcept;
+        };
+
+        struct layout_key_hasher
+        {
+            [[nodiscard]] size_t operator()(const layout_key&) const noexcept;
+        };
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        mutable std::shared_mutex _mutex {};
+        std::unordered_map<layout_key, VkDescriptorSetLayout, layout_key_hasher> _layouts {};
+        std::vector<std::vector<VkSampler>> _immutable_samplers {};
+    };
+
+    /// Allocates descriptor sets from pools owned per frame in flight and per worker thread, like the
+    /// command_recorder does for command buffers. Sets are never freed one by one: begin_frame() resets
+    /// every pool of the frame in one call each. Pools are added on demand when a thread runs out.
+    /// Worker threads allocate without locking, threads outside the pool share one locked slot.
+    class descriptor_allocator
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<descriptor_allocator>, error> create(VkDevice, std::shared_ptr<thread_pool>, const descriptor_allocator_description&) noexcept;
+
+        ~descriptor_allocator() noexcept = default;
+        descriptor_allocator(const descriptor_allocator&) = delete;
+        descriptor_allocator& operator=(const descriptor_allocator&) = delete;
+
+        /// @brief Switch to the frame and reset all of its pools. The GPU must be done with that frame
+        [[nodiscard]] VkResult begin_frame(uint32_t frame_index) noexcept;
+
+        /// @brief Allocate a set valid until the frame comes around again. Fails without growing when the layout does
+        /// not fit an empty pool, e.g. because one of its descriptor types has no ratio
+        [[nodiscard]] expected<VkDescriptorSet, std::string> allocate(VkDescriptorSetLayout) noexcept;
+
+        [[nodiscard]] descriptor_layout_cache& layouts() noexcept { return _layouts; }
+
+        [[nodiscard]] uint32_t frame_index() const noexcept { return _frame; }
+
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] explicit descriptor_allocator(const VkDevice device) noexcept
+            : _device { device }
+            , _layouts { device }
+        {}
+
+        struct pool_slot
+        {
+            std::vector<VkDescriptorPool> used {};
+            std::vector<VkDescriptorPool> free {};
+            uint32_t next_sets { 0 };
+        };
+
+        [[nodiscard]] pool_slot& _slot(uint32_t worker) noexcept;
+        [[nodiscard]] VkResult _add_pool(pool_slot&) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        descriptor_layout_cache _layouts;
+        std::shared_ptr<thread_pool> _workers { nullptr };
+
+        uint32_t _frames_in_flight { 0 };
+        uint32_t _frame { 0 };
+        uint32_t _max_sets_per_pool { 0 };
+        std::vector<descriptor_pool_ratio> _ratios {};
+
+        /// Slots per frame: one per worker and a final one for threads outside the pool
+        uint32_t _slots_per_frame { 0 };
+        std::vector<pool_slot> _slots {};
+        std::mutex _external_mutex {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,83 @@
+#ifndef RHI_DEVICE_CAPABILITY_CACHE_H
+#define RHI_DEVICE_CAPABILITY_CACHE_H
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// Descriptor indexing features and limits needed for bindless descriptor tables
+    struct descriptor_indexing_support
+    {
+        bool sampled_image_update_after_bind { false };
+        bool storage_buffer_update_after_bind { false };
+        bool partially_bound { false };
+        bool runtime_array { false };
+        bool sampled_image_non_uniform_indexing { false };
+        bool storage_buffer_non_uniform_indexing { false };
+
+        uint32_t max_update_after_bind_sampled_images { 0 };
+        uint32_t max_update_after_bind_storage_buffers { 0 };
+        uint32_t max_update_after_bind_samplers { 0 };
+
+        /// What one shader stage can reach. Samplers do not count against max_per_stage_update_after_bind_resources
+        uint32_t max_per_stage_update_after_bind_sampled_images { 0 };
+        uint32_t max_per_stage_update_after_bind_storage_buffers { 0 };
+        uint32_t max_per_stage_update_after_bind_samplers { 0 };
+        uint32_t max_per_stage_update_after_bind_resources { 0 };
+
+        /// @brief Whether a bindless_descriptor_heap can be created on the device
+        [[nodiscard]] bool is_bindless_capable() const noexcept
+        {
+            return sampled_image_update_after_bind
+                && storage_buffer_update_after_bind
+                && partially_bound
+                && runtime_array
+                && sampled_image_non_uniform_indexing;
+        }
+    };
+
+    /// What physical_device queries beyond the base properties and features. None of it depends on a
+    /// surface, so it stays valid for as long as the driver does
+    struct device_capabilities
+    {
+        VkPhysicalDeviceMemoryProperties memory_properties {};
+        descriptor_indexing_support descriptor_indexing {};
+        std::vector<VkExtensionProperties> extensions {};
+        std::vector<VkQueueFamilyProperties> queue_families {};
+    };
+
+    /// One file per GPU named after the vendor, device and pipelineCacheUUID, holding its device_capabilities.
+    /// Entries written by another driver or API version are ignored on load and replaced on the next store,
+    /// so a driver update invalidates the cache without any action from the application
+    class device_capability_cache
+    {
+    public:
+        [[nodiscard]] explicit device_capability_cache(std::filesystem::path directory) noexcept
+            : _directory { std::move(directory) }
+        {}
+
+        device_capability_cache(const device_capability_cache&) = delete;
+        device_capability_cache& operator=(const device_capability_cache&) = delete;
+
+        /// @brief Capabilities stored for the device, if they were written by the same driver and queried up to the same API version
+        [[nodiscard]] std::optional<device_capabilities> load(const VkPhysicalDeviceProperties&, uint32_t api_version) const noexcept;
+
+        /// @brief Write the capabilities queried for the device up to the API version. Safe to call from several threads
+        bool store(const VkPhysicalDeviceProperties&, uint32_t api_version, const device_capabilities&) const noexcept;
+
+        [[nodiscard]] std::filesystem::path path(const VkPhysicalDeviceProperties&) const noexcept;
+
+    private:
+        std::filesystem::path _directory {};
+
+        /// Identical GPUs share a file, their stores must not interleave
+        mutable std::mutex _write_mutex {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_DEVICE_CAPABILITY_CACHE_H
@@ -0,0 +1,91 @@
+#ifndef RHI_DEVICE_QUEUE_H
+#define RHI_DEVICE_QUEUE_H
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// How many queues the device creates for each role. Roles without a dedicated family share the
+    /// graphics family, and requests past the family's queue count hand out the same queues again
+    struct device_queue_description
+    {
+        uint32_t graphics_count { 1 };
+        uint32_t compute_count { 1 };
+        uint32_t transfer_count { 1 };
+    };
+
+    /// One VkQueue retrieved from the device. Submissions to a VkQueue must be externally synchronized,
+    /// so every call that touches the queue goes through its mutex and the queue can be shared between threads.
+    class device_queue
+    {
+    public:
+        [[nodiscard]] device_queue(const VkQueue queue, const uint32_t family_index, const uint32_t queue_index) noexcept
+            : _handle { queue }
+            , _family_index { family_index }
+            , _queue_index { queue_index }
+        {}
+
+        device_queue(const device_queue&) = delete;
+        device_queue& operator=(const device_queue&) = delete;
+
+        [[nodiscard]] VkResult submit(std::span<const VkSubmitInfo>, VkFence fence = VK_NULL_HANDLE) noexcept;
+        [[nodiscard]] VkResult submit(const VkSubmitInfo&, VkFence fence = VK_NULL_HANDLE) noexcept;
+
+        [[nodiscard]] VkResult present(const VkPresentInfoKHR&) noexcept;
+
+        [[nodiscard]] VkResult wait_idle() noexcept;
+
+        [[nodiscard]] VkQueue get() const noexcept { return _handle; }
+        [[nodiscard]] uint32_t family_index() const noexcept { return _family_index; }
+        [[nodiscard]] uint32_t queue_index() const noexcept { return _queue_index; }
+
+    private:
+        VkQueue _handle { VK_NULL_HANDLE };
+        uint32_t _family_index { 0 };
+        uint32_t _queue_index { 0 };
+        std::mutex _mutex {};
+    };
+
+    /// Buffer range moving between queue families. The stages and access masks are the ones the work on the
+    /// releasing side last used and the ones the work on the acquiring side will use first
+    struct buffer_ownership_transfer
+    {
+        VkBuffer buffer { VK_NULL_HANDLE };
+        VkDeviceSize offset { 0 };
+        VkDeviceSize size { VK_WHOLE_SIZE };
+        VkPipelineStageFlags src_stages { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkAccessFlags src_access { 0 };
+        VkPipelineStageFlags dst_stages { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkAccessFlags dst_access { 0 };
+    };
+
+    /// Image subresources moving between queue families, optionally changing layout on the way.
+    /// The layouts have to match on the release and the acquire side
+    struct image_ownership_transfer
+    {
+        VkImage image { VK_NULL_HANDLE };
+        VkImageSubresourceRange range { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        VkImageLayout old_layout { VK_IMAGE_LAYOUT_UNDEFINED };
+        VkImageLayout new_layout { VK_IMAGE_LAYOUT_UNDEFINED };
+        VkPipelineStageFlags src_stages { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkAccessFlags src_access { 0 };
+        VkPipelineStageFlags dst_stages { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkAccessFlags dst_access { 0 };
+    };
+
+    /// @brief Record the release half of a queue family ownership transfer into a command buffer of the source family.
+    /// Nothing is recorded when both families are the same
+    void release_ownership(VkCommandBuffer, uint32_t src_family, uint32_t dst_family,
+        std::span<const buffer_ownership_transfer>, std::span<const image_ownership_transfer>) noexcept;
+
+    /// @brief Record the acquire half into a command buffer of the destination family. The acquiring submission has
+    /// to wait on a semaphore signalled by the releasing one. With equal families this records a plain barrier instead
+    void acquire_ownership(VkCommandBuffer, uint32_t src_family, uint32_t dst_family,
+        std::span<const buffer_ownership_transfer>, std::span<const image_ownership_transfer>) noexcept;
+} // namespace rhi::vk
+
+#endif //RHI_DEVICE_QUEUE_H
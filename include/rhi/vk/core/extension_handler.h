@@ -9,6 +9,7 @@
 
 #include "vk/vulkan.h"
 #include "core/expected.h"
+#include "vk/core/name_table.h"
 
 #include <string>
 #include <string_view>
@@ -38,12 +39,16 @@ namespace rhi::vk
         template<extension_source S>
         void fetch_all_extensions() noexcept;
 
-        expected<std::vector<const char*>, std::string> get_requested(std::span<requested_extension>) const noexcept;
+        /// @brief Resolve the requested extensions against the supported ones, dropping duplicates and missing optional ones
+        /// @return Names owned by the handler, valid until the next call or the handler's destruction
+        [[nodiscard]] expected<std::span<const char* const>, std::string> get_requested(std::span<const requested_extension>) noexcept;
 
         [[nodiscard]] bool is_supported(std::string_view) const noexcept;
 
     private:
         std::vector<VkExtensionProperties> _extensions;
+        name_table _names {};
+        std::vector<const char*> _enabled {};
     };
 } // namespace rhi::vk
 
@@ -0,0 +1,63 @@
+#ifndef RHI_FRAME_PACER_H
+#define RHI_FRAME_PACER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/timeline_semaphore.h"
+
+namespace rhi::vk
+{
+    /// Limits how many frames the CPU may record ahead of the GPU using one timeline semaphore.
+    /// Frame N signals value N, so anything used by frame N can be retired once completed_value() >= N.
+    class frame_pacer
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<frame_pacer>, std::string> create(VkDevice, uint32_t frames_in_flight) noexcept;
+
+        ~frame_pacer() noexcept = default;
+        frame_pacer(const frame_pacer&) = delete;
+        frame_pacer& operator=(const frame_pacer&) = delete;
+
+        /// @brief Start the next frame, waiting until the frame that last used its slot has finished on the GPU
+        /// @return false if the timeout expired first, the frame is not started in that case
+        [[nodiscard]] bool begin_frame(uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Value the submission of the current frame has to signal
+        [[nodiscard]] uint64_t signal_value() const noexcept { return _frame_value; }
+
+        /// @brief Slot of the current frame in [0, frames_in_flight)
+        [[nodiscard]] uint32_t frame_index() const noexcept { return static_cast<uint32_t>((_frame_value + _frames_in_flight - 1) % _frames_in_flight); }
+        [[nodiscard]] uint32_t frames_in_flight() const noexcept { return _frames_in_flight; }
+
+        /// @brief Last frame value the GPU finished
+        [[nodiscard]] uint64_t completed_value() const noexcept { return _semaphore.value(); }
+
+        [[nodiscard]] const timeline_semaphore& semaphore() const noexcept { return _semaphore; }
+
+        /// @brief Chain into VkSubmitInfo::pNext together with semaphore() as a signal semaphore.
+        /// Points into the pacer, so it is only valid until the next begin_frame()
+        [[nodiscard]] VkTimelineSemaphoreSubmitInfo signal_submit_info() const noexcept;
+
+        /// @brief Block until every submitted frame finished
+        [[nodiscard]] VkResult wait_idle(uint64_t timeout = UINT64_MAX) const noexcept;
+
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] explicit frame_pacer(timeline_semaphore semaphore, const uint32_t frames_in_flight) noexcept
+            : _semaphore { semaphore }
+            , _frames_in_flight { frames_in_flight }
+        {}
+
+    private:
+        timeline_semaphore _semaphore;
+        uint32_t _frames_in_flight { 0 };
+        uint64_t _frame_value { 0 };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_FRAME_PACER_H
@@ -0,0 +1,217 @@
+#ifndef RHI_GPU_PROFILER_H
+#define RHI_GPU_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/device_queue.h"
+#include "vk/core/physical_device_handler.h"
+
+namespace rhi::vk
+{
+    struct gpu_profiler_description
+    {
+        /// Frames between recording a frame and reading its timestamps, so the read never waits for the GPU.
+        /// The query pools rotate over latency + 1 frames
+        uint32_t latency { 2 };
+
+        /// Timestamp queries per frame, every scope takes two. Scopes past the limit are dropped and counted
+        uint32_t queries_per_frame { 512 };
+
+        /// Resolved scopes kept for the trace export, the oldest are dropped first
+        uint32_t max_events { 1u << 16 };
+
+        /// How often begin_frame() measures the clock offset again when VK_EXT_calibrated_timestamps is enabled.
+        /// Without it only create() and calibrate() measure it, since that submits and waits. 0 never recalibrates
+        std::chrono::seconds recalibration_interval { 10 };
+    };
+
+    /// A scope of GPU work on the CPU clock
+    struct gpu_event
+    {
+        /// The string passed to begin_scope()
+        const char* name { nullptr };
+        uint64_t frame { 0 };
+        std::chrono::steady_clock::time_point begin {};
+        std::chrono::steady_clock::time_point end {};
+    };
+
+    struct gpu_profiler_statistics
+    {
+        uint64_t frames { 0 };
+        uint64_t events { 0 };
+
+        /// Scopes that found no free query in their frame
+        uint64_t dropped_scopes { 0 };
+
+        /// Scopes still unfinished on the GPU when their pool was reused, usually a GPU more than latency frames behind
+        uint64_t late_scopes { 0 };
+
+        /// Uncertainty of the last calibration. Every event may be off by up to this much
+        std::chrono::nanoseconds calibration_error { 0 };
+        bool calibrated_timestamps { false };
+    };
+
+    /// Timestamp queries around scopes of a command buffer, one query pool per frame in flight. A frame's
+    /// pool is read latency frames later when the GPU normally finished it, and only what is already available
+    /// is taken, so profiling never stalls the CPU or the queue. GPU ticks are mapped onto steady_clock with an
+    /// offset measured by VK_EXT_calibrated_timestamps, or by a submitted timestamp when the extension is missing.
+    /// begin_frame() and calibrate() belong to the thread that submits the frames. Scopes may be recorded from
+    /// any thread into the command buffers of the current frame.
+    class gpu_profiler
+    {
+    public:
+        static constexpr uint32_t invalid_scope = UINT32_MAX;
+
+        /// Ends the scope when it leaves the C++ scope, in the command buffer it began in
+        class scope
+        {
+        public:
+            [[nodiscard]] scope(gpu_profiler& profiler, const VkCommandBuffer command_buffer, const char* name) noexcept
+                : _profiler { &profiler }
+                , _command_buffer { command_buffer }
+                , _scope { profiler.begin_scope(command_buffer, name) }
+            {}
+
+            ~scope() noexcept { _profiler->end_scope(_command_buffer, _scope); }
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+        private:
+            gpu_profiler* _profiler { nullptr };
+            VkCommandBuffer _command_buffer { VK_NULL_HANDLE };
+            uint32_t _scope { invalid_scope };
+        };
+
+        /// @param calibrated_timestamps whether VK_EXT_calibrated_timestamps was enabled on the device
+        [[nodiscard]] static expected<std::shared_ptr<gpu_profiler>, error> create(
+            VkDevice,
+            const physical_device&,
+            device_queue& queue,
+            bool calibrated_timestamps,
+            const gpu_profiler_description&
+        ) noexcept;
+
+        ~gpu_profiler() noexcept = default;
+        gpu_profiler(const gpu_profiler&) = delete;
+        gpu_profiler& operator=(const gpu_profiler&) = delete;
+
+        /// @brief Start the next frame. Reads the frames that are latency frames old without waiting, then resets
+        /// the pool this frame reuses. Record it into the first command buffer the frame submits, before any scope
+        void begin_frame(VkCommandBuffer) noexcept;
+
+        /// @brief Write the start timestamp of a scope
+        /// @param name has to outlive the profiler, e.g. a string literal
+        /// @return Handle for end_scope(), invalid_scope when the frame ran out of queries
+        [[nodiscard]] uint32_t begin_scope(VkCommandBuffer, const char* name) noexcept;
+
+        /// @brief Write the end timestamp of a scope, in the same frame it began in
+        void end_scope(VkCommandBuffer, uint32_t scope) noexcept;
+
+        /// @brief Measure the offset between the CPU and GPU clocks again. They drift apart slowly.
+        /// Submits to the queue and waits for it when the extension is missing
+        [[nodiscard]] VkResult calibrate() noexcept;
+
+        /// @brief Scopes of the last frame that was read, in the order they began
+        [[nodiscard]] std::vector<gpu_event> last_frame() const noexcept;
+
+        /// @brief The kept events as Chrome trace JSON, for chrome://tracing or Perfetto. Timestamps are microseconds
+        /// since log::start_time(), the origin of the log's +seconds tag, so CPU events on that clock merge into the
+        /// same timeline. The GPU is tid 0, log::thread_id() starts at 1
+        [[nodiscard]] std::string chrome_trace() const noexcept;
+        [[nodiscard]] bool write_chrome_trace(const std::filesystem::path&) const noexcept;
+
+        [[nodiscard]] gpu_profiler_statistics get_statistics() const noexcept;
+
+        /// @brief Read what is finished and destroy the pools. The caller has to wait for the device first
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] gpu_profiler() noexcept = default;
+
+        struct scope_record
+        {
+            const char* name { nullptr };
+            uint32_t query { 0 };
+        };
+
+        struct frame_pool
+        {
+            VkQueryPool pool { VK_NULL_HANDLE };
+
+            /// Frame recorded into the pool, 0 once it was read
+            uint64_t frame { 0 };
+
+            /// Queries handed out, may run past the pool size when scopes are dropped
+            std::atomic<uint32_t> used { 0 };
+
+            /// First timestamp of the last frame read from the pool. Reading it again means the GPU has not run
+            /// the reset yet and every available result is stale
+            uint64_t stale_tick { UINT64_MAX };
+
+            std::mutex mutex {};
+            std::vector<scope_record> scopes {};
+        };
+
+        /// @brief Read the oldest unread frames that are at least latency old
+        /// @param reused frame whose pool is about to be reset, it is read with whatever is available
+        void _harvest(uint64_t reused) noexcept;
+
+        /// @return false if the frame is not finished and was left for later
+        [[nodiscard]] bool _read(frame_pool&, bool force) noexcept;
+
+        [[nodiscard]] std::chrono::steady_clock::time_point _to_cpu_time(uint64_t ticks) const noexcept;
+        [[nodiscard]] VkResult _calibrate_with_extension() noexcept;
+        [[nodiscard]] VkResult _calibrate_with_submit() noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        device_queue* _queue { nullptr };
+        gpu_profiler_description _description {};
+
+        std::unique_ptr<frame_pool[]> _pools { nullptr };
+        uint32_t _pool_count { 0 };
+        std::atomic<uint32_t> _current { 0 };
+
+        /// Frames begun and the last one read
+        uint64_t _frame { 0 };
+        uint64_t _harvested { 0 };
+
+        /// Value and availability per query, reused between reads
+        std::vector<uint64_t> _results {};
+
+        /// Nanoseconds per tick and the bits of a timestamp that count
+        double _period { 1.0 };
+        uint64_t _tick_mask { UINT64_MAX };
+
+        /// GPU tick and CPU time measured at the same moment
+        uint64_t _gpu_anchor { 0 };
+        std::chrono::steady_clock::time_point _cpu_anchor {};
+        std::chrono::steady_clock::time_point _calibrated_at {};
+        PFN_vkGetCalibratedTimestampsEXT _get_calibrated_timestamps { nullptr };
+
+        /// Created on the first calibration that has to go through the queue
+        VkCommandPool _calibration_commands { VK_NULL_HANDLE };
+        VkCommandBuffer _calibration_buffer { VK_NULL_HANDLE };
+        VkQueryPool _calibration_pool { VK_NULL_HANDLE };
+        VkFence _calibration_fence { VK_NULL_HANDLE };
+
+        mutable std::mutex _events_mutex {};
+        std::deque<gpu_event> _events {};
+        std::vector<gpu_event> _last_frame {};
+        gpu_profiler_statistics _statistics {};
+        std::atomic<uint64_t> _dropped_scopes { 0 };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_GPU_PROFILER_H
@@ -0,0 +1,180 @@
+#ifndef RHI_MEMORY_ALLOCATOR_H
+#define RHI_MEMORY_ALLOCATOR_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/physical_device_handler.h"
+
+namespace rhi::vk
+{
+    enum class memory_usage
+    {
+        GPU_ONLY,
+        CPU_TO_GPU,
+        GPU_TO_CPU,
+        CPU_ONLY
+    };
+
+    /// Linear resources (buffers, linear images) and optimal images are kept in separate
+    /// blocks so that neighbouring allocations never violate bufferImageGranularity.
+    enum class memory_resource_kind
+    {
+        LINEAR,
+        OPTIMAL
+    };
+
+    struct allocation_create_info
+    {
+        memory_usage usage { memory_usage::GPU_ONLY };
+        memory_resource_kind kind { memory_resource_kind::LINEAR };
+
+        /// Force a separate VkDeviceMemory for this resource regardless of its size
+        bool dedicated { false };
+    };
+
+    struct memory_allocation
+    {
+        VkDeviceMemory memory { VK_NULL_HANDLE };
+        VkDeviceSize offset { 0 };
+        VkDeviceSize size { 0 };
+
+        /// Pointer to the start of this allocation if the memory type is host visible
+        void* mapped_data { nullptr };
+        uint32_t memory_type { 0 };
+
+        [[nodiscard]] bool is_valid() const noexcept { return memory != VK_NULL_HANDLE; }
+        [[nodiscard]] bool is_dedicated() const noexcept { return _pool == dedicated_pool; }
+
+    private:
+        friend class memory_allocator;
+        static constexpr uint32_t dedicated_pool = UINT32_MAX;
+
+        uint32_t _pool { dedicated_pool };
+        uint32_t _block { 0 };
+        uint32_t _node { 0 };
+    };
+
+    struct memory_heap_statistics
+    {
+        VkDeviceSize budget { 0 };
+        VkDeviceSize block_bytes { 0 };
+        VkDeviceSize allocation_bytes { 0 };
+        VkDeviceSize peak_block_bytes { 0 };
+        VkDeviceSize peak_allocation_bytes { 0 };
+        uint32_t block_count { 0 };
+        uint32_t allocation_count { 0 };
+    };
+
+    struct memory_statistics
+    {
+        std::vector<memory_heap_statistics> heaps {};
+
+        /// Number of live vkAllocateMemory objects, blocks and dedicated allocations combined
+        uint32_t device_memory_count { 0 };
+        VkDeviceSize free_block_bytes { 0 };
+
+        /// 0 when the free space of every block is a single range, approaching 1 as it splinters
+        float fragmentation { 0.0f };
+    };
+
+    struct memory_allocator_description
+    {
+        VkDeviceSize block_size { 64ull * 1024 * 1024 };
+
+        /// Requests at least this large get their own VkDeviceMemory. 0 means half the block size
+        VkDeviceSize dedicated_threshold { 0 };
+
+        /// Portion of each heap the allocator is allowed to claim
+        float heap_budget_fraction { 0.8f };
+    };
+
+    struct memory_pool;
+
+    /// Sub-allocates buffers and images out of large per memory type blocks.
+    /// All methods are safe to call from multiple threads.
+    class memory_allocator
+    {
+    public:
+        [[nodiscard]] explicit memory_allocator(VkDevice, const physical_device&, const memory_allocator_description& = {}) noexcept;
+        ~memory_allocator() noexcept;
+
+        memory_allocator(const memory_allocator&) = delete;
+        memory_allocator& operator=(const memory_allocator&) = delete;
+
+        [[nodiscard]] expected<memory_allocation, std::string> allocate(const VkMemoryRequirements&, const allocation_create_info&) noexcept;
+
+        /// @brief Allocate memory for the buffer and bind it
+        [[nodiscard]] expected<memory_allocation, std::string> allocate_for_buffer(VkBuffer, const allocation_create_info&) noexcept;
+
+        /// @brief Allocate memory for the image and bind it. The tiling decides which blocks the image may share
+        [[nodiscard]] expected<memory_allocation, std::string> allocate_for_image(VkImage, const allocation_create_info&, VkImageTiling = VK_IMAGE_TILING_OPTIMAL) noexcept;
+
+        /// @brief Return the allocation to its block. The allocation is reset afterward
+        void free(memory_allocation&) noexcept;
+
+        /// @brief Flush host writes for non-coherent memory. No-op for coherent memory
+        VkResult flush(const memory_allocation&, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const noexcept;
+
+        /// @brief Invalidate host caches for non-coherent memory. No-op for coherent memory
+        VkResult invalidate(const memory_allocation&, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const noexcept;
+
+        [[nodiscard]] memory_statistics get_statistics() const noexcept;
+
+        /// @brief Free every block. Outstanding allocations become invalid
+        void destroy() noexcept;
+
+    private:
+        struct heap_counters
+        {
+            std::atomic<VkDeviceSize> block_bytes { 0 };
+            std::atomic<VkDeviceSize> allocation_bytes { 0 };
+            std::atomic<VkDeviceSize> peak_block_bytes { 0 };
+            std::atomic<VkDeviceSize> peak_allocation_bytes { 0 };
+            std::atomic<uint32_t> block_count { 0 };
+            std::atomic<uint32_t> allocation_count { 0 };
+        };
+
+        [[nodiscard]] int32_t _find_memory_type(uint32_t type_bits, memory_usage) const noexcept;
+        [[nodiscard]] uint32_t _pool_index(uint32_t memory_type, memory_resource_kind) const noexcept;
+        [[nodiscard]] bool _is_host_visible(uint32_t memory_type) const noexcept;
+        [[nodiscard]] VkDeviceSize _preferred_block_size(uint32_t heap) const noexcept;
+
+        [[nodiscard]] expected<memory_allocation, std::string> _allocate_from_type(uint32_t memory_type, const VkMemoryRequirements&, const allocation_create_info&) noexcept;
+        [[nodiscard]] expected<memory_allocation, std::string> _allocate_dedicated(uint32_t memory_type, VkDeviceSize) noexcept;
+        [[nodiscard]] expected<VkDeviceMemory, std::string> _allocate_device_memory(uint32_t memory_type, VkDeviceSize) noexcept;
+        void _free_device_memory(uint32_t memory_type, VkDeviceMemory, VkDeviceSize, bool mapped) noexcept;
+
+        void _track_allocation(uint32_t memory_type, VkDeviceSize) noexcept;
+        void _untrack_allocation(uint32_t memory_type, VkDeviceSize) noexcept;
+
+        [[nodiscard]] VkMappedMemoryRange _mapped_range(const memory_allocation&, VkDeviceSize offset, VkDeviceSize size) const noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPhysicalDeviceMemoryProperties _memory_properties {};
+        VkDeviceSize _buffer_image_granularity { 1 };
+        VkDeviceSize _non_coherent_atom_size { 1 };
+        uint32_t _max_allocation_count { 0 };
+
+        VkDeviceSize _block_size { 0 };
+        VkDeviceSize _dedicated_threshold { 0 };
+        float _heap_budget_fraction { 0.0f };
+
+        std::vector<std::unique_ptr<memory_pool>> _pools {};
+        std::array<heap_counters, VK_MAX_MEMORY_HEAPS> _heaps {};
+        std::atomic<uint32_t> _device_memory_count { 0 };
+
+        mutable std::mutex _dedicated_mutex {};
+        std::unordered_map<VkDeviceMemory, memory_allocation> _dedicated {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_MEMORY_ALLOCATOR_H
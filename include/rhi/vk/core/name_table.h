@@ -0,0 +1,52 @@
+#ifndef RHI_NAME_TABLE_H
+#define RHI_NAME_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace rhi::vk
+{
+    /// Immutable set of extension or layer names, built once per source and searched with a binary search.
+    /// The names live in one buffer that the table owns, so pointers from find() stay valid for as long
+    /// as the table does and copies do not point into each other
+    class name_table
+    {
+    public:
+        [[nodiscard]] name_table() noexcept = default;
+
+        /// @brief Build the table from any range whose elements convert to std::string_view. Duplicates are dropped
+        template <typename Range, typename Projection>
+        [[nodiscard]] static name_table create(const Range& range, Projection projection) noexcept
+        {
+            std::vector<std::string_view> names {};
+            for (const auto& element : range)
+            {
+                names.emplace_back(projection(element));
+            }
+
+            return name_table { names };
+        }
+
+        [[nodiscard]] bool contains(std::string_view name) const noexcept { return find(name) != nullptr; }
+
+        /// @brief The table's own null terminated copy of the name, or nullptr when it is not in the table
+        [[nodiscard]] const char* find(std::string_view) const noexcept;
+
+        [[nodiscard]] size_t size() const noexcept { return _offsets.size(); }
+        [[nodiscard]] bool empty() const noexcept { return _offsets.empty(); }
+
+    private:
+        [[nodiscard]] explicit name_table(std::vector<std::string_view>&) noexcept;
+
+        [[nodiscard]] std::string_view _at(uint32_t offset) const noexcept { return _storage.data() + offset; }
+
+    private:
+        std::vector<char> _storage {};
+
+        /// Start of every name in _storage, ordered by name
+        std::vector<uint32_t> _offsets {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_NAME_TABLE_H
@@ -0,0 +1,157 @@
+#ifndef RHI_OFFSCREEN_TARGET_H
+#define RHI_OFFSCREEN_TARGET_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/memory_allocator.h"
+#include "vk/core/timeline_semaphore.h"
+
+namespace rhi::vk
+{
+    struct offscreen_target_description
+    {
+        VkExtent2D extent { 1280, 720 };
+        VkFormat format { VK_FORMAT_R8G8B8A8_UNORM };
+
+        /// How the image is rendered to. TRANSFER_SRC is always added for the readback
+        VkImageUsageFlags usage { VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+
+        /// Readback buffers, i.e. frames that may be in flight before begin_frame() waits. Two or three are typical
+        uint32_t readback_slots { 2 };
+
+        /// Layout the frame's rendering leaves the image in, and the stages and access of that rendering.
+        /// The readback returns the image to this layout
+        VkImageLayout render_layout { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkPipelineStageFlags render_stages { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        VkAccessFlags render_access { VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+    };
+
+    /// A finished frame in host memory. The pixels are tightly packed rows of row_pitch bytes and only valid
+    /// during the callback, the slot is reused afterward
+    struct offscreen_frame
+    {
+        /// Signal value of the frame, counting from 1
+        uint64_t index { 0 };
+        VkExtent2D extent {};
+        VkFormat format { VK_FORMAT_UNDEFINED };
+        uint32_t row_pitch { 0 };
+        std::span<const std::byte> pixels {};
+    };
+
+    using offscreen_frame_callback = std::function<void(const offscreen_frame&)>;
+
+    struct offscreen_statistics
+    {
+        uint64_t frames { 0 };
+        uint64_t bytes { 0 };
+
+        /// Times begin_frame() had to wait for the GPU because every readback slot was still in flight
+        uint64_t stalls { 0 };
+    };
+
+    /// Color image to render into without a surface, plus a ring of persistently mapped readback buffers.
+    /// Every frame copies the image into its own slot on the GPU and signals a timeline value, so the CPU only
+    /// waits when it wraps around to a slot that is still in flight, instead of idling the queue every frame.
+    /// Finished frames are handed to the callback in order from poll(), begin_frame() and wait_idle().
+    /// Needs timeline semaphores. Not thread safe, drive it from the thread that submits the frames.
+    class offscreen_target
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<offscreen_target>, std::string> create(
+            VkDevice,
+            memory_allocator&,
+            const offscreen_target_description&,
+            offscreen_frame_callback
+        ) noexcept;
+
+        ~offscreen_target() noexcept = default;
+        offscreen_target(const offscreen_target&) = delete;
+        offscreen_target& operator=(const offscreen_target&) = delete;
+
+        /// @brief Start the next frame. Delivers the frames that finished and waits only if the frame's
+        /// readback slot is still in flight
+        /// @return false if the timeout expired first, the frame is not started in that case
+        [[nodiscard]] bool begin_frame(uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Record the copy of the image into the current frame's slot. Call once per frame after the
+        /// rendering commands, in a command buffer that is submitted with signal_submit_info()
+        void record_readback(VkCommandBuffer) noexcept;
+
+        /// @brief Hand every finished frame to the callback without blocking
+        /// @return number of frames delivered
+        uint32_t poll() noexcept;
+
+        /// @brief Block until every recorded frame finished and was delivered
+        [[nodiscard]] VkResult wait_idle(uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Value the submission of the current frame has to signal
+        [[nodiscard]] uint64_t signal_value() const noexcept { return _frame_value; }
+
+        [[nodiscard]] const timeline_semaphore& semaphore() const noexcept { return _timeline; }
+
+        /// @brief Chain into VkSubmitInfo::pNext together with semaphore() as a signal semaphore.
+        /// Points into the target, so it is only valid until the next begin_frame()
+        [[nodiscard]] VkTimelineSemaphoreSubmitInfo signal_submit_info() const noexcept;
+
+        [[nodiscard]] VkImage image() const noexcept { return _image; }
+        [[nodiscard]] VkImageView view() const noexcept { return _view; }
+        [[nodiscard]] VkExtent2D extent() const noexcept { return _description.extent; }
+        [[nodiscard]] VkFormat format() const noexcept { return _description.format; }
+
+        [[nodiscard]] offscreen_statistics get_statistics() const noexcept { return _statistics; }
+
+        /// @brief Wait for the frames in flight without delivering them and release the resources
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] explicit offscreen_target(timeline_semaphore timeline) noexcept
+            : _timeline { timeline }
+        {}
+
+        struct readback_slot
+        {
+            VkBuffer buffer { VK_NULL_HANDLE };
+            memory_allocation memory {};
+            const std::byte* data { nullptr };
+
+            /// Frame whose copy the slot holds or waits for, 0 when it is free
+            uint64_t frame { 0 };
+        };
+
+        [[nodiscard]] readback_slot& _slot_of(const uint64_t frame) noexcept { return _slots[(frame - 1) % _slots.size()]; }
+
+        /// @brief Deliver the finished frames up to and including the value, oldest first
+        uint32_t _deliver(uint64_t completed) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        memory_allocator* _allocator { nullptr };
+        offscreen_target_description _description {};
+        offscreen_frame_callback _callback {};
+        uint32_t _row_pitch { 0 };
+        VkDeviceSize _frame_size { 0 };
+
+        VkImage _image { VK_NULL_HANDLE };
+        VkImageView _view { VK_NULL_HANDLE };
+        memory_allocation _image_memory {};
+
+        std::vector<readback_slot> _slots {};
+        timeline_semaphore _timeline;
+
+        /// Value of the current frame, of the last frame with a recorded readback and of the last one delivered
+        uint64_t _frame_value { 0 };
+        uint64_t _recorded { 0 };
+        uint64_t _delivered { 0 };
+
+        offscreen_statistics _statistics {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_OFFSCREEN_TARGET_H
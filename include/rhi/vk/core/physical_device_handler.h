@@ -5,9 +5,13 @@
 #ifndef RHI_PHYSICAL_DEVICE_HANDLER_H
 #define RHI_PHYSICAL_DEVICE_HANDLER_H
 
+#include "common/error.h"
+#include "vk/core/device_capability_cache.h"
 #include "vk/core/extension_handler.h"
 #include "vk/vulkan.h"
 
+#include <span>
+#include <string>
 #include <vector>
 
 #include "vk/core/queue_family_indices.h"
@@ -24,17 +28,27 @@ namespace rhi::vk
     class physical_device final : public vulkan_object<VkPhysicalDevice>
     {
     public:
-        [[nodiscard]] static physical_device create(VkPhysicalDevice, VkPhysicalDeviceProperties, VkPhysicalDeviceFeatures) noexcept;
+        /// @brief Query the capabilities of the device, or load them from the cache when it holds an entry for the current driver
+        /// @param api_version of the instance. Queries past min(api_version, device apiVersion) are skipped, like device creation does
+        [[nodiscard]] static physical_device create(VkInstance, VkPhysicalDevice, VkPhysicalDeviceProperties, VkPhysicalDeviceFeatures, uint32_t api_version, const device_capability_cache* = nullptr) noexcept;
 
         [[nodiscard]] queue_family_indices get_queue_family_indices(const VkSurfaceKHR& surface) const noexcept;
 
         [[nodiscard]] const std::vector<VkExtensionProperties>& get_device_extensions() const noexcept { return _extensions; };
+        [[nodiscard]] const name_table& get_extension_names() const noexcept { return _extension_names; }
         [[nodiscard]] VkSampleCountFlags max_sample_count() const noexcept { return _max_sample_count; }
         [[nodiscard]] float max_sampler_anisotropy() const noexcept { return _max_sampler_anisotropy; }
         [[nodiscard]] VkPhysicalDeviceFeatures get_features() const noexcept { return _features; }
+        [[nodiscard]] const VkPhysicalDeviceProperties& get_properties() const noexcept { return _properties; }
+        [[nodiscard]] const VkPhysicalDeviceMemoryProperties& get_memory_properties() const noexcept { return _memory_properties; }
+        [[nodiscard]] const descriptor_indexing_support& get_descriptor_indexing() const noexcept { return _descriptor_indexing; }
+        [[nodiscard]] const std::vector<VkQueueFamilyProperties>& get_queue_families() const noexcept { return _queue_families; }
 
         [[nodiscard]] bool is_extension_supported(const char*) const noexcept;
-        [[nodiscard]] expected<swapchain_support, std::string> get_swapchain_support(const VkSurfaceKHR) noexcept;
+        [[nodiscard]] expected<swapchain_support, error> get_swapchain_support(const VkSurfaceKHR) noexcept;
+
+        /// @brief Time domains vkGetCalibratedTimestampsEXT accepts on this device, empty without VK_EXT_calibrated_timestamps
+        [[nodiscard]] std::vector<VkTimeDomainEXT> get_calibrateable_time_domains() const noexcept;
 
         [[nodiscard]] std::string_view name() const noexcept { return _properties.deviceName; }
 
@@ -43,27 +57,83 @@ namespace rhi::vk
     private:
         void _get_extensions() noexcept;
         [[nodiscard]] VkSampleCountFlags _get_max_sample_count() const noexcept;
+        void _query_descriptor_indexing(uint32_t api_version) noexcept;
 
     private:
+        /// Instance the device was enumerated from, for its instance-level extension commands
+        VkInstance _instance { VK_NULL_HANDLE };
         VkPhysicalDeviceProperties _properties {};
         VkPhysicalDeviceFeatures _features {};
+        VkPhysicalDeviceMemoryProperties _memory_properties {};
         VkSampleCountFlags _max_sample_count {};
         float _max_sampler_anisotropy { 0.0f };
         std::optional<swapchain_support> _swapchain_support {};
+        descriptor_indexing_support _descriptor_indexing {};
 
         std::vector<VkExtensionProperties> _extensions {};
+        name_table _extension_names {};
+        std::vector<VkQueueFamilyProperties> _queue_families {};
 
         extension_handler _extension_handler {};
     };
 
+    /// Weights of the terms that make up a device score. Every term is multiplied by its weight and summed,
+    /// so a weight of 0 ignores that aspect
+    struct device_score_weights
+    {
+        /// Flat bonus by VkPhysicalDeviceType. Other and CPU devices get nothing
+        float discrete_gpu { 1000.0f };
+        float integrated_gpu { 100.0f };
+        float virtual_gpu { 50.0f };
+
+        /// Per GiB of the largest device local heap
+        float device_local_gib { 10.0f };
+
+        /// Bonus for a compute family without graphics and a transfer-only family
+        float dedicated_compute { 50.0f };
+        float dedicated_transfer { 25.0f };
+
+        /// Per texel of maxImageDimension2D, a rough stand-in for the device's limits
+        float max_image_dimension_2d { 0.005f };
+
+        /// Per extension of optional_extensions the device supports
+        float optional_extension { 20.0f };
+        std::vector<std::string> optional_extensions {};
+    };
+
+    /// Everything the score is computed from. Plain data, so selection can be tested without a driver
+    struct device_score_input
+    {
+        VkPhysicalDeviceProperties properties {};
+        VkPhysicalDeviceMemoryProperties memory_properties {};
+        std::vector<VkQueueFamilyProperties> queue_families {};
+        name_table extensions {};
+
+        [[nodiscard]] static device_score_input from(const physical_device&) noexcept;
+    };
+
+    /// @brief Score a device, higher is better
+    [[nodiscard]] float score_physical_device(const device_score_input&, const device_score_weights&) noexcept;
+
+    /// @brief Indices of the inputs from the highest to the lowest score. Ties keep their order
+    [[nodiscard]] std::vector<size_t> rank_physical_devices(std::span<const device_score_input>, const device_score_weights&) noexcept;
+
     class physical_device_handler
     {
     public:
-        [[nodiscard]] explicit physical_device_handler(VkInstance instance, VkSurfaceKHR surface) noexcept;
+        /// @param cache Optional capability cache consulted for every device, and filled for the ones it misses
+        [[nodiscard]] explicit physical_device_handler(VkInstance instance, VkSurfaceKHR surface, uint32_t api_version, const device_capability_cache* cache = nullptr) noexcept;
 
         void request_extension(const std::string&, bool = true) noexcept;
         void request_extensions(const std::vector<requested_extension>&) noexcept;
 
+        /// @brief Only accept devices that can host a bindless descriptor heap
+        void require_descriptor_indexing(bool = true) noexcept;
+
+        /// @brief Weights used to order the suitable devices
+        void score_weights(const device_score_weights&) noexcept;
+
+        /// @brief Devices meeting every requirement, best scoring first
         [[nodiscard]] std::vector<physical_device> get_suitable_devices() const noexcept;
 
     private:
@@ -76,6 +146,8 @@ namespace rhi::vk
         std::vector<physical_device> _devices;
 
         std::vector<requested_extension> _extensions {};
+        bool _require_descriptor_indexing { false };
+        device_score_weights _score_weights {};
     };
 } // namespace rhi::vk
 
@@ -0,0 +1,90 @@
+#ifndef RHI_PIPELINE_CACHE_H
+#define RHI_PIPELINE_CACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/physical_device_handler.h"
+
+namespace rhi::vk
+{
+    struct pipeline_cache_description
+    {
+        /// Directory the cache file lives in. Empty, the default, keeps the cache in memory only
+        std::filesystem::path directory {};
+
+        /// How often the cache is written back while the device is alive. 0 only saves on destroy
+        std::chrono::seconds autosave_interval { 0 };
+    };
+
+    struct pipeline_cache_statistics
+    {
+        /// True if a valid blob was found on disk and handed to the driver
+        bool warm { false };
+        size_t loaded_size { 0 };
+        std::chrono::microseconds load_time { 0 };
+        uint32_t saves { 0 };
+    };
+
+    /// VkPipelineCache persisted to a file keyed by the vendor, device and pipelineCacheUUID of the GPU.
+    /// Blobs written by another driver or truncated on disk are rejected at load instead of reaching the driver.
+    class pipeline_cache
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<pipeline_cache>, error> create(VkDevice, const physical_device&, const pipeline_cache_description&) noexcept;
+
+        ~pipeline_cache() noexcept = default;
+        pipeline_cache(const pipeline_cache&) = delete;
+        pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+        [[nodiscard]] VkPipelineCache get() const noexcept { return _cache; }
+
+        /// @brief Snapshot the cache and write it on a background thread
+        /// @return Resolves to false if the snapshot or the write failed
+        [[nodiscard]] std::shared_future<bool> save_async() noexcept;
+
+        [[nodiscard]] const std::filesystem::path& path() const noexcept { return _path; }
+        [[nodiscard]] pipeline_cache_statistics get_statistics() const noexcept;
+
+        /// @brief Stop autosaving, write the cache one last time and destroy it
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] pipeline_cache() noexcept = default;
+
+        [[nodiscard]] std::vector<std::byte> _load() const noexcept;
+
+        /// Checks the header the driver puts in front of its blob against this device
+        [[nodiscard]] bool _validate(std::span<const std::byte> blob) const noexcept;
+        [[nodiscard]] bool _write(const std::vector<std::byte>& data) noexcept;
+        void _autosave_loop(std::chrono::seconds interval) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPipelineCache _cache { VK_NULL_HANDLE };
+        VkPhysicalDeviceProperties _properties {};
+        std::filesystem::path _path {};
+
+        mutable std::mutex _mutex {};
+        pipeline_cache_statistics _statistics {};
+        size_t _saved_size { 0 };
+        std::shared_future<bool> _pending_save {};
+
+        std::thread _autosave {};
+        std::condition_variable _autosave_condition {};
+        bool _stopping { false };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_PIPELINE_CACHE_H
@@ -0,0 +1,78 @@
+#ifndef RHI_PIPELINE_COMPILER_H
+#define RHI_PIPELINE_COMPILER_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/thread_pool.h"
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// Resolves to the compiled pipeline, or VK_NULL_HANDLE if compilation failed
+    using pipeline_future = std::shared_future<VkPipeline>;
+
+    /// Compiles pipelines on the device thread pool through the device pipeline cache.
+    /// Requests are keyed by the contents of the whole create info, so asking twice for the same pipeline
+    /// (while it is still compiling or afterwards) returns the same future instead of compiling again.
+    /// Create infos chaining an extension struct the compiler does not know are always compiled anew, and
+    /// a failed compilation is forgotten so the next request tries again.
+    /// The compiler owns every pipeline it returns and destroys them in destroy().
+    class pipeline_compiler
+    {
+    public:
+        [[nodiscard]] pipeline_compiler(VkDevice, VkPipelineCache, std::shared_ptr<thread_pool>) noexcept;
+
+        ~pipeline_compiler() noexcept = default;
+        pipeline_compiler(const pipeline_compiler&) = delete;
+        pipeline_compiler& operator=(const pipeline_compiler&) = delete;
+
+        /// @brief Queue a batch of graphics pipelines. The create infos and everything they point to
+        /// must stay alive until the returned futures are ready.
+        [[nodiscard]] std::vector<pipeline_future> compile(std::span<const VkGraphicsPipelineCreateInfo>) noexcept;
+
+        /// @brief Queue a batch of compute pipelines, with the same lifetime rules as the graphics overload
+        [[nodiscard]] std::vector<pipeline_future> compile(std::span<const VkComputePipelineCreateInfo>) noexcept;
+
+        /// @brief Number of distinct pipelines requested so far
+        [[nodiscard]] size_t size() const noexcept;
+
+        /// @brief Wait for every queued compilation and destroy all pipelines
+        void destroy() noexcept;
+
+    private:
+        struct entry
+        {
+            pipeline_future future {};
+
+            /// Tells a failed compilation whether the entry under its key is still its own
+            uint64_t id { 0 };
+        };
+
+        template <typename CreateInfo>
+        [[nodiscard]] std::vector<pipeline_future> _compile(std::span<const CreateInfo>) noexcept;
+
+        template <typename CreateInfo>
+        [[nodiscard]] pipeline_future _submit(const CreateInfo*, std::string key, uint64_t id) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPipelineCache _cache { VK_NULL_HANDLE };
+        std::shared_ptr<thread_pool> _workers { nullptr };
+
+        mutable std::mutex _mutex {};
+        std::unordered_map<std::string, entry> _pipelines {};
+
+        /// Requests that could not be keyed, kept only so destroy() finds their pipelines
+        std::vector<pipeline_future> _uncached {};
+        uint64_t _next_id { 0 };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_PIPELINE_COMPILER_H
@@ -0,0 +1,168 @@
+#ifndef RHI_SWAPCHAIN_H
+#define RHI_SWAPCHAIN_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/device_queue.h"
+#include "vk/core/physical_device_handler.h"
+
+namespace rhi::vk
+{
+    struct swapchain_description
+    {
+        /// Size used when the surface leaves it to the swapchain. Otherwise the window size wins
+        VkExtent2D extent { 1280, 720 };
+
+        /// Used when the surface supports it, else the closest match
+        VkSurfaceFormatKHR format { VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+        VkImageUsageFlags usage { VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+
+        /// Prefer MAILBOX, then IMMEDIATE, over FIFO. Frames wait less for vblank but may be dropped or tear
+        bool low_latency { false };
+
+        /// Images on top of the surface's minImageCount. Each one is another frame the CPU may have in flight
+        uint32_t extra_images { 1 };
+    };
+
+    /// Image acquired for the current frame. Rendering has to wait on acquired and the frame's last
+    /// submission has to signal render_finished, which present() waits on
+    struct swapchain_frame
+    {
+        uint32_t image_index { 0 };
+        VkImage image { VK_NULL_HANDLE };
+        VkImageView view { VK_NULL_HANDLE };
+        VkSemaphore acquired { VK_NULL_HANDLE };
+        VkSemaphore render_finished { VK_NULL_HANDLE };
+    };
+
+    struct swapchain_frame_timing
+    {
+        /// Time blocked in vkAcquireNextImageKHR waiting for a free image
+        std::chrono::nanoseconds acquire_wait { 0 };
+
+        /// From acquire() returning to present() being called, i.e. recording and submitting the frame
+        std::chrono::nanoseconds acquire_to_present { 0 };
+
+        /// Time spent in vkQueuePresentKHR
+        std::chrono::nanoseconds present { 0 };
+    };
+
+    struct swapchain_statistics
+    {
+        uint64_t frames { 0 };
+        uint64_t rebuilds { 0 };
+        uint64_t out_of_date { 0 };
+        uint64_t suboptimal { 0 };
+
+        /// Sums over every presented frame, divide by frames for the average
+        swapchain_frame_timing total {};
+    };
+
+    /// Presentable images of a surface. The present mode and format are picked once, the images are recreated
+    /// whenever the surface reports a new size. The old swapchain is handed to the new one as oldSwapchain and kept
+    /// until frames_in_flight() more frames were acquired, so a resize never idles the device.
+    /// Pace the CPU to frames_in_flight() frames, e.g. with a frame_pacer, which is what makes reusing the
+    /// semaphores safe. Not thread safe, drive it from the thread that submits the frames.
+    class swapchain
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<swapchain>, error> create(
+            VkDevice,
+            VkPhysicalDevice,
+            VkSurfaceKHR,
+            device_queue& present_queue,
+            const swapchain_support&,
+            const swapchain_description&
+        ) noexcept;
+
+        ~swapchain() noexcept = default;
+        swapchain(const swapchain&) = delete;
+        swapchain& operator=(const swapchain&) = delete;
+
+        /// @brief Acquire the next image. Rebuilds first when the last present or acquire reported a size change
+        /// @return VK_SUCCESS or VK_SUBOPTIMAL_KHR with a usable frame, VK_NOT_READY while the window is minimized,
+        /// VK_TIMEOUT, or the error that made the acquire fail
+        [[nodiscard]] VkResult acquire(swapchain_frame&, uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Queue the frame for presentation once its render_finished semaphore is signalled
+        [[nodiscard]] VkResult present(const swapchain_frame&) noexcept;
+
+        /// @brief Recreate the images for the current surface size, or the given one when the surface leaves it open
+        /// @return VK_NOT_READY if the surface has no area, the old images stay in use then
+        [[nodiscard]] VkResult rebuild(VkExtent2D extent = { 0, 0 }) noexcept;
+
+        [[nodiscard]] bool needs_rebuild() const noexcept { return _needs_rebuild; }
+
+        [[nodiscard]] VkSwapchainKHR get() const noexcept { return _current.handle; }
+        [[nodiscard]] VkSurfaceFormatKHR format() const noexcept { return _format; }
+        [[nodiscard]] VkPresentModeKHR present_mode() const noexcept { return _present_mode; }
+        [[nodiscard]] VkExtent2D extent() const noexcept { return _current.extent; }
+        [[nodiscard]] uint32_t image_count() const noexcept { return static_cast<uint32_t>(_current.images.size()); }
+
+        /// @brief Images the application can hold at once without vkAcquireNextImageKHR blocking
+        [[nodiscard]] uint32_t frames_in_flight() const noexcept { return _frames_in_flight; }
+
+        [[nodiscard]] const swapchain_frame_timing& last_frame_timing() const noexcept { return _last_timing; }
+        [[nodiscard]] swapchain_statistics get_statistics() const noexcept { return _statistics; }
+
+        /// @brief Destroy every swapchain generation. The caller has to wait for its frames first
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] swapchain() noexcept = default;
+
+        /// Swapchain handle and everything that has to live exactly as long as it
+        struct generation
+        {
+            VkSwapchainKHR handle { VK_NULL_HANDLE };
+            VkExtent2D extent {};
+            std::vector<VkImage> images {};
+            std::vector<VkImageView> views {};
+
+            /// One per image, a present still waiting on it is over once the image is acquired again
+            std::vector<VkSemaphore> render_finished {};
+
+            /// Frame count at which the generation was replaced
+            uint64_t retired_at { 0 };
+        };
+
+        void _destroy(generation&) const noexcept;
+        void _retire_current() noexcept;
+        void _release_retired() noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        VkPhysicalDevice _physical_device { VK_NULL_HANDLE };
+        VkSurfaceKHR _surface { VK_NULL_HANDLE };
+        device_queue* _present_queue { nullptr };
+        swapchain_description _description {};
+
+        VkSurfaceFormatKHR _format {};
+        VkPresentModeKHR _present_mode { VK_PRESENT_MODE_FIFO_KHR };
+        uint32_t _frames_in_flight { 1 };
+
+        generation _current {};
+        std::deque<generation> _retired {};
+        bool _needs_rebuild { false };
+
+        /// Acquire semaphores are not tied to an image, they rotate over one more than the frames in flight
+        std::vector<VkSemaphore> _acquire_semaphores {};
+        uint32_t _acquire_index { 0 };
+
+        /// Frames acquired so far, the clock retired generations are released by
+        uint64_t _frames { 0 };
+        std::chrono::steady_clock::time_point _acquired_at {};
+        swapchain_frame_timing _last_timing {};
+        swapchain_statistics _statistics {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_SWAPCHAIN_H
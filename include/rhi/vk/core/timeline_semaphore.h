@@ -0,0 +1,47 @@
+#ifndef RHI_TIMELINE_SEMAPHORE_H
+#define RHI_TIMELINE_SEMAPHORE_H
+
+#include <cstdint>
+#include <string>
+
+#include "core/expected.h"
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// Semaphore carrying a monotonically increasing 64-bit value (Vulkan 1.2 or VK_KHR_timeline_semaphore).
+    /// The GPU signals values from queue submissions and the CPU can signal, wait on and poll them directly.
+    class timeline_semaphore final : public vulkan_object<VkSemaphore>
+    {
+    public:
+        [[nodiscard]] static expected<timeline_semaphore, std::string> create(VkDevice, uint64_t initial_value = 0) noexcept;
+
+        /// @brief Set the value from the host. It must be larger than the current value
+        [[nodiscard]] VkResult signal(uint64_t value) const noexcept;
+
+        /// @brief Block until the semaphore reaches the value
+        /// @return VK_SUCCESS once reached, VK_TIMEOUT if the timeout in nanoseconds expired first
+        [[nodiscard]] VkResult wait(uint64_t value, uint64_t timeout = UINT64_MAX) const noexcept;
+
+        /// @brief Current value. Returns 0 if the query failed, e.g. on device loss
+        [[nodiscard]] uint64_t value() const noexcept;
+
+        /// @brief Non-blocking check whether the GPU has reached the value
+        [[nodiscard]] bool is_reached(const uint64_t target) const noexcept { return value() >= target; }
+
+        auto destroy() noexcept -> void override;
+
+    private:
+        [[nodiscard]] timeline_semaphore() noexcept = default;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+
+        // Resolved once so the same code works with the core 1.2 entry points and the KHR aliases
+        PFN_vkWaitSemaphores _wait { nullptr };
+        PFN_vkSignalSemaphore _signal { nullptr };
+        PFN_vkGetSemaphoreCounterValue _get_value { nullptr };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_TIMELINE_SEMAPHORE_H
@@ -0,0 +1,116 @@
+#ifndef RHI_TRANSIENT_ALLOCATOR_H
+#define RHI_TRANSIENT_ALLOCATOR_H
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/memory_allocator.h"
+#include "vk/core/timeline_semaphore.h"
+
+namespace rhi::vk
+{
+    struct transient_allocator_description
+    {
+        /// Bytes available to each frame. 0 disables the allocator
+        VkDeviceSize frame_size { 4ull * 1024 * 1024 };
+        uint32_t frames_in_flight { 2 };
+        VkBufferUsageFlags usage {
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+            | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+            | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+        };
+    };
+
+    struct transient_allocation
+    {
+        VkBuffer buffer { VK_NULL_HANDLE };
+        VkDeviceSize offset { 0 };
+        VkDeviceSize size { 0 };
+        void* data { nullptr };
+    };
+
+    /// Persistently mapped buffer split into one linear region per frame in flight.
+    /// allocate() may be called from any thread and costs a single atomic add.
+    /// begin_frame()/end_frame() must be called from one thread while no allocations are in flight.
+    class transient_allocator
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<transient_allocator>, error> create(VkDevice, memory_allocator&, const physical_device&, const transient_allocator_description&) noexcept;
+
+        ~transient_allocator() noexcept = default;
+        transient_allocator(const transient_allocator&) = delete;
+        transient_allocator& operator=(const transient_allocator&) = delete;
+
+        /// @brief Allocate from the current frame, aligned to minUniformBufferOffsetAlignment
+        [[nodiscard]] std::optional<transient_allocation> allocate(VkDeviceSize size) noexcept;
+
+        /// @brief Allocate from the current frame with a stricter (power of two) alignment
+        [[nodiscard]] std::optional<transient_allocation> allocate(VkDeviceSize size, VkDeviceSize alignment) noexcept;
+
+        /// @brief Allocate and copy the bytes in one go
+        [[nodiscard]] std::optional<transient_allocation> push(std::span<const std::byte>) noexcept;
+
+        template <typename T>
+        requires std::is_trivially_copyable_v<T>
+        [[nodiscard]] std::optional<transient_allocation> push(const T& value) noexcept
+        {
+            return push(std::as_bytes(std::span { &value, 1 }));
+        }
+
+        /// @brief Move to the next frame region, waiting until the GPU is done with it
+        /// @return false if the timeout expired before the region was retired
+        [[nodiscard]] bool begin_frame(uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Mark the current region as owned by the GPU until the fence signals
+        void end_frame(VkFence) noexcept;
+
+        /// @brief Mark the current region as owned by the GPU until the timeline reaches the value.
+        /// The semaphore must outlive the allocator
+        void end_frame(const timeline_semaphore&, uint64_t value) noexcept;
+
+        [[nodiscard]] VkBuffer buffer() const noexcept { return _buffer; }
+        [[nodiscard]] VkDeviceSize alignment() const noexcept { return _alignment; }
+        [[nodiscard]] VkDeviceSize used() const noexcept;
+        [[nodiscard]] uint32_t frame_index() const noexcept { return _frame; }
+
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] transient_allocator() noexcept = default;
+
+        void _flush_frame() const noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        memory_allocator* _allocator { nullptr };
+
+        VkBuffer _buffer { VK_NULL_HANDLE };
+        memory_allocation _memory {};
+        std::byte* _data { nullptr };
+
+        VkDeviceSize _alignment { 1 };
+        VkDeviceSize _frame_size { 0 };
+        uint32_t _frame { 0 };
+
+        /// Bump offset relative to the start of the current frame region
+        std::atomic<VkDeviceSize> _head { 0 };
+
+        /// Fence guarding each frame region, VK_NULL_HANDLE when the region is free
+        std::vector<VkFence> _fences {};
+
+        /// Timeline value guarding each frame region, 0 when the region is free
+        std::vector<uint64_t> _retire_values {};
+        const timeline_semaphore* _timeline { nullptr };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_TRANSIENT_ALLOCATOR_H
@@ -0,0 +1,194 @@
+#ifndef RHI_UPLOAD_MANAGER_H
+#define RHI_UPLOAD_MANAGER_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/core/device_queue.h"
+#include "vk/core/memory_allocator.h"
+#include "vk/core/timeline_semaphore.h"
+
+namespace rhi::vk
+{
+    struct upload_manager_description
+    {
+        /// Size of the persistently mapped staging ring. 0 disables the manager
+        VkDeviceSize staging_size { 64ull * 1024 * 1024 };
+
+        /// Pending bytes that trigger a submit on their own. 0 only submits on flush() or when the ring is full
+        VkDeviceSize batch_size { 8ull * 1024 * 1024 };
+    };
+
+    /// Timeline value signalled once an upload has landed on the transfer queue
+    using upload_ticket = uint64_t;
+
+    struct buffer_upload_description
+    {
+        VkBuffer buffer { VK_NULL_HANDLE };
+        VkDeviceSize offset { 0 };
+
+        /// First use of the data on the consumer queue
+        VkPipelineStageFlags dst_stages { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkAccessFlags dst_access { VK_ACCESS_MEMORY_READ_BIT };
+    };
+
+    struct image_upload_description
+    {
+        VkImage image { VK_NULL_HANDLE };
+        VkImageSubresourceLayers subresource { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        VkOffset3D offset { 0, 0, 0 };
+        VkExtent3D extent { 1, 1, 1 };
+
+        /// Layout before the copy. UNDEFINED discards the previous contents
+        VkImageLayout initial_layout { VK_IMAGE_LAYOUT_UNDEFINED };
+        VkImageLayout final_layout { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+        VkPipelineStageFlags dst_stages { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+        VkAccessFlags dst_access { VK_ACCESS_SHADER_READ_BIT };
+    };
+
+    struct upload_statistics
+    {
+        uint64_t uploads { 0 };
+        uint64_t bytes { 0 };
+        uint64_t copy_commands { 0 };
+        uint64_t submits { 0 };
+
+        /// Times an upload had to wait for the GPU to free staging space
+        uint64_t stalls { 0 };
+    };
+
+    /// Streams data into device local buffers and images through a staging ring on the transfer queue.
+    /// Uploads are queued and coalesced per destination, then recorded and submitted as one batch that signals
+    /// a timeline value. When the transfer queue is on its own family the batch releases ownership and
+    /// record_acquires() performs the matching acquire on the consumer queue.
+    /// All methods are safe to call from multiple threads.
+    class upload_manager
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<upload_manager>, error> create(
+            VkDevice,
+            memory_allocator&,
+            const physical_device&,
+            device_queue& transfer_queue,
+            uint32_t consumer_family_index,
+            const upload_manager_description&
+        ) noexcept;
+
+        ~upload_manager() noexcept = default;
+        upload_manager(const upload_manager&) = delete;
+        upload_manager& operator=(const upload_manager&) = delete;
+
+        /// @brief Queue a copy into a buffer. Data larger than the ring is split across batches
+        [[nodiscard]] expected<upload_ticket, std::string> upload(const buffer_upload_description&, std::span<const std::byte>) noexcept;
+
+        /// @brief Queue a copy of tightly packed texels into an image region. The data has to fit in the ring
+        [[nodiscard]] expected<upload_ticket, std::string> upload(const image_upload_description&, std::span<const std::byte>) noexcept;
+
+        /// @brief Submit everything queued so far
+        /// @return ticket of the last batch, which covers every upload made before the call
+        [[nodiscard]] expected<upload_ticket, std::string> flush() noexcept;
+
+        /// @brief Non-blocking check whether the upload has landed
+        [[nodiscard]] bool is_complete(upload_ticket) const noexcept;
+
+        /// @brief Block until the upload has landed, submitting it first if it is still queued
+        [[nodiscard]] VkResult wait(upload_ticket, uint64_t timeout = UINT64_MAX) noexcept;
+
+        /// @brief Record the acquire barriers of every submitted upload not acquired yet into a command buffer
+        /// of the consumer family
+        /// @return timeline value the submission of that command buffer has to wait on, 0 if there was nothing to acquire
+        [[nodiscard]] upload_ticket record_acquires(VkCommandBuffer) noexcept;
+
+        [[nodiscard]] const timeline_semaphore& semaphore() const noexcept { return _timeline; }
+        [[nodiscard]] upload_statistics get_statistics() const noexcept;
+
+        /// @brief Wait for every submitted batch and release the resources
+        void destroy() noexcept;
+
+    private:
+        [[nodiscard]] explicit upload_manager(timeline_semaphore timeline) noexcept
+            : _timeline { timeline }
+        {}
+
+        struct buffer_copy
+        {
+            buffer_upload_description target {};
+            VkBufferCopy region {};
+        };
+
+        struct image_copy
+        {
+            image_upload_description target {};
+            VkBufferImageCopy region {};
+        };
+
+        struct batch
+        {
+            VkCommandBuffer cmd { VK_NULL_HANDLE };
+            upload_ticket ticket { 0 };
+
+            /// Ring position past the last staged byte of the batch
+            VkDeviceSize staging_end { 0 };
+        };
+
+        [[nodiscard]] expected<VkDeviceSize, std::string> _reserve(VkDeviceSize size) noexcept;
+        void _stage(VkDeviceSize offset, std::span<const std::byte>) const noexcept;
+        void _retire() noexcept;
+
+        [[nodiscard]] VkResult _submit() noexcept;
+        [[nodiscard]] VkResult _acquire_command_buffer(VkCommandBuffer&) noexcept;
+
+        /// @brief Record the queued copies and their release
+        /// @param buffers, images receive the acquires the consumer has to record once the batch is submitted
+        [[nodiscard]] VkResult _record(VkCommandBuffer, std::vector<buffer_ownership_transfer>& buffers, std::vector<image_ownership_transfer>& images) noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        memory_allocator* _allocator { nullptr };
+        device_queue* _queue { nullptr };
+        uint32_t _consumer_family_index { 0 };
+        VkDeviceSize _batch_size { 0 };
+
+        mutable std::mutex _mutex {};
+        timeline_semaphore _timeline;
+
+        /// Value the next batch signals. Every queued upload is tagged with it
+        upload_ticket _next_ticket { 1 };
+
+        VkBuffer _staging { VK_NULL_HANDLE };
+        memory_allocation _staging_memory {};
+        std::byte* _staging_data { nullptr };
+        VkDeviceSize _staging_size { 0 };
+        VkDeviceSize _alignment { 16 };
+
+        /// Monotonic ring positions. head - tail bytes are staged or in flight
+        VkDeviceSize _head { 0 };
+        VkDeviceSize _tail { 0 };
+        VkDeviceSize _pending_bytes { 0 };
+
+        std::vector<buffer_copy> _buffer_copies {};
+        std::vector<image_copy> _image_copies {};
+
+        VkCommandPool _pool { VK_NULL_HANDLE };
+        std::vector<VkCommandBuffer> _free_command_buffers {};
+        std::deque<batch> _in_flight {};
+
+        /// Ownership transfers released by submitted batches that the consumer queue still has to acquire
+        std::vector<buffer_ownership_transfer> _buffer_acquires {};
+        std::vector<image_ownership_transfer> _image_acquires {};
+        upload_ticket _acquire_ticket { 0 };
+
+        upload_statistics _statistics {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_UPLOAD_MANAGER_H
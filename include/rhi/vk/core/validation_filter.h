@@ -0,0 +1,83 @@
+#ifndef RHI_VALIDATION_FILTER_H
+#define RHI_VALIDATION_FILTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    struct validation_filter_settings
+    {
+        /// Messages with the same id logged per rate_window, the rest are only counted. 0 logs every message
+        uint32_t messages_per_window { 2 };
+        std::chrono::milliseconds rate_window { 5000 };
+
+        /// How often the counts of suppressed messages are logged. 0 turns the summary off
+        std::chrono::milliseconds summary_interval { 10000 };
+
+        /// Ids listed in one summary, the most suppressed first
+        uint32_t summary_entries { 8 };
+    };
+
+    struct validation_message_stats
+    {
+        /// messageIdNumber, 0 for messages without one. Those are told apart by name
+        int32_t id { 0 };
+        std::string name {};
+
+        /// Highest severity the id was reported with
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity { VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT };
+        uint64_t count { 0 };
+        uint64_t suppressed { 0 };
+    };
+
+    /// Counts debug messenger messages per id and decides which of them are logged. Every id gets a budget of
+    /// messages per time window, repeats beyond it are counted and reported in a periodic summary instead.
+    /// Drivers call the messenger from any thread, so every member function may be called concurrently
+    class validation_filter
+    {
+    public:
+        [[nodiscard]] explicit validation_filter(const validation_filter_settings& settings = {}) noexcept;
+
+        /// @brief Count the message and tell whether it should be logged. Logs the summary when it is due
+        [[nodiscard]] bool admit(const VkDebugUtilsMessengerCallbackDataEXT&, VkDebugUtilsMessageSeverityFlagBitsEXT) noexcept;
+
+        /// @brief Counts of every id seen so far, the most frequent first
+        [[nodiscard]] std::vector<validation_message_stats> stats() const noexcept;
+
+        [[nodiscard]] uint64_t total_messages() const noexcept;
+        [[nodiscard]] uint64_t total_suppressed() const noexcept;
+
+        /// @brief Log the ids suppressed since the last summary, if any
+        void log_summary() noexcept;
+
+    private:
+        struct entry
+        {
+            validation_message_stats stats {};
+            std::chrono::steady_clock::time_point window_start {};
+            uint32_t window_count { 0 };
+            uint64_t suppressed_since_summary { 0 };
+        };
+
+        /// @brief Build the summary and reset the per summary counts. Called with the mutex held
+        [[nodiscard]] std::string _take_summary(std::chrono::steady_clock::time_point now) noexcept;
+
+    private:
+        validation_filter_settings _settings {};
+
+        mutable std::mutex _mutex {};
+        std::unordered_map<uint64_t, entry> _entries {};
+        std::chrono::steady_clock::time_point _last_summary {};
+        uint64_t _total_messages { 0 };
+        uint64_t _total_suppressed { 0 };
+    };
+} // namespace rhi::vk
+
+#endif //RHI_VALIDATION_FILTER_H
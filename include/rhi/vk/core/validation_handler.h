@@ -9,6 +9,7 @@
 
 #include "core/expected.h"
 #include "vk/vulkan.h"
+#include "vk/core/name_table.h"
 
 namespace rhi::vk
 {
@@ -26,11 +27,15 @@ namespace rhi::vk
 
         [[nodiscard]] bool is_supported(const char*) const noexcept;
 
-        [[nodiscard]] expected<std::vector<const char*>, const char*> get_requested(std::span<requested_layer>) const noexcept;
+        /// @brief Resolve the requested layers, dropping duplicates and missing optional ones
+        /// @return Names owned by the handler, valid until the next call or the handler's destruction
+        [[nodiscard]] expected<std::span<const char* const>, const char*> get_requested(std::span<const requested_layer>) noexcept;
 
         [[nodiscard]] std::vector<validation_layer> get_layers() const noexcept { return _layers; }
     private:
         std::vector<validation_layer> _layers {};
+        name_table _names {};
+        std::vector<const char*> _enabled {};
     };
 } // namespace rhi::vk
 
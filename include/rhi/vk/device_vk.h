@@ -8,10 +8,27 @@
 
 #include "common/error.h"
 #include "core/expected.h"
+#include "core/thread_pool.h"
 #include "vk/vulkan.h"
+#include "vk/core/bindless_descriptor_heap.h"
+#include "vk/core/command_recorder.h"
+#include "vk/core/descriptor_allocator.h"
+#include "vk/core/device_queue.h"
+#include "vk/core/gpu_profiler.h"
+#include "vk/core/memory_allocator.h"
 #include "vk/core/physical_device_handler.h"
+#include "vk/core/pipeline_cache.h"
+#include "vk/core/pipeline_compiler.h"
+#include "vk/core/swapchain.h"
+#include "vk/core/transient_allocator.h"
+#include "vk/core/upload_manager.h"
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 namespace rhi::vk
 {
@@ -25,26 +42,160 @@ namespace rhi::vk
                 : _info{ device }
             {}
         public:
-            [[nodiscard]] expected<device, std::string> build() noexcept;
+            [[nodiscard]] expected<device, error> build() noexcept;
 
             [[nodiscard]] builder& request_extension(const char*) noexcept;
             [[nodiscard]] builder& request_extensions(const std::span<const char*>) noexcept;
 
             [[nodiscard]] builder& surface(const VkSurfaceKHR&) noexcept;
 
+            /// @brief Vulkan version of the instance. Caps which features and entry points the device uses
+            [[nodiscard]] builder& api_version(uint32_t) noexcept;
+
+            /// @brief Queues to create for graphics, async compute and transfer work
+            [[nodiscard]] builder& queues(const device_queue_description&) noexcept;
+
+            [[nodiscard]] builder& allocator(const memory_allocator_description&) noexcept;
+
+            [[nodiscard]] builder& transient_memory(const transient_allocator_description&) noexcept;
+
+            /// @brief Number of worker threads shared by the device subsystems. 0 picks one per hardware thread
+            [[nodiscard]] builder& worker_threads(uint32_t) noexcept;
+
+            [[nodiscard]] builder& command_recording(const command_recorder_description&) noexcept;
+
+            /// @brief Per-frame, per-thread descriptor pools for the non-bindless path
+            [[nodiscard]] builder& descriptors(const descriptor_allocator_description&) noexcept;
+
+            /// @brief Where the pipeline cache is persisted and how often it is written back. Without a directory it stays in memory
+            [[nodiscard]] builder& cache(const pipeline_cache_description&) noexcept;
+
+            /// @brief Staging ring used for uploads on the transfer queue. Needs timeline semaphores
+            [[nodiscard]] builder& uploads(const upload_manager_description&) noexcept;
+
+            /// @brief Enable descriptor indexing and create the device-wide bindless descriptor heap
+            [[nodiscard]] builder& bindless(const bindless_descriptor_heap_description& = {}) noexcept;
+
+            /// @brief Create the GPU profiler on the first graphics queue. Enables VK_EXT_calibrated_timestamps when the device has it
+            [[nodiscard]] builder& profiling(const gpu_profiler_description& = {}) noexcept;
+
         private:
             struct
             {
                 class physical_device physical_device;
                 std::vector<const char*> extensions {};
+
+                /// Names in extensions, for duplicate checks. Views into the caller's strings like extensions itself
+                std::unordered_set<std::string_view> extension_set {};
                 VkSurfaceKHR surface { VK_NULL_HANDLE };
+                uint32_t api_version { VK_API_VERSION_1_0 };
+                device_queue_description queues {};
+                memory_allocator_description allocator {};
+                transient_allocator_description transient_memory {};
+                uint32_t worker_threads { 0 };
+                command_recorder_description command_recording {};
+                descriptor_allocator_description descriptors {};
+                pipeline_cache_description cache {};
+                upload_manager_description uploads {};
+                std::optional<bindless_descriptor_heap_description> bindless {};
+                std::optional<gpu_profiler_description> profiling {};
             } _info {};
         };
 
+        /// @brief The allocator every buffer and image created from this device should draw memory from
+        [[nodiscard]] auto allocator() const noexcept -> memory_allocator& { return *_allocator; }
+
+        /// @brief Per-frame linear allocator for small uploads such as uniforms and dynamic vertex data
+        [[nodiscard]] auto transient_memory() const noexcept -> transient_allocator& { return *_transient_allocator; }
+
+        /// @brief Worker threads used for parallel recording and other fan-out work
+        [[nodiscard]] auto jobs() const noexcept -> thread_pool& { return *_jobs; }
+
+        /// @brief Per-thread command pools for the graphics queue family
+        [[nodiscard]] auto commands() const noexcept -> command_recorder& { return *_command_recorder; }
+
+        /// @brief Descriptor sets recycled per frame, plus the cache of set layouts
+        [[nodiscard]] auto descriptors() const noexcept -> descriptor_allocator& { return *_descriptor_allocator; }
+
+        /// @brief Pipeline cache loaded from disk at build time, pass it to every pipeline creation
+        [[nodiscard]] auto cache() const noexcept -> pipeline_cache& { return *_pipeline_cache; }
+
+        /// @brief Compiles pipelines in batches on the device worker threads
+        [[nodiscard]] auto pipelines() const noexcept -> pipeline_compiler& { return *_pipeline_compiler; }
+
+        /// @brief Batched staging uploads on the transfer queue, handed over to the graphics family.
+        /// Only available when has_upload_manager() is true
+        [[nodiscard]] auto uploads() const noexcept -> upload_manager& { return *_upload_manager; }
+        [[nodiscard]] auto has_upload_manager() const noexcept -> bool { return _upload_manager != nullptr; }
+
+        /// @brief Device-wide bindless descriptor set. Only available when has_bindless() is true
+        [[nodiscard]] auto bindless() const noexcept -> bindless_descriptor_heap& { return *_bindless; }
+        [[nodiscard]] auto has_bindless() const noexcept -> bool { return _bindless != nullptr; }
+
+        /// @brief Timestamp scopes of the graphics queue. Only available when has_profiler() is true
+        [[nodiscard]] auto profiler() const noexcept -> gpu_profiler& { return *_profiler; }
+        [[nodiscard]] auto has_profiler() const noexcept -> bool { return _profiler != nullptr; }
+
+        /// @brief Create a swapchain for the surface the device was built with. The caller destroys it before the device
+        [[nodiscard]] auto create_swapchain(const swapchain_description& = {}) noexcept -> expected<std::shared_ptr<swapchain>, error>;
+
+        /// @brief Surface the device was built for, VK_NULL_HANDLE when headless
+        [[nodiscard]] auto surface() const noexcept -> VkSurfaceKHR { return _surface; }
+
+        [[nodiscard]] auto graphics_queue(const uint32_t index = 0) const noexcept -> device_queue& { return *_graphics_queues[index % _graphics_queues.size()]; }
+
+        /// @brief Queue for async compute, on a compute-only family when the device has one
+        [[nodiscard]] auto compute_queue(const uint32_t index = 0) const noexcept -> device_queue& { return *_compute_queues[index % _compute_queues.size()]; }
+
+        /// @brief Queue for uploads and readbacks, on a transfer-only family when the device has one
+        [[nodiscard]] auto transfer_queue(const uint32_t index = 0) const noexcept -> device_queue& { return *_transfer_queues[index % _transfer_queues.size()]; }
+
+        /// @brief Queue that can present to the surface the device was built with. Null when headless
+        [[nodiscard]] auto present_queue() const noexcept -> device_queue* { return _present_queue.get(); }
+
+        [[nodiscard]] auto graphics_queue_count() const noexcept -> uint32_t { return static_cast<uint32_t>(_graphics_queues.size()); }
+        [[nodiscard]] auto compute_queue_count() const noexcept -> uint32_t { return static_cast<uint32_t>(_compute_queues.size()); }
+        [[nodiscard]] auto transfer_queue_count() const noexcept -> uint32_t { return static_cast<uint32_t>(_transfer_queues.size()); }
+
+        [[nodiscard]] auto graphics_family_index() const noexcept -> uint32_t { return _graphics_family_index; }
+        [[nodiscard]] auto compute_family_index() const noexcept -> uint32_t { return _compute_queues.front()->family_index(); }
+        [[nodiscard]] auto transfer_family_index() const noexcept -> uint32_t { return _transfer_queues.front()->family_index(); }
+
+        /// @brief Lower of the instance and physical device API versions
+        [[nodiscard]] auto api_version() const noexcept -> uint32_t { return _api_version; }
+
+        /// @brief Whether timeline_semaphore and frame_pacer can be created on this device
+        [[nodiscard]] auto supports_timeline_semaphores() const noexcept -> bool { return _timeline_semaphores; }
+
+        [[nodiscard]] auto get_physical_device() const noexcept -> const class physical_device& { return _physical_device; }
+
         auto destroy() noexcept -> void override;
 
     private:
         // VkDevice _device { VK_NULL_HANDLE };
+        class physical_device _physical_device {};
+        VkSurfaceKHR _surface { VK_NULL_HANDLE };
+        uint32_t _graphics_family_index { 0 };
+        uint32_t _api_version { VK_API_VERSION_1_0 };
+        bool _timeline_semaphores { false };
+
+        // Roles that fall back to the same family point at the same device_queue, so they share its lock
+        std::vector<std::shared_ptr<device_queue>> _graphics_queues {};
+        std::vector<std::shared_ptr<device_queue>> _compute_queues {};
+        std::vector<std::shared_ptr<device_queue>> _transfer_queues {};
+        std::shared_ptr<device_queue> _present_queue { nullptr };
+
+        // Shared so that copies handed out by the instance refer to the same allocator
+        std::shared_ptr<memory_allocator> _allocator { nullptr };
+        std::shared_ptr<transient_allocator> _transient_allocator { nullptr };
+        std::shared_ptr<thread_pool> _jobs { nullptr };
+        std::shared_ptr<command_recorder> _command_recorder { nullptr };
+        std::shared_ptr<descriptor_allocator> _descriptor_allocator { nullptr };
+        std::shared_ptr<pipeline_cache> _pipeline_cache { nullptr };
+        std::shared_ptr<pipeline_compiler> _pipeline_compiler { nullptr };
+        std::shared_ptr<upload_manager> _upload_manager { nullptr };
+        std::shared_ptr<bindless_descriptor_heap> _bindless { nullptr };
+        std::shared_ptr<gpu_profiler> _profiler { nullptr };
     };
 } // namespace rhi::vk
 
@@ -4,6 +4,9 @@
 
 #ifndef RHI_INSTANCE_VK_H
 #define RHI_INSTANCE_VK_H
+#include <chrono>
+#include <filesystem>
+#include <future>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -19,19 +22,16 @@
 
 namespace rhi::vk
 {
-    enum class surface_create_error
+    /// Wall time spent in each phase of instance::builder::build()
+    struct instance_build_timings
     {
-        INVALID_WINDOW_DATA_NOT_WIN32,
-        INVALID_WINDOW_DATA_NOT_XLIB,
-        INVALID_WINDOW_DATA_NOT_METAL,
-        INVALID_WINDOW_DATA_NOT_WAYLAND,
-        CREATE_SURFACE_FAILED
-    };
-
-    enum class device_create_error
-    {
-        INVALID_PHYSICAL_DEVICE,
-        CREATION_FAILED
+        std::chrono::nanoseconds extensions { 0 };
+        std::chrono::nanoseconds instance_creation { 0 };
+        std::chrono::nanoseconds surface_creation { 0 };
+        std::chrono::nanoseconds messenger_creation { 0 };
+        std::chrono::nanoseconds device_enumeration { 0 };
+        std::chrono::nanoseconds device_selection { 0 };
+        std::chrono::nanoseconds total { 0 };
     };
 
     class instance final : public vulkan_object<VkInstance>
@@ -42,6 +42,9 @@ namespace rhi::vk
         public:
             [[nodiscard]] expected<instance, error> build() const noexcept;
 
+            /// @brief Run build() on another thread so the caller can load assets, open windows etc. meanwhile
+            [[nodiscard]] std::future<expected<instance, error>> build_async() const noexcept;
+
             [[nodiscard]] builder& enable_debug() noexcept
             {
                 _info.enable_debug = true;
@@ -81,6 +84,41 @@ namespace rhi::vk
                 return *this;
             }
 
+            /// @brief Highest Vulkan version the application wants. The instance uses the lower of this and what the loader supports
+            [[nodiscard]] builder& api_version(const uint32_t version) noexcept
+            {
+                _info.api_version = version;
+                return *this;
+            }
+
+            /// @brief Only consider devices with descriptor indexing and give created devices a bindless descriptor heap
+            [[nodiscard]] builder& bindless(const bool enabled = true) noexcept
+            {
+                _info.bindless = enabled;
+                return *this;
+            }
+
+            /// @brief Keep the capabilities of every GPU in the directory, so later runs skip most device queries
+            [[nodiscard]] builder& capability_cache(const std::filesystem::path& directory) noexcept
+            {
+                _info.capability_cache_directory = directory;
+                return *this;
+            }
+
+            /// @brief Weights used to rank the suitable devices. create_device() without an id takes the best one
+            [[nodiscard]] builder& device_scoring(const device_score_weights& weights) noexcept
+            {
+                _info.score_weights = weights;
+                return *this;
+            }
+
+            /// @brief How often repeats of the same validation message are logged while debug is enabled
+            [[nodiscard]] builder& validation_message_limits(const validation_filter_settings& settings) noexcept
+            {
+                _info.validation_limits = settings;
+                return *this;
+            }
+
         private:
             struct
             {
@@ -88,6 +126,11 @@ namespace rhi::vk
                 std::vector<std::string> extensions {};
                 std::optional<window_data> window {};
                 bool headless { false };
+                uint32_t api_version { VK_API_VERSION_1_2 };
+                bool bindless { false };
+                std::filesystem::path capability_cache_directory {};
+                device_score_weights score_weights {};
+                validation_filter_settings validation_limits {};
             } _info {};
         };
 
@@ -97,13 +140,22 @@ namespace rhi::vk
         instance(instance&&) = default;
         instance& operator=(instance&&) noexcept = default;
 
-        [[nodiscard]] auto create_surface(const window_data&) const noexcept -> expected<VkSurfaceKHR, surface_create_error>;
+        [[nodiscard]] auto create_surface(const window_data&) const noexcept -> expected<VkSurfaceKHR, error>;
 
-        /// @brief Create a device from the instance. This overload chooses the first suitable physical device
-        [[nodiscard]] auto create_device() noexcept -> expected<class device, std::string>;
+        /// @brief Create a device from the instance. This overload chooses the highest scoring suitable physical device
+        [[nodiscard]] auto create_device() noexcept -> expected<class device, error>;
 
         /// @brief Create a device from the instance. This overload chooses the physical device with the specified id (Assuming it is valid)
-        [[nodiscard]] auto create_device(uint32_t physical_device_id) noexcept -> expected<class device, std::string>;
+        [[nodiscard]] auto create_device(uint32_t physical_device_id) noexcept -> expected<class device, error>;
+
+        /// @brief Vulkan version the instance was created with
+        [[nodiscard]] auto api_version() const noexcept -> uint32_t { return _api_version; }
+
+        /// @brief Time each phase of the build took
+        [[nodiscard]] auto build_timings() const noexcept -> const instance_build_timings& { return _build_timings; }
+
+        /// @brief Per id counts of the validation messages reported so far, nullptr when debug is disabled
+        [[nodiscard]] auto validation_messages() const noexcept -> const validation_filter* { return _validation_filter.get(); }
 
         /// @brief Destroy the instance and the objects it handles
         auto destroy() noexcept -> void override;
@@ -115,9 +167,15 @@ namespace rhi::vk
 
         // VkInstance instance { VK_NULL_HANDLE };
         VkSurfaceKHR _surface { VK_NULL_HANDLE };
+        uint32_t _api_version { VK_API_VERSION_1_0 };
+        bool _bindless { false };
+        instance_build_timings _build_timings {};
 
         std::vector<class physical_device> _suitable_devices {};
         std::unique_ptr<debug_messenger> _debug_messenger { nullptr };
+
+        /// Shared with the messenger callbacks through pUserData, kept past vkDestroyInstance which still reports
+        std::shared_ptr<validation_filter> _validation_filter { nullptr };
         std::vector<const char*> _device_extensions {};
         std::vector<const char*> _validation_layers {};
         std::vector<device> _managed_devices {};
@@ -0,0 +1,237 @@
+#ifndef RHI_RENDER_GRAPH_H
+#define RHI_RENDER_GRAPH_H
+#ifdef BACKEND_USE_VULKAN
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/expected.h"
+#include "vk/vulkan.h"
+#include "vk/device_vk.h"
+
+namespace rhi::vk
+{
+    /// How a pass touches a resource. Each value fixes the pipeline stages, access mask and, for images, the layout
+    enum class resource_usage
+    {
+        COLOR_ATTACHMENT,
+        DEPTH_ATTACHMENT,
+        DEPTH_READ,
+        FRAGMENT_SAMPLED,
+        COMPUTE_SAMPLED,
+        COMPUTE_STORAGE_READ,
+        COMPUTE_STORAGE_WRITE,
+        TRANSFER_SRC,
+        TRANSFER_DST,
+        VERTEX_BUFFER,
+        INDEX_BUFFER,
+        INDIRECT_BUFFER,
+        UNIFORM_BUFFER,
+        PRESENT,
+    };
+
+    struct image_handle
+    {
+        uint32_t index { UINT32_MAX };
+        [[nodiscard]] bool is_valid() const noexcept { return index != UINT32_MAX; }
+    };
+
+    struct buffer_handle
+    {
+        uint32_t index { UINT32_MAX };
+        [[nodiscard]] bool is_valid() const noexcept { return index != UINT32_MAX; }
+    };
+
+    /// Image owned by the graph. Its memory may be shared with other transient images whose lifetimes do not overlap
+    struct transient_image_description
+    {
+        std::string name {};
+        VkFormat format { VK_FORMAT_UNDEFINED };
+        VkExtent2D extent { 0, 0 };
+        VkSampleCountFlagBits samples { VK_SAMPLE_COUNT_1_BIT };
+        VkImageAspectFlags aspect { VK_IMAGE_ASPECT_COLOR_BIT };
+    };
+
+    struct imported_image_description
+    {
+        std::string name {};
+        VkImage image { VK_NULL_HANDLE };
+        VkImageView view { VK_NULL_HANDLE };
+        VkImageSubresourceRange range { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        VkImageLayout initial_layout { VK_IMAGE_LAYOUT_UNDEFINED };
+
+        /// Layout the image is left in after the last pass. UNDEFINED keeps whatever the last pass used
+        VkImageLayout final_layout { VK_IMAGE_LAYOUT_UNDEFINED };
+    };
+
+    struct imported_buffer_description
+    {
+        std::string name {};
+        VkBuffer buffer { VK_NULL_HANDLE };
+        VkDeviceSize offset { 0 };
+        VkDeviceSize size { VK_WHOLE_SIZE };
+    };
+
+    struct render_graph_description
+    {
+        /// Record barriers with vkCmdPipelineBarrier2. Only valid if the device enabled synchronization2
+        bool use_synchronization2 { false };
+    };
+
+    struct render_graph_statistics
+    {
+        uint32_t pass_count { 0 };
+        uint32_t culled_pass_count { 0 };
+        uint32_t barrier_batch_count { 0 };
+        uint32_t image_barrier_count { 0 };
+        uint32_t buffer_barrier_count { 0 };
+
+        /// Memory the transient images would need without aliasing and what they actually got
+        VkDeviceSize transient_bytes_requested { 0 };
+        VkDeviceSize transient_bytes_allocated { 0 };
+    };
+
+    class render_graph;
+
+    /// Handed to a pass setup function to declare what the pass reads and writes
+    class pass_builder
+    {
+    public:
+        pass_builder& read(image_handle, resource_usage) noexcept;
+        pass_builder& write(image_handle, resource_usage) noexcept;
+        pass_builder& read(buffer_handle, resource_usage) noexcept;
+        pass_builder& write(buffer_handle, resource_usage) noexcept;
+
+        /// @brief Keep the pass even if nothing reads its outputs, e.g. it writes to host visible memory
+        pass_builder& side_effect() noexcept;
+
+    private:
+        friend class render_graph;
+        pass_builder(render_graph& graph, uint32_t pass) noexcept
+            : _graph { graph }
+            , _pass { pass }
+        {}
+
+        render_graph& _graph;
+        uint32_t _pass;
+    };
+
+    /// Frame graph recorded on top of a device. Passes declare their resource accesses, compile() culls passes
+    /// whose results are never consumed, places transient images into shared memory and computes one barrier
+    /// batch per pass. execute() then records the barriers and the pass callbacks into a command buffer.
+    class render_graph
+    {
+    public:
+        using setup_function = std::function<void(pass_builder&)>;
+        using execute_function = std::function<void(VkCommandBuffer, const render_graph&)>;
+
+        [[nodiscard]] explicit render_graph(device&, const render_graph_description& = {}) noexcept;
+        ~render_graph() noexcept = default;
+
+        render_graph(const render_graph&) = delete;
+        render_graph& operator=(const render_graph&) = delete;
+
+        [[nodiscard]] image_handle create_image(const transient_image_description&) noexcept;
+        [[nodiscard]] image_handle import_image(const imported_image_description&) noexcept;
+        [[nodiscard]] buffer_handle import_buffer(const imported_buffer_description&) noexcept;
+
+        void add_pass(std::string name, const setup_function& setup, execute_function execute) noexcept;
+
+        /// @brief Cull, allocate transient images and compute barriers. Must be called before execute()
+        [[nodiscard]] expected<render_graph_statistics, std::string> compile() noexcept;
+
+        /// @brief Record every live pass and its barriers into the command buffer
+        void execute(VkCommandBuffer) const noexcept;
+
+        [[nodiscard]] VkImage image(image_handle) const noexcept;
+        [[nodiscard]] VkImageView image_view(image_handle) const noexcept;
+        [[nodiscard]] VkBuffer buffer(buffer_handle) const noexcept;
+
+        /// @brief Destroy transient images and forget every pass and resource so the graph can be rebuilt
+        void reset() noexcept;
+
+    private:
+        friend class pass_builder;
+
+        struct resource_access
+        {
+            uint32_t resource;
+            bool is_image;
+            bool is_write;
+            resource_usage usage;
+        };
+
+        struct pass
+        {
+            std::string name {};
+            execute_function execute {};
+            std::vector<resource_access> accesses {};
+            bool side_effect { false };
+            bool culled { false };
+            uint32_t barrier_batch { UINT32_MAX };
+        };
+
+        struct image_resource
+        {
+            std::string name {};
+            bool is_imported { false };
+            transient_image_description transient {};
+            imported_image_description external {};
+
+            VkImage image { VK_NULL_HANDLE };
+            VkImageView view { VK_NULL_HANDLE };
+            VkImageSubresourceRange range {};
+
+            /// Live pass range, in declaration order, that uses the image
+            uint32_t first_pass { UINT32_MAX };
+            uint32_t last_pass { 0 };
+
+            VkDeviceSize memory_offset { 0 };
+            VkDeviceSize memory_size { 0 };
+            uint32_t memory_group { 0 };
+        };
+
+        struct buffer_resource
+        {
+            imported_buffer_description imported {};
+        };
+
+        struct barrier_batch
+        {
+            std::vector<VkImageMemoryBarrier2> images {};
+            std::vector<VkBufferMemoryBarrier2> buffers {};
+        };
+
+        void _cull() noexcept;
+        [[nodiscard]] expected<bool, std::string> _allocate_transients() noexcept;
+        void _build_barriers() noexcept;
+        void _record_barriers(VkCommandBuffer, const barrier_batch&) const noexcept;
+        void _destroy_transients() noexcept;
+
+    private:
+        VkDevice _device { VK_NULL_HANDLE };
+        memory_allocator* _allocator { nullptr };
+        render_graph_description _description {};
+
+        std::vector<pass> _passes {};
+        std::vector<image_resource> _images {};
+        std::vector<buffer_resource> _buffers {};
+
+        std::vector<barrier_batch> _batches {};
+
+        /// Barriers after the last pass that move imported images into their final layout
+        barrier_batch _final_batch {};
+
+        /// One allocation per group of transient images with compatible memory types
+        std::vector<memory_allocation> _memory {};
+
+        render_graph_statistics _statistics {};
+        bool _compiled { false };
+    };
+} // namespace rhi::vk
+
+#endif // BACKEND_USE_VULKAN
+
+#endif //RHI_RENDER_GRAPH_H
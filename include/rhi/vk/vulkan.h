@@ -11,7 +11,7 @@
 
 #ifdef BACKEND_USE_VULKAN
 
-#ifdef RHI_PLATFORM_LINUX
+#if defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
 #define VK_USE_PLATFORM_XLIB_KHR
 #define VK_NO_PLATFORM_XCB_KHR
 #elif defined(RHI_PLATFORM_WINDOWS)
@@ -0,0 +1,59 @@
+#include "common/error.h"
+
+namespace rhi
+{
+    std::string_view error::message() const noexcept
+    {
+        switch (id)
+        {
+        case message_id::MISSING_VALIDATION_LAYER:
+            return "Required validation layer is missing";
+        case message_id::MISSING_INSTANCE_EXTENSION:
+            return "Required instance extension is missing";
+        case message_id::CREATE_INSTANCE_FAILED:
+            return "vkCreateInstance failed";
+        case message_id::WINDOW_DATA_MISMATCH:
+            return "Window data does not match the platform";
+        case message_id::UNSUPPORTED_WINDOW_PLATFORM:
+            return "Surfaces are not supported on this platform";
+        case message_id::CREATE_SURFACE_FAILED:
+            return "Surface creation failed";
+        case message_id::DEBUG_EXTENSION_MISSING:
+            return "Debug utils extension is not present";
+        case message_id::CREATE_DEBUG_MESSENGER_FAILED:
+            return "Debug messenger creation failed";
+        case message_id::NO_SUITABLE_DEVICE:
+            return "No suitable physical devices found";
+        case message_id::DEVICE_ID_NOT_FOUND:
+            return "No suitable physical device has the requested id";
+        case message_id::SURFACE_CAPABILITIES_FAILED:
+            return "Failed to retrieve device surface capabilities";
+        case message_id::BINDLESS_UNSUPPORTED:
+            return "Device does not support the descriptor indexing features bindless descriptors need";
+        case message_id::CREATE_DEVICE_FAILED:
+            return "vkCreateDevice failed";
+        case message_id::TRANSIENT_ALLOCATOR_FAILED:
+            return "Failed to create transient allocator";
+        case message_id::COMMAND_RECORDER_FAILED:
+            return "Failed to create command recorder";
+        case message_id::DESCRIPTOR_ALLOCATOR_FAILED:
+            return "Failed to create descriptor allocator";
+        case message_id::PIPELINE_CACHE_FAILED:
+            return "Failed to create pipeline cache";
+        case message_id::BINDLESS_HEAP_FAILED:
+            return "Failed to create bindless descriptor heap";
+        case message_id::UPLOAD_MANAGER_FAILED:
+            return "Failed to create upload manager";
+        case message_id::NO_PRESENT_SURFACE:
+            return "Device was built without a surface it can present to";
+        case message_id::CREATE_SWAPCHAIN_FAILED:
+            return "Failed to create swapchain";
+        case message_id::GPU_PROFILER_FAILED:
+            return "Failed to create GPU profiler";
+        case message_id::UNKNOWN:
+            break;
+        }
+
+        return "[UNKNOWN RHI ERROR]";
+    }
+} // namespace rhi
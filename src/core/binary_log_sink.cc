@@ -0,0 +1,265 @@
+#include "core/binary_log_sink.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/binary_log.h"
+#include "core/format.h"
+
+#ifdef RHI_PLATFORM_WINDOWS
+#include "core/win32.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace rhi::log
+{
+    namespace
+    {
+        std::atomic<uint64_t> g_next_generation { 1 };
+
+        /// Records start on 8 byte boundaries so their headers can be read in place
+        constexpr size_t align_record(const size_t size) noexcept
+        {
+            return (size + 7) & ~size_t { 7 };
+        }
+
+        void commit(binary::record_header* header) noexcept
+        {
+            std::atomic_ref { header->committed }.store(1, std::memory_order_release);
+        }
+    }
+
+    expected<std::shared_ptr<binary_log_sink>, std::string> binary_log_sink::create(const std::filesystem::path& path, size_t capacity) noexcept
+    {
+        capacity = align_record(std::max(capacity, sizeof(binary::file_header) + 4096));
+        std::shared_ptr<binary_log_sink> sink { new binary_log_sink() };
+
+#ifdef RHI_PLATFORM_WINDOWS
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return unexpected(format_str("Failed to create binary log {}: error {}", path.string(), GetLastError()));
+        }
+        sink->_file = file;
+
+        LARGE_INTEGER size {};
+        size.QuadPart = static_cast<LONGLONG>(capacity);
+        if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+        {
+            return unexpected(format_str("Failed to size binary log {} to {} bytes: error {}", path.string(), capacity, GetLastError()));
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            return unexpected(format_str("Failed to map binary log {}: error {}", path.string(), GetLastError()));
+        }
+        sink->_mapping = mapping;
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+        if (data == nullptr)
+        {
+            return unexpected(format_str("Failed to map binary log {}: error {}", path.string(), GetLastError()));
+        }
+#else
+        const int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file < 0)
+        {
+            return unexpected(format_str("Failed to create binary log {}: {}", path.string(), std::strerror(errno)));
+        }
+        sink->_file = file;
+
+        if (::ftruncate(file, static_cast<off_t>(capacity)) != 0)
+        {
+            return unexpected(format_str("Failed to size binary log {} to {} bytes: {}", path.string(), capacity, std::strerror(errno)));
+        }
+
+        void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED)
+        {
+            return unexpected(format_str("Failed to map binary log {}: {}", path.string(), std::strerror(errno)));
+        }
+#endif
+
+        sink->_data = static_cast<std::byte*>(data);
+        sink->_capacity = capacity;
+        sink->_start = std::chrono::steady_clock::now();
+        sink->_generation = g_next_generation.fetch_add(1, std::memory_order_relaxed);
+
+        const auto start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        const binary::file_header header {
+            .magic = binary::FILE_MAGIC,
+            .version = binary::FILE_VERSION,
+            .header_size = sizeof(binary::file_header),
+            .capacity = capacity,
+            .end = sizeof(binary::file_header),
+            .start_time = static_cast<uint64_t>(start_time.count()),
+        };
+        std::memcpy(sink->_data, &header, sizeof(header));
+
+        return ok(std::move(sink));
+    }
+
+    binary_log_sink::~binary_log_sink() noexcept
+    {
+        const uint64_t used = _data != nullptr ? std::min<uint64_t>(_end(), _capacity) : 0;
+
+#ifdef RHI_PLATFORM_WINDOWS
+        if (_data != nullptr)
+        {
+            FlushViewOfFile(_data, 0);
+            UnmapViewOfFile(_data);
+        }
+
+        if (_mapping != nullptr)
+        {
+            CloseHandle(_mapping);
+        }
+
+        if (_file != nullptr)
+        {
+            if (used > 0)
+            {
+                LARGE_INTEGER size {};
+                size.QuadPart = static_cast<LONGLONG>(used);
+                SetFilePointerEx(_file, size, nullptr, FILE_BEGIN);
+                SetEndOfFile(_file);
+            }
+            CloseHandle(_file);
+        }
+#else
+        if (_data != nullptr)
+        {
+            ::msync(_data, _capacity, MS_SYNC);
+            ::munmap(_data, _capacity);
+        }
+
+        if (_file >= 0)
+        {
+            if (used > 0)
+            {
+                [[maybe_unused]] const int result = ::ftruncate(_file, static_cast<off_t>(used));
+            }
+            ::close(_file);
+        }
+#endif
+    }
+
+    void binary_log_sink::write(const level record_level, const std::string_view format, const std::span<const std::byte> arguments, const uint8_t argument_count) noexcept
+    {
+        const uint32_t format_id = _intern(format);
+        if (format_id == 0)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const size_t size = sizeof(binary::record_header) + sizeof(binary::message_record) + arguments.size();
+        std::byte* record = _reserve(size);
+        if (record == nullptr)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+        const binary::message_record message {
+            .format_id = format_id,
+            .thread_id = thread_id(),
+            .timestamp = static_cast<uint64_t>(timestamp.count()),
+        };
+        std::memcpy(record + sizeof(binary::record_header), &message, sizeof(message));
+        std::memcpy(record + sizeof(binary::record_header) + sizeof(message), arguments.data(), arguments.size());
+
+        auto* header = reinterpret_cast<binary::record_header*>(record);
+        header->kind = binary::record_kind::MESSAGE;
+        header->level = static_cast<uint8_t>(record_level);
+        header->argument_count = argument_count;
+        commit(header);
+    }
+
+    void binary_log_sink::flush() noexcept
+    {
+#ifdef RHI_PLATFORM_WINDOWS
+        FlushViewOfFile(_data, 0);
+#else
+        ::msync(_data, _capacity, MS_SYNC);
+#endif
+    }
+
+    uint32_t binary_log_sink::_intern(const std::string_view format) noexcept
+    {
+        // Call sites pass literals, so after the first record the id comes from a lock free per thread lookup
+        thread_local struct
+        {
+            uint64_t generation { 0 };
+            std::unordered_map<const char*, uint32_t> ids {};
+        } cache;
+
+        if (cache.generation != _generation)
+        {
+            cache.generation = _generation;
+            cache.ids.clear();
+        }
+
+        if (const auto it = cache.ids.find(format.data()); it != cache.ids.end())
+        {
+            return it->second;
+        }
+
+        std::lock_guard lock { _formats_mutex };
+        auto [it, inserted] = _format_ids.try_emplace(format.data(), 0);
+        if (inserted)
+        {
+            // The definition is in the file before any record that refers to it can be reserved
+            const size_t size = sizeof(binary::record_header) + sizeof(binary::format_record) + format.size();
+            std::byte* record = _reserve(size);
+            if (record == nullptr)
+            {
+                _format_ids.erase(it);
+                return 0;
+            }
+
+            it->second = static_cast<uint32_t>(_format_ids.size());
+            const binary::format_record definition {
+                .id = it->second,
+                .length = static_cast<uint32_t>(format.size()),
+            };
+            std::memcpy(record + sizeof(binary::record_header), &definition, sizeof(definition));
+            std::memcpy(record + sizeof(binary::record_header) + sizeof(definition), format.data(), format.size());
+
+            auto* header = reinterpret_cast<binary::record_header*>(record);
+            header->kind = binary::record_kind::FORMAT;
+            header->level = 0;
+            header->argument_count = 0;
+            commit(header);
+        }
+
+        cache.ids.emplace(format.data(), it->second);
+        return it->second;
+    }
+
+    std::byte* binary_log_sink::_reserve(const size_t size) noexcept
+    {
+        const size_t aligned = align_record(size);
+        const uint64_t offset = std::atomic_ref { _end() }.fetch_add(aligned, std::memory_order_relaxed);
+        if (offset + aligned > _capacity)
+        {
+            return nullptr;
+        }
+
+        std::byte* record = _data + offset;
+        const auto record_size = static_cast<uint32_t>(aligned);
+        std::memcpy(record, &record_size, sizeof(record_size));
+        return record;
+    }
+
+    uint64_t& binary_log_sink::_end() const noexcept
+    {
+        return reinterpret_cast<binary::file_header*>(_data)->end;
+    }
+} // namespace rhi::log
@@ -0,0 +1,77 @@
+#ifndef RHI_BINARY_LOG_SINK_H
+#define RHI_BINARY_LOG_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "core/defines.h"
+#include "core/expected.h"
+#include "core/log.h"
+
+namespace rhi::log
+{
+    /// Writes records in the rhi/core/binary_log.h layout to a memory mapped file of fixed capacity.
+    /// Writers reserve space with one atomic add on the file header and copy their record in without a lock.
+    /// A format string is written to the file the first time its call site logs, later records carry its id
+    class binary_log_sink
+    {
+    public:
+        [[nodiscard]] static expected<std::shared_ptr<binary_log_sink>, std::string> create(const std::filesystem::path&, size_t capacity) noexcept;
+
+        /// @brief Flush the mapping and cut the file down to the records written
+        ~binary_log_sink() noexcept;
+
+        binary_log_sink(const binary_log_sink&) = delete;
+        binary_log_sink& operator=(const binary_log_sink&) = delete;
+
+        /// @brief Append a record. It is dropped and counted when the file is full
+        /// @param format A string literal, its address identifies the call site
+        /// @param arguments Encoded by binary::argument_encoder
+        void write(level, std::string_view format, std::span<const std::byte> arguments, uint8_t argument_count) noexcept;
+
+        /// @brief Ask the OS to write the mapped pages to disk
+        void flush() noexcept;
+
+        [[nodiscard]] uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+
+    private:
+        [[nodiscard]] binary_log_sink() noexcept = default;
+
+        [[nodiscard]] uint32_t _intern(std::string_view format) noexcept;
+
+        /// @brief Claim size bytes of the file, nullptr when it is full
+        [[nodiscard]] std::byte* _reserve(size_t size) noexcept;
+
+        [[nodiscard]] uint64_t& _end() const noexcept;
+
+    private:
+#ifdef RHI_PLATFORM_WINDOWS
+        void* _file { nullptr };
+        void* _mapping { nullptr };
+#else
+        int _file { -1 };
+#endif
+        std::byte* _data { nullptr };
+        size_t _capacity { 0 };
+        std::chrono::steady_clock::time_point _start {};
+
+        /// Distinguishes this sink in the per thread format caches from earlier ones at the same address
+        uint64_t _generation { 0 };
+
+        std::mutex _formats_mutex {};
+        std::unordered_map<const char*, uint32_t> _format_ids {};
+
+        std::atomic<uint64_t> _dropped { 0 };
+    };
+} // namespace rhi::log
+
+#endif //RHI_BINARY_LOG_SINK_H
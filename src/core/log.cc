@@ -1,21 +1,73 @@
 #include "core/log.h"
 
+#include <memory>
+#include <mutex>
+
+#include "core/binary_log_sink.h"
+#include "core/log_queue.h"
+
 namespace rhi::log
 {
     struct log_info
     {
-        bool should_print { true };
-        bool debug_print { false };
         std::ostream* out { &std::cout };
         std::ostream* err { &std::cerr };
+        record_tags tags { .start = std::chrono::steady_clock::now() };
+
+        /// Held only for the single write of a composed line, the line itself is built without it
+        std::mutex write_mutex {};
+        std::unique_ptr<log_queue> queue { nullptr };
+        std::shared_ptr<binary_log_sink> binary { nullptr };
     } g_log_info {};
 
     void log_initializer::init() const noexcept
     {
+        // Destroying the old queue writes whatever it still holds to the old streams
+        g_log_info.queue.reset();
+        detail::g_binary_enabled.store(false, std::memory_order_relaxed);
+        if (g_log_info.binary && g_log_info.binary->dropped() > 0)
+        {
+            detail::write(level::WARN, format_str("Binary log was full, dropped {} messages", g_log_info.binary->dropped()));
+        }
+        g_log_info.binary.reset();
+
         g_log_info.out = _detail.out;
         g_log_info.err = _detail.err;
-        g_log_info.should_print = _detail.should_print;
-        g_log_info.debug_print = _detail.debug_print;
+        g_log_info.tags = record_tags {
+            .timestamp = _detail.timestamps,
+            .thread_id = _detail.thread_ids,
+            .start = std::chrono::steady_clock::now(),
+        };
+        uint32_t enabled_levels { 0 };
+        for (uint32_t bit = static_cast<uint32_t>(_detail.minimum); bit <= static_cast<uint32_t>(level::FATAL); bit++)
+        {
+            enabled_levels |= 1u << bit;
+        }
+
+        if (!_detail.debug_print)
+        {
+            enabled_levels &= ~(1u << static_cast<uint32_t>(level::DEBUG));
+        }
+
+        detail::g_enabled_levels.store(_detail.should_print ? enabled_levels : 0, std::memory_order_relaxed);
+
+        if (_detail.async)
+        {
+            g_log_info.queue = std::make_unique<log_queue>(_detail.queue_capacity, _detail.overflow, g_log_info.tags, _detail.out, _detail.err);
+        }
+
+        if (!_detail.binary_path.empty())
+        {
+            auto sink_exp = binary_log_sink::create(_detail.binary_path, _detail.binary_capacity);
+            if (!sink_exp.has_value())
+            {
+                detail::write(level::ERR, format_str("Falling back to text logging: {}", sink_exp.unwrap_error()));
+                return;
+            }
+
+            g_log_info.binary = std::move(sink_exp).unwrap();
+            detail::g_binary_enabled.store(true, std::memory_order_relaxed);
+        }
     }
 
     log_initializer& log_initializer::set_out(std::ostream& out) noexcept
@@ -42,39 +94,96 @@ namespace rhi::log
         return *this;
     }
 
-    void info_impl(const std::string_view message) noexcept
+    log_initializer& log_initializer::print_timestamps(const bool should_print_timestamps) noexcept
+    {
+        _detail.timestamps = should_print_timestamps;
+        return *this;
+    }
+
+    log_initializer& log_initializer::print_thread_ids(const bool should_print_thread_ids) noexcept
+    {
+        _detail.thread_ids = should_print_thread_ids;
+        return *this;
+    }
+
+    log_initializer& log_initializer::runtime_level(const level minimum) noexcept
     {
-        if (g_log_info.should_print)
-            (*g_log_info.out) << "[INFO]  " << message << '\n';
+        _detail.minimum = minimum;
+        return *this;
     }
 
-    void trace_impl(const std::string_view message) noexcept
+    log_initializer& log_initializer::set_binary(const std::filesystem::path& path, const size_t capacity) noexcept
     {
-        if (g_log_info.should_print)
-            (*g_log_info.out) << "[TRACE] " << message << '\n';
+        _detail.binary_path = path;
+        _detail.binary_capacity = capacity;
+        return *this;
     }
 
-    void debug_impl(const std::string_view message) noexcept
+    log_initializer& log_initializer::async(const bool enabled, const size_t queue_capacity, const overflow_policy overflow) noexcept
     {
-        if (g_log_info.should_print && g_log_info.debug_print)
-            (*g_log_info.out) << "[DEBUG] " << message << '\n';
+        _detail.async = enabled;
+        _detail.queue_capacity = queue_capacity;
+        _detail.overflow = overflow;
+        return *this;
     }
 
-    void warn_impl(const std::string_view message) noexcept
+    void flush() noexcept
     {
-        if (g_log_info.should_print)
-            (*g_log_info.out) << "[WARN]  " << message << '\n';
+        if (g_log_info.binary)
+        {
+            g_log_info.binary->flush();
+        }
+
+        if (g_log_info.queue)
+        {
+            g_log_info.queue->flush();
+            return;
+        }
+
+        g_log_info.out->flush();
+        g_log_info.err->flush();
     }
 
-    void error_impl(const std::string_view message) noexcept
+    uint32_t thread_id() noexcept
     {
-        if (g_log_info.should_print)
-            (*g_log_info.err) << "[ERROR] " << message << '\n';
+        static std::atomic<uint32_t> next_id { 1 };
+        thread_local const uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    std::chrono::steady_clock::time_point start_time() noexcept
+    {
+        return g_log_info.tags.start;
+    }
+
+    void detail::write(const level record_level, const std::string_view message) noexcept
+    {
+        // The whole line is built in a buffer the thread reuses, then leaves it in one write so records never interleave
+        thread_local std::string line {};
+        compose_record(line, g_log_info.tags, record_level, message);
+
+        if (g_log_info.queue)
+        {
+            // A fatal record is likely the last one before the process dies, it must reach the stream first
+            const bool fatal = record_level == level::FATAL;
+            g_log_info.queue->push(record_level, line, fatal);
+            if (fatal)
+            {
+                g_log_info.queue->flush();
+            }
+            return;
+        }
+
+        std::lock_guard lock { g_log_info.write_mutex };
+        stream_for(record_level, *g_log_info.out, *g_log_info.err).write(line.data(), static_cast<std::streamsize>(line.size()));
     }
 
-    void fatal_impl(const std::string_view message) noexcept
+    void detail::write_binary(const level record_level, const std::string_view format, const std::span<const std::byte> arguments, const uint8_t argument_count) noexcept
     {
-        if (g_log_info.should_print)
-            (*g_log_info.err) << "[FATAL] " << message << '\n';
+        g_log_info.binary->write(record_level, format, arguments, argument_count);
+        if (record_level == level::FATAL)
+        {
+            g_log_info.binary->flush();
+        }
     }
-}
\ No newline at end of file
+}
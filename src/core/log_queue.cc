@@ -0,0 +1,171 @@
+#include "core/log_queue.h"
+
+#include <bit>
+#include <charconv>
+
+namespace rhi::log
+{
+    void compose_record(std::string& line, const record_tags& tags, const level record_level, const std::string_view message) noexcept
+    {
+        constexpr std::string_view prefixes[] = { "[TRACE] ", "[DEBUG] ", "[INFO]  ", "[WARN]  ", "[ERROR] ", "[FATAL] " };
+
+        line.clear();
+        char digits[24];
+        if (tags.timestamp)
+        {
+            // Seconds and microseconds since init(), the same clock and shape the binary log decoder prints
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tags.start).count();
+            line += "[+";
+            line.append(digits, std::to_chars(digits, digits + sizeof(digits), elapsed / 1000000).ptr);
+            line += '.';
+            const auto micros = std::to_chars(digits, digits + sizeof(digits), 1000000 + elapsed % 1000000).ptr;
+            line.append(digits + 1, micros);
+            line += "] ";
+        }
+
+        if (tags.thread_id)
+        {
+            line += "[T";
+            line.append(digits, std::to_chars(digits, digits + sizeof(digits), thread_id()).ptr);
+            line += "] ";
+        }
+
+        line += prefixes[static_cast<uint8_t>(record_level)];
+        line += message;
+        line += '\n';
+    }
+
+    log_queue::log_queue(const size_t capacity, const overflow_policy overflow, const record_tags& tags, std::ostream* out, std::ostream* err) noexcept
+        : _overflow { overflow }
+        , _tags { tags }
+        , _out { out }
+        , _err { err }
+    {
+        // Slot indices are masked, so the capacity is rounded up to a power of two
+        const size_t slot_count = std::bit_ceil(std::max<size_t>(capacity, 2));
+        _mask = slot_count - 1;
+        _slots = std::make_unique<slot[]>(slot_count);
+        for (size_t i = 0; i < slot_count; i++)
+        {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        _thread = std::thread([this]() { _drain_loop(); });
+    }
+
+    log_queue::~log_queue() noexcept
+    {
+        _stopping.store(true, std::memory_order_release);
+        _wake.fetch_add(1, std::memory_order_release);
+        _wake.notify_one();
+        _thread.join();
+    }
+
+    bool log_queue::push(const level record_level, const std::string_view line, const bool must_deliver) noexcept
+    {
+        size_t position = _enqueue_position.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& target = _slots[position & _mask];
+            const size_t sequence = target.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0)
+            {
+                if (_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    target.record_level = record_level;
+                    target.line.assign(line);
+                    target.sequence.store(position + 1, std::memory_order_release);
+
+                    _wake.fetch_add(1, std::memory_order_release);
+                    _wake.notify_one();
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The consumer has not freed this slot yet, the queue is full
+                if (_overflow == overflow_policy::DROP && !must_deliver)
+                {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                std::this_thread::yield();
+                position = _enqueue_position.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                // Another producer claimed the slot first
+                position = _enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void log_queue::flush() noexcept
+    {
+        const size_t target = _enqueue_position.load(std::memory_order_acquire);
+
+        size_t written = _written.load(std::memory_order_acquire);
+        while (written < target)
+        {
+            _written.wait(written, std::memory_order_acquire);
+            written = _written.load(std::memory_order_acquire);
+        }
+    }
+
+    void log_queue::_drain_loop() noexcept
+    {
+        size_t position { 0 };
+        while (true)
+        {
+            const uint32_t wake = _wake.load(std::memory_order_acquire);
+
+            bool wrote { false };
+            while (true)
+            {
+                slot& source = _slots[position & _mask];
+                if (source.sequence.load(std::memory_order_acquire) != position + 1)
+                {
+                    break;
+                }
+
+                _write(source.record_level, source.line);
+                source.sequence.store(position + _mask + 1, std::memory_order_release);
+                position++;
+                wrote = true;
+            }
+
+            if (const uint64_t dropped = _dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+            {
+                std::string line {};
+                compose_record(line, _tags, level::WARN, format_str("Log queue full, dropped {} messages", dropped));
+                _write(level::WARN, line);
+                wrote = true;
+            }
+
+            if (wrote)
+            {
+                _out->flush();
+                _err->flush();
+                _written.store(position, std::memory_order_release);
+                _written.notify_all();
+                continue;
+            }
+
+            // Every push before the stop request has been written once a pass finds the queue empty
+            if (_stopping.load(std::memory_order_acquire) && _enqueue_position.load(std::memory_order_acquire) == position)
+            {
+                return;
+            }
+
+            _wake.wait(wake, std::memory_order_acquire);
+        }
+    }
+
+    void log_queue::_write(const level record_level, const std::string_view line) const noexcept
+    {
+        stream_for(record_level, *_out, *_err).write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+} // namespace rhi::log
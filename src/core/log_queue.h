@@ -0,0 +1,90 @@
+#ifndef RHI_LOG_QUEUE_H
+#define RHI_LOG_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "core/log.h"
+
+namespace rhi::log
+{
+    /// Tags every text sink puts in front of a record
+    struct record_tags
+    {
+        bool timestamp { true };
+        bool thread_id { true };
+
+        /// Timestamps count from here
+        std::chrono::steady_clock::time_point start {};
+    };
+
+    /// Bounded multi-producer, single-consumer queue of complete record lines and the thread that writes them.
+    /// Producers claim a slot with one compare-exchange and never take a lock (Vyukov's bounded queue).
+    /// The consumer writes to the streams and flushes them whenever it runs dry
+    class log_queue
+    {
+    public:
+        [[nodiscard]] log_queue(size_t capacity, overflow_policy, const record_tags&, std::ostream* out, std::ostream* err) noexcept;
+
+        /// @brief Write everything still queued and stop the thread
+        ~log_queue() noexcept;
+
+        log_queue(const log_queue&) = delete;
+        log_queue& operator=(const log_queue&) = delete;
+
+        /// @brief Queue a line made by compose_record. Returns false if it was dropped because the queue was full
+        /// @param must_deliver Wait for room even under overflow_policy::DROP
+        bool push(level, std::string_view line, bool must_deliver = false) noexcept;
+
+        /// @brief Block until every record pushed before the call has been written and the streams flushed
+        void flush() noexcept;
+
+    private:
+        struct alignas(64) slot
+        {
+            std::atomic<size_t> sequence { 0 };
+            level record_level { level::INFO };
+            std::string line {};
+        };
+
+        void _drain_loop() noexcept;
+        void _write(level, std::string_view line) const noexcept;
+
+    private:
+        std::unique_ptr<slot[]> _slots { nullptr };
+        size_t _mask { 0 };
+        overflow_policy _overflow { overflow_policy::DROP };
+        record_tags _tags {};
+        std::ostream* _out { nullptr };
+        std::ostream* _err { nullptr };
+
+        alignas(64) std::atomic<size_t> _enqueue_position { 0 };
+
+        /// Records written and flushed so far, what flush() waits on
+        alignas(64) std::atomic<size_t> _written { 0 };
+
+        /// Bumped on every push so the consumer can sleep on it while the queue is empty
+        std::atomic<uint32_t> _wake { 0 };
+        std::atomic<uint64_t> _dropped { 0 };
+        std::atomic<bool> _stopping { false };
+
+        std::thread _thread {};
+    };
+
+    /// @brief Replace line with the complete text of a record: tags, level, message and newline
+    void compose_record(std::string& line, const record_tags&, level, std::string_view message) noexcept;
+
+    /// @brief The stream records of the level go to
+    [[nodiscard]] inline std::ostream& stream_for(const level record_level, std::ostream& out, std::ostream& err) noexcept
+    {
+        return record_level >= level::ERR ? err : out;
+    }
+} // namespace rhi::log
+
+#endif //RHI_LOG_QUEUE_H
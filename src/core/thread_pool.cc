@@ -0,0 +1,187 @@
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <latch>
+
+namespace rhi
+{
+    namespace
+    {
+        struct worker_identity
+        {
+            const thread_pool* pool { nullptr };
+            uint32_t index { 0 };
+        };
+
+        thread_local worker_identity t_worker {};
+    }
+
+    thread_pool::thread_pool(uint32_t thread_count) noexcept
+    {
+        if (thread_count == 0)
+        {
+            // hardware_concurrency() may report 0, clamp before subtracting so it cannot wrap
+            thread_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        // Queues must all exist before the first worker starts stealing
+        _queues.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            _queues.push_back(std::make_unique<worker_queue>());
+        }
+
+        _threads.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            _threads.emplace_back([this, i]() { _worker_loop(i); });
+        }
+    }
+
+    thread_pool::~thread_pool() noexcept
+    {
+        {
+            std::lock_guard lock { _sleep_mutex };
+            _stopping = true;
+        }
+        _condition.notify_all();
+
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    uint32_t thread_pool::worker_index() const noexcept
+    {
+        return t_worker.pool == this ? t_worker.index : size();
+    }
+
+    void thread_pool::_enqueue(std::function<void()> task) noexcept
+    {
+        uint32_t index = worker_index();
+        if (index == size())
+        {
+            index = _next_queue.fetch_add(1, std::memory_order_relaxed) % size();
+        }
+
+        {
+            worker_queue& queue = *_queues[index];
+            std::lock_guard lock { queue.mutex };
+            queue.tasks.push_back(std::move(task));
+        }
+
+        // Taking the sleep mutex orders the increment against a worker that is about to check it and sleep
+        {
+            std::lock_guard lock { _sleep_mutex };
+            _pending.fetch_add(1, std::memory_order_release);
+        }
+        _condition.notify_one();
+    }
+
+    bool thread_pool::_run_one(const uint32_t index) noexcept
+    {
+        std::function<void()> task {};
+
+        if (index < size())
+        {
+            worker_queue& own = *_queues[index];
+            std::lock_guard lock { own.mutex };
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+
+        for (uint32_t offset = 1; !task && offset <= size(); ++offset)
+        {
+            worker_queue& victim = *_queues[(index + offset) % size()];
+            std::lock_guard lock { victim.mutex };
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+        {
+            return false;
+        }
+
+        _pending.fetch_sub(1, std::memory_order_relaxed);
+        task();
+
+        return true;
+    }
+
+    void thread_pool::_worker_loop(const uint32_t index) noexcept
+    {
+        t_worker = { this, index };
+
+        while (true)
+        {
+            if (_run_one(index))
+            {
+                continue;
+            }
+
+            std::unique_lock lock { _sleep_mutex };
+            _condition.wait(lock, [this]() { return _stopping || _pending.load(std::memory_order_acquire) > 0; });
+
+            if (_stopping && _pending.load(std::memory_order_acquire) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void thread_pool::parallel_for(const uint32_t count, const std::function<void(uint32_t)>& function) noexcept
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::atomic<uint32_t> next { 0 };
+        const uint32_t helpers = std::min(count - 1, size());
+        std::latch done { helpers };
+
+        const auto drain = [&next, count, &function]()
+        {
+            for (uint32_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                function(i);
+            }
+        };
+
+        for (uint32_t i = 0; i < helpers; ++i)
+        {
+            _enqueue([&drain, &done]()
+            {
+                drain();
+                done.count_down();
+            });
+        }
+
+        drain();
+
+        // A worker blocking here could starve the helpers queued behind it, so it keeps executing tasks instead.
+        // Threads outside the pool only wait: they are not allowed to pick up work that assumes a worker slot.
+        if (const uint32_t index = worker_index(); index < size())
+        {
+            while (!done.try_wait())
+            {
+                if (!_run_one(index))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        else
+        {
+            done.wait();
+        }
+    }
+} // namespace rhi
@@ -0,0 +1,314 @@
+#include "vk/core/bindless_descriptor_heap.h"
+
+#include <algorithm>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr VkDescriptorType descriptor_types[] = {
+            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_DESCRIPTOR_TYPE_SAMPLER,
+        };
+
+        constexpr uint64_t pack_head(const uint64_t tag, const uint32_t index) noexcept
+        {
+            return (tag << 32) | index;
+        }
+
+        uint32_t clamp_to_limit(const char* name, const uint32_t requested, const uint32_t limit) noexcept
+        {
+            if (limit != 0 && requested > limit)
+            {
+                log::warn("Bindless {} table reduced from {} to the device limit of {}", name, requested, limit);
+                return limit;
+            }
+
+            return requested;
+        }
+
+        /// Zero means the limit was not reported, so the other one applies
+        [[nodiscard]] uint32_t tightest_limit(const uint32_t per_set, const uint32_t per_stage) noexcept
+        {
+            if (per_set == 0 || per_stage == 0)
+            {
+                return std::max(per_set, per_stage);
+            }
+
+            return std::min(per_set, per_stage);
+        }
+    }
+
+    void bindless_descriptor_heap::index_stack::init(const uint32_t count) noexcept
+    {
+        capacity = count;
+        next.reset(new std::atomic<uint32_t>[count]);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            next[i].store(i + 1 < count ? i + 1 : invalid_index, std::memory_order_relaxed);
+        }
+        head.store(pack_head(0, count > 0 ? 0 : invalid_index), std::memory_order_release);
+    }
+
+    std::optional<uint32_t> bindless_descriptor_heap::index_stack::pop() noexcept
+    {
+        uint64_t current = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            const auto index = static_cast<uint32_t>(current);
+            if (index == invalid_index)
+            {
+                return std::nullopt;
+            }
+
+            // The slot may be popped and pushed back by another thread meanwhile, the tag makes the exchange fail then
+            const uint32_t next_index = next[index].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(current, pack_head((current >> 32) + 1, next_index), std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return index;
+            }
+        }
+    }
+
+    void bindless_descriptor_heap::index_stack::push(const uint32_t index) noexcept
+    {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        do
+        {
+            next[index].store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(current, pack_head((current >> 32) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    expected<std::shared_ptr<bindless_descriptor_heap>, error> bindless_descriptor_heap::create(
+        const VkDevice device,
+        const physical_device& physical_device,
+        const bindless_descriptor_heap_description& description
+    ) noexcept
+    {
+        const auto& support = physical_device.get_descriptor_indexing();
+        if (!support.is_bindless_capable())
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::BINDLESS_UNSUPPORTED).with_context(physical_device.name()));
+        }
+
+        // Every table is visible to all the stages in the description, so each must also fit a single stage
+        uint32_t counts[table_count] = {
+            clamp_to_limit("sampled image", description.sampled_image_count,
+                tightest_limit(support.max_update_after_bind_sampled_images, support.max_per_stage_update_after_bind_sampled_images)),
+            clamp_to_limit("storage buffer", description.storage_buffer_count,
+                tightest_limit(support.max_update_after_bind_storage_buffers, support.max_per_stage_update_after_bind_storage_buffers)),
+            clamp_to_limit("sampler", description.sampler_count,
+                tightest_limit(support.max_update_after_bind_samplers, support.max_per_stage_update_after_bind_samplers)),
+        };
+
+        // Images and buffers also share one per-stage resource budget, split between them in the requested proportion
+        const uint64_t resources = static_cast<uint64_t>(counts[0]) + counts[1];
+        if (const uint32_t limit = support.max_per_stage_update_after_bind_resources; limit != 0 && resources > limit)
+        {
+            const auto images = static_cast<uint32_t>(counts[0] * static_cast<uint64_t>(limit) / resources);
+            log::warn("Bindless sampled image and storage buffer tables reduced from {} and {} to {} and {} to fit the per-stage limit of {} resources",
+                counts[0], counts[1], images, limit - images, limit);
+            counts[0] = images;
+            counts[1] = limit - images;
+        }
+
+        std::shared_ptr<bindless_descriptor_heap> heap { new bindless_descriptor_heap() };
+        heap->_device = device;
+
+        VkDescriptorSetLayoutBinding bindings[table_count] {};
+        VkDescriptorBindingFlags binding_flags[table_count] {};
+        VkDescriptorPoolSize pool_sizes[table_count] {};
+        for (uint32_t table = 0; table < table_count; table++)
+        {
+            bindings[table] = VkDescriptorSetLayoutBinding {
+                .binding = table,
+                .descriptorType = descriptor_types[table],
+                .descriptorCount = counts[table],
+                .stageFlags = description.stages,
+                .pImmutableSamplers = nullptr,
+            };
+
+            // Slots that were never written or were freed stay unbound, only the ones shaders index must be valid
+            binding_flags[table] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+            pool_sizes[table] = VkDescriptorPoolSize { .type = descriptor_types[table], .descriptorCount = counts[table] };
+
+            heap->_tables[table].init(counts[table]);
+        }
+
+        const VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .pNext = nullptr,
+            .bindingCount = table_count,
+            .pBindingFlags = binding_flags,
+        };
+
+        const VkDescriptorSetLayoutCreateInfo layout_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = &flags_info,
+            .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+            .bindingCount = table_count,
+            .pBindings = bindings,
+        };
+
+        if (const VkResult result = vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &heap->_layout); !vk_check(result))
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::BINDLESS_HEAP_FAILED, result).with_context("vkCreateDescriptorSetLayout"));
+        }
+
+        const VkDescriptorPoolCreateInfo pool_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .maxSets = 1,
+            .poolSizeCount = table_count,
+            .pPoolSizes = pool_sizes,
+        };
+
+        if (const VkResult result = vkCreateDescriptorPool(device, &pool_info, nullptr, &heap->_pool); !vk_check(result))
+        {
+            heap->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::BINDLESS_HEAP_FAILED, result).with_context("vkCreateDescriptorPool"));
+        }
+
+        const VkDescriptorSetAllocateInfo allocate_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = heap->_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &heap->_layout,
+        };
+
+        if (const VkResult result = vkAllocateDescriptorSets(device, &allocate_info, &heap->_set); !vk_check(result))
+        {
+            heap->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::BINDLESS_HEAP_FAILED, result).with_context("vkAllocateDescriptorSets"));
+        }
+
+        log::debug("Created bindless descriptor heap: {} sampled images, {} storage buffers, {} samplers.", counts[0], counts[1], counts[2]);
+
+        return ok(std::move(heap));
+    }
+
+    std::optional<uint32_t> bindless_descriptor_heap::add_sampled_image(const VkImageView view, const VkImageLayout layout) noexcept
+    {
+        const auto index = _tables[static_cast<uint32_t>(bindless_table::SAMPLED_IMAGE)].pop();
+        if (index.has_value())
+        {
+            update_sampled_image(index.value(), view, layout);
+        }
+
+        return index;
+    }
+
+    std::optional<uint32_t> bindless_descriptor_heap::add_storage_buffer(const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize range) noexcept
+    {
+        const auto index = _tables[static_cast<uint32_t>(bindless_table::STORAGE_BUFFER)].pop();
+        if (index.has_value())
+        {
+            update_storage_buffer(index.value(), buffer, offset, range);
+        }
+
+        return index;
+    }
+
+    std::optional<uint32_t> bindless_descriptor_heap::add_sampler(const VkSampler sampler) noexcept
+    {
+        const auto index = _tables[static_cast<uint32_t>(bindless_table::SAMPLER)].pop();
+        if (index.has_value())
+        {
+            update_sampler(index.value(), sampler);
+        }
+
+        return index;
+    }
+
+    void bindless_descriptor_heap::update_sampled_image(const uint32_t index, const VkImageView view, const VkImageLayout layout) noexcept
+    {
+        const VkDescriptorImageInfo image_info { .sampler = VK_NULL_HANDLE, .imageView = view, .imageLayout = layout };
+        _write(bindless_table::SAMPLED_IMAGE, index, &image_info, nullptr);
+    }
+
+    void bindless_descriptor_heap::update_storage_buffer(const uint32_t index, const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize range) noexcept
+    {
+        const VkDescriptorBufferInfo buffer_info { .buffer = buffer, .offset = offset, .range = range };
+        _write(bindless_table::STORAGE_BUFFER, index, nullptr, &buffer_info);
+    }
+
+    void bindless_descriptor_heap::update_sampler(const uint32_t index, const VkSampler sampler) noexcept
+    {
+        const VkDescriptorImageInfo image_info { .sampler = sampler, .imageView = VK_NULL_HANDLE, .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED };
+        _write(bindless_table::SAMPLER, index, &image_info, nullptr);
+    }
+
+    void bindless_descriptor_heap::free(const bindless_table table, const uint32_t index, const uint64_t retire_value) noexcept
+    {
+        std::lock_guard lock { _retired_mutex };
+        _retired.push_back(retired_slot { .table = table, .index = index, .retire_value = retire_value });
+    }
+
+    void bindless_descriptor_heap::collect(const uint64_t completed_value) noexcept
+    {
+        std::lock_guard lock { _retired_mutex };
+
+        const auto first_pending = std::partition(_retired.begin(), _retired.end(), [completed_value](const retired_slot& slot)
+        {
+            return slot.retire_value <= completed_value;
+        });
+
+        for (auto slot = _retired.begin(); slot != first_pending; ++slot)
+        {
+            _tables[static_cast<uint32_t>(slot->table)].push(slot->index);
+        }
+
+        _retired.erase(_retired.begin(), first_pending);
+    }
+
+    void bindless_descriptor_heap::_write(
+        const bindless_table table,
+        const uint32_t index,
+        const VkDescriptorImageInfo* image_info,
+        const VkDescriptorBufferInfo* buffer_info
+    ) noexcept
+    {
+        const auto binding = static_cast<uint32_t>(table);
+
+        const VkWriteDescriptorSet write {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = _set,
+            .dstBinding = binding,
+            .dstArrayElement = index,
+            .descriptorCount = 1,
+            .descriptorType = descriptor_types[binding],
+            .pImageInfo = image_info,
+            .pBufferInfo = buffer_info,
+            .pTexelBufferView = nullptr,
+        };
+
+        std::lock_guard lock { _write_mutex };
+        vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+    }
+
+    void bindless_descriptor_heap::destroy() noexcept
+    {
+        if (_pool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(_device, _pool, nullptr);
+            _pool = VK_NULL_HANDLE;
+            _set = VK_NULL_HANDLE;
+        }
+
+        if (_layout != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorSetLayout(_device, _layout, nullptr);
+            _layout = VK_NULL_HANDLE;
+        }
+
+        _retired.clear();
+    }
+} // namespace rhi::vk
@@ -0,0 +1,136 @@
+#include "vk/core/cache_file.h"
+
+#include <fstream>
+
+#include "core/format.h"
+#include "core/log.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        /// Written in front of the payload so truncated or foreign files are caught before anyone parses them
+        struct cache_file_header
+        {
+            cache_file_identity identity;
+            uint64_t data_size;
+            uint64_t data_hash;
+        };
+    }
+
+    uint64_t fnv1a(const std::span<const std::byte> bytes) noexcept
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const std::byte byte : bytes)
+        {
+            hash ^= static_cast<uint64_t>(byte);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    std::string cache_file_name(const std::string_view prefix, const VkPhysicalDeviceProperties& properties) noexcept
+    {
+        constexpr char digits[] = "0123456789abcdef";
+
+        std::string uuid {};
+        uuid.reserve(VK_UUID_SIZE * 2);
+        for (const uint8_t byte : properties.pipelineCacheUUID)
+        {
+            uuid.push_back(digits[byte >> 4]);
+            uuid.push_back(digits[byte & 0xf]);
+        }
+
+        return format_str("{}_{:04x}_{:04x}_{}.bin", prefix, properties.vendorID, properties.deviceID, uuid);
+    }
+
+    std::optional<std::vector<std::byte>> read_validated(
+        const std::filesystem::path& path,
+        const cache_file_identity& identity,
+        const std::string_view description
+    ) noexcept
+    {
+        std::ifstream file { path, std::ios::binary | std::ios::ate };
+        if (!file.is_open())
+        {
+            return std::nullopt;
+        }
+
+        const std::streamsize file_size = file.tellg();
+        if (file_size < static_cast<std::streamsize>(sizeof(cache_file_header)))
+        {
+            log::warn("Ignoring truncated {} {}", description, path.string());
+            return std::nullopt;
+        }
+
+        cache_file_header header {};
+        std::vector<std::byte> data(static_cast<size_t>(file_size) - sizeof(header));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || !file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+        {
+            log::warn("Failed to read {} {}", description, path.string());
+            return std::nullopt;
+        }
+
+        if (header.identity.magic != identity.magic || header.identity.version != identity.version)
+        {
+            log::warn("Ignoring {} {} with an unknown format", description, path.string());
+            return std::nullopt;
+        }
+
+        if (header.identity.driver_version != identity.driver_version || header.identity.api_version != identity.api_version)
+        {
+            log::debug("Ignoring {} {} written by another driver version", description, path.string());
+            return std::nullopt;
+        }
+
+        if (header.data_size != data.size() || header.data_hash != fnv1a(data))
+        {
+            log::warn("Ignoring corrupt {} {}", description, path.string());
+            return std::nullopt;
+        }
+
+        return data;
+    }
+
+    bool write_atomically(
+        const std::filesystem::path& path,
+        const cache_file_identity& identity,
+        const std::span<const std::byte> data,
+        const std::string_view description
+    ) noexcept
+    {
+        const cache_file_header header {
+            .identity = identity,
+            .data_size = data.size(),
+            .data_hash = fnv1a(data),
+        };
+
+        std::filesystem::path temporary = path;
+        temporary += ".tmp";
+
+        {
+            std::ofstream file { temporary, std::ios::binary | std::ios::trunc };
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file.good())
+            {
+                log::error("Failed to write {} {}", description, temporary.string());
+                return false;
+            }
+        }
+
+        std::error_code error {};
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            log::error("Failed to replace {} {}: {}", description, path.string(), error.message());
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        return true;
+    }
+} // namespace rhi::vk
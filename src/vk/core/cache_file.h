@@ -0,0 +1,52 @@
+#ifndef RHI_CACHE_FILE_H
+#define RHI_CACHE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vk/vulkan.h"
+
+namespace rhi::vk
+{
+    /// Who wrote a cache file. A file is only read back by a reader with the same identity, so a
+    /// format change or a driver update turns an old file into a miss instead of garbage
+    struct cache_file_identity
+    {
+        uint32_t magic { 0 };
+        uint32_t version { 0 };
+        uint32_t driver_version { 0 };
+        uint32_t api_version { 0 };
+    };
+
+    /// 64-bit FNV-1a, used to catch files that were damaged on disk
+    [[nodiscard]] uint64_t fnv1a(std::span<const std::byte>) noexcept;
+
+    /// @brief "<prefix>_<vendor>_<device>_<pipelineCacheUUID>.bin", one file per GPU and driver build
+    [[nodiscard]] std::string cache_file_name(std::string_view prefix, const VkPhysicalDeviceProperties&) noexcept;
+
+    /// @brief Payload of a cache file written by write_atomically() with the same identity
+    /// @param description what the file holds, e.g. "pipeline cache", used to log why a file is ignored
+    /// @return std::nullopt if the file is missing, truncated, written by another identity or corrupt
+    [[nodiscard]] std::optional<std::vector<std::byte>> read_validated(
+        const std::filesystem::path&,
+        const cache_file_identity&,
+        std::string_view description
+    ) noexcept;
+
+    /// @brief Write the payload behind a header carrying the identity, its size and hash. The file is written
+    /// next to the target and renamed over it, so a crash mid-write never leaves a torn cache behind
+    bool write_atomically(
+        const std::filesystem::path&,
+        const cache_file_identity&,
+        std::span<const std::byte> data,
+        std::string_view description
+    ) noexcept;
+} // namespace rhi::vk
+
+#endif //RHI_CACHE_FILE_H
@@ -0,0 +1,228 @@
+#include "vk/core/command_recorder.h"
+
+#include <algorithm>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    expected<std::shared_ptr<command_recorder>, error> command_recorder::create(
+        const VkDevice device,
+        const uint32_t queue_family_index,
+        std::shared_ptr<thread_pool> workers,
+        const command_recorder_description& description
+    ) noexcept
+    {
+        if (workers == nullptr || description.frames_in_flight == 0)
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::COMMAND_RECORDER_FAILED).with_context("needs a thread pool and a non-zero frame count"));
+        }
+
+        std::shared_ptr<command_recorder> recorder { new command_recorder() };
+        recorder->_device = device;
+        recorder->_queue_family_index = queue_family_index;
+        recorder->_frames_in_flight = description.frames_in_flight;
+        recorder->_slots_per_frame = workers->size() + 1;
+        recorder->_workers = std::move(workers);
+        recorder->_slots.resize(static_cast<size_t>(recorder->_slots_per_frame) * description.frames_in_flight);
+
+        const VkCommandPoolCreateInfo pool_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = queue_family_index,
+        };
+
+        for (auto& slot : recorder->_slots)
+        {
+            if (const VkResult result = vkCreateCommandPool(device, &pool_info, nullptr, &slot.pool); !vk_check(result))
+            {
+                recorder->destroy();
+                return unexpected(error(error::code::DEVICE_FAIL, error::message_id::COMMAND_RECORDER_FAILED, result).with_context("vkCreateCommandPool"));
+            }
+        }
+
+        log::debug("Created command recorder: {} frames x {} command pools on queue family {}.",
+            recorder->_frames_in_flight, recorder->_slots_per_frame, queue_family_index);
+
+        return ok(std::move(recorder));
+    }
+
+    VkResult command_recorder::begin_frame(const uint32_t frame_index) noexcept
+    {
+        _frame = frame_index % _frames_in_flight;
+
+        // Resetting the pool recycles every buffer allocated from it at once
+        for (uint32_t worker = 0; worker < _slots_per_frame; ++worker)
+        {
+            pool_slot& slot = _slot(worker);
+            if (const VkResult result = vkResetCommandPool(_device, slot.pool, 0); !vk_check(result))
+            {
+                return result;
+            }
+
+            slot.used_primaries = 0;
+            slot.used_secondaries = 0;
+        }
+
+        return VK_SUCCESS;
+    }
+
+    expected<VkCommandBuffer, std::string> command_recorder::begin_primary() noexcept
+    {
+        const uint32_t worker = _workers->worker_index();
+        const bool external = worker >= _workers->size();
+
+        // Threads outside the pool share the last slot, and with it one command pool
+        std::unique_lock lock { _external_mutex, std::defer_lock };
+        if (external)
+        {
+            lock.lock();
+        }
+
+        VkCommandBuffer command_buffer { VK_NULL_HANDLE };
+        if (const VkResult result = _acquire(_slot(external ? _slots_per_frame - 1 : worker), VK_COMMAND_BUFFER_LEVEL_PRIMARY, command_buffer); !vk_check(result))
+        {
+            return unexpected(format_str("Failed to allocate primary command buffer: {}", vulkan_result_to_string(result)));
+        }
+
+        const VkCommandBufferBeginInfo begin_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        if (const VkResult result = vkBeginCommandBuffer(command_buffer, &begin_info); !vk_check(result))
+        {
+            return unexpected(format_str("Failed to begin primary command buffer: {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(command_buffer);
+    }
+
+    VkResult command_recorder::record_parallel(
+        const VkCommandBuffer primary,
+        const VkCommandBufferInheritanceInfo& inheritance,
+        const VkCommandBufferUsageFlags usage,
+        const std::span<const record_function> jobs
+    ) noexcept
+    {
+        if (jobs.empty())
+        {
+            return VK_SUCCESS;
+        }
+
+        // One secondary per chunk of consecutive jobs keeps submission order identical to job order
+        const uint32_t job_count = static_cast<uint32_t>(jobs.size());
+        const uint32_t chunk_count = std::min(job_count, _slots_per_frame);
+        const uint32_t chunk_size = (job_count + chunk_count - 1) / chunk_count;
+
+        std::vector<VkCommandBuffer> secondaries(chunk_count, VK_NULL_HANDLE);
+        std::vector<VkResult> results(chunk_count, VK_SUCCESS);
+
+        const VkCommandBufferBeginInfo begin_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = usage | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = &inheritance,
+        };
+
+        _workers->parallel_for(chunk_count, [&](const uint32_t chunk)
+        {
+            VkCommandBuffer& command_buffer = secondaries[chunk];
+            const uint32_t worker = _workers->worker_index();
+            const bool external = worker >= _workers->size();
+
+            // The calling thread drains chunks too. Outside the pool it records from the shared slot, which
+            // stays locked until the chunk is recorded since a command pool must not be used by two threads at once
+            std::unique_lock lock { _external_mutex, std::defer_lock };
+            if (external)
+            {
+                lock.lock();
+            }
+
+            pool_slot& slot = _slot(external ? _slots_per_frame - 1 : worker);
+
+            if (results[chunk] = _acquire(slot, VK_COMMAND_BUFFER_LEVEL_SECONDARY, command_buffer); !vk_check(results[chunk]))
+            {
+                return;
+            }
+
+            if (results[chunk] = vkBeginCommandBuffer(command_buffer, &begin_info); !vk_check(results[chunk]))
+            {
+                return;
+            }
+
+            const uint32_t end = std::min(job_count, (chunk + 1) * chunk_size);
+            for (uint32_t job = chunk * chunk_size; job < end; ++job)
+            {
+                jobs[job](command_buffer, job);
+            }
+
+            results[chunk] = vkEndCommandBuffer(command_buffer);
+        });
+
+        for (const VkResult result : results)
+        {
+            if (!vk_check(result))
+            {
+                log::error("Recording secondary command buffer failed with {}", vulkan_result_to_string(result));
+                return result;
+            }
+        }
+
+        vkCmdExecuteCommands(primary, chunk_count, secondaries.data());
+        return VK_SUCCESS;
+    }
+
+    void command_recorder::destroy() noexcept
+    {
+        for (auto& slot : _slots)
+        {
+            if (slot.pool != VK_NULL_HANDLE)
+            {
+                vkDestroyCommandPool(_device, slot.pool, nullptr);
+            }
+        }
+
+        _slots.clear();
+        _workers = nullptr;
+    }
+
+    command_recorder::pool_slot& command_recorder::_slot(const uint32_t worker) noexcept
+    {
+        return _slots[static_cast<size_t>(_frame) * _slots_per_frame + worker];
+    }
+
+    VkResult command_recorder::_acquire(pool_slot& slot, const VkCommandBufferLevel level, VkCommandBuffer& command_buffer) const noexcept
+    {
+        const bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        auto& buffers = primary ? slot.primaries : slot.secondaries;
+        uint32_t& used = primary ? slot.used_primaries : slot.used_secondaries;
+
+        // Buffers survive the pool reset, so they are only allocated the first time a frame needs that many
+        if (used == buffers.size())
+        {
+            const VkCommandBufferAllocateInfo allocate_info {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = slot.pool,
+                .level = level,
+                .commandBufferCount = 1,
+            };
+
+            VkCommandBuffer allocated { VK_NULL_HANDLE };
+            if (const VkResult result = vkAllocateCommandBuffers(_device, &allocate_info, &allocated); !vk_check(result))
+            {
+                return result;
+            }
+            buffers.push_back(allocated);
+        }
+
+        command_buffer = buffers[used++];
+        return VK_SUCCESS;
+    }
+} // namespace rhi::vk
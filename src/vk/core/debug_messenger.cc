@@ -12,6 +12,12 @@ namespace rhi::vk
         void* user_data
     )
     {
+        // user_data is the instance's validation_filter, it decides which repeats are logged
+        if (auto* filter = static_cast<validation_filter*>(user_data); filter != nullptr && !filter->admit(*callback_data, severity))
+        {
+            return VK_FALSE;
+        }
+
         const std::string_view type_prefix = [type]()
         {
             switch (type)
@@ -70,7 +76,7 @@ namespace rhi::vk
         }
     }
 
-    VkDebugUtilsMessengerCreateInfoEXT debug_messenger::get_create_info() noexcept
+    VkDebugUtilsMessengerCreateInfoEXT debug_messenger::get_create_info(validation_filter* filter) noexcept
     {
         return VkDebugUtilsMessengerCreateInfoEXT {
             .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
@@ -84,11 +90,11 @@ namespace rhi::vk
                 VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
                 VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
             .pfnUserCallback = debug_callback,
-            .pUserData = nullptr,
+            .pUserData = filter,
         };
     }
 
-    expected<debug_messenger, std::string> debug_messenger::create(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT& create_info) noexcept
+    expected<debug_messenger, error> debug_messenger::create(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT& create_info) noexcept
     {
         debug_messenger messenger {};
         messenger._instance = instance;
@@ -99,13 +105,13 @@ namespace rhi::vk
             if (result == VK_ERROR_EXTENSION_NOT_PRESENT)
             {
                 log::error("Debug extension not present!");
-                return unexpected(std::string("Vulkan Debug extension not present."));
+                return unexpected(error(error::code::DEBUG_MESSENGER_FAIL, error::message_id::DEBUG_EXTENSION_MISSING, result));
             }
             log::error("Failed to create debug messenger!");
-            return unexpected<std::string>("Failed to create debug messenger.");
+            return unexpected(error(error::code::DEBUG_MESSENGER_FAIL, error::message_id::CREATE_DEBUG_MESSENGER_FAILED, result));
         }
 
-        return ok(messenger);
+        return ok(std::move(messenger));
     }
 
     void debug_messenger::destroy() noexcept
@@ -7,8 +7,10 @@
 
 #include <string>
 
+#include "common/error.h"
 #include "core/expected.h"
 #include "vk/vulkan.h"
+#include "vk/core/validation_filter.h"
 
 namespace rhi::vk
 {
@@ -22,9 +24,10 @@ namespace rhi::vk
         [[nodiscard]] debug_messenger& operator=(debug_messenger const&) = default;
         [[nodiscard]] debug_messenger& operator=(debug_messenger &&) = default;
 
-        [[nodiscard]] static expected<debug_messenger, std::string> create(VkInstance, const VkDebugUtilsMessengerCreateInfoEXT&) noexcept;
+        [[nodiscard]] static expected<debug_messenger, error> create(VkInstance, const VkDebugUtilsMessengerCreateInfoEXT&) noexcept;
 
-        [[nodiscard]] static VkDebugUtilsMessengerCreateInfoEXT get_create_info() noexcept;
+        /// @param filter Rate limits the messages when set. It must outlive the instance, which reports messages until it is destroyed
+        [[nodiscard]] static VkDebugUtilsMessengerCreateInfoEXT get_create_info(validation_filter* filter = nullptr) noexcept;
 
         void destroy() noexcept;
 
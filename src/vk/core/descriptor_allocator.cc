@@ -0,0 +1,309 @@
+#include "vk/core/descriptor_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        void hash_value(uint64_t& hash, const uint64_t value) noexcept
+        {
+            // FNV-1a, one byte at a time
+            for (uint32_t byte = 0; byte < sizeof(value); byte++)
+            {
+                hash ^= (value >> (byte * 8)) & 0xff;
+                hash *= 0x100000001b3ull;
+            }
+        }
+
+        [[nodiscard]] bool same_binding(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) noexcept
+        {
+            return a.binding == b.binding
+                && a.descriptorType == b.descriptorType
+                && a.descriptorCount == b.descriptorCount
+                && a.stageFlags == b.stageFlags
+                && (a.pImmutableSamplers == nullptr) == (b.pImmutableSamplers == nullptr)
+                && (a.pImmutableSamplers == nullptr || std::equal(a.pImmutableSamplers, a.pImmutableSamplers + a.descriptorCount, b.pImmutableSamplers));
+        }
+    }
+
+    bool descriptor_layout_cache::layout_key::operator==(const layout_key& other) const noexcept
+    {
+        return flags == other.flags && std::ranges::equal(bindings, other.bindings, same_binding);
+    }
+
+    size_t descriptor_layout_cache::layout_key_hasher::operator()(const layout_key& key) const noexcept
+    {
+        uint64_t hash { 0xcbf29ce484222325ull };
+        hash_value(hash, key.flags);
+        for (const auto& binding : key.bindings)
+        {
+            hash_value(hash, binding.binding);
+            hash_value(hash, binding.descriptorType);
+            hash_value(hash, binding.descriptorCount);
+            hash_value(hash, binding.stageFlags);
+            if (binding.pImmutableSamplers != nullptr)
+            {
+                for (uint32_t i = 0; i < binding.descriptorCount; i++)
+                {
+                    hash_value(hash, reinterpret_cast<uint64_t>(binding.pImmutableSamplers[i]));
+                }
+            }
+        }
+
+        return static_cast<size_t>(hash);
+    }
+
+    expected<VkDescriptorSetLayout, std::string> descriptor_layout_cache::get(
+        const std::span<const VkDescriptorSetLayoutBinding> bindings,
+        const VkDescriptorSetLayoutCreateFlags flags
+    ) noexcept
+    {
+        layout_key key { flags, { bindings.begin(), bindings.end() } };
+        std::ranges::sort(key.bindings, {}, &VkDescriptorSetLayoutBinding::binding);
+
+        {
+            std::shared_lock lock { _mutex };
+            if (const auto it = _layouts.find(key); it != _layouts.end())
+            {
+                return ok(it->second);
+            }
+        }
+
+        std::unique_lock lock { _mutex };
+
+        // Another thread may have created it between the two locks
+        if (const auto it = _layouts.find(key); it != _layouts.end())
+        {
+            return ok(it->second);
+        }
+
+        const VkDescriptorSetLayoutCreateInfo create_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = flags,
+            .bindingCount = static_cast<uint32_t>(key.bindings.size()),
+            .pBindings = key.bindings.data(),
+        };
+
+        VkDescriptorSetLayout layout { VK_NULL_HANDLE };
+        if (const VkResult result = vkCreateDescriptorSetLayout(_device, &create_info, nullptr, &layout); !vk_check(result))
+        {
+            return unexpected(format_str("vkCreateDescriptorSetLayout failed with {}", vulkan_result_to_string(result)));
+        }
+
+        // Immutable samplers point into caller memory. The handles are compared by value in the key,
+        // so the pointers are moved to storage owned by the cache
+        for (auto& binding : key.bindings)
+        {
+            if (binding.pImmutableSamplers != nullptr)
+            {
+                binding.pImmutableSamplers = _immutable_samplers.emplace_back(binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount).data();
+            }
+        }
+
+        _layouts.emplace(std::move(key), layout);
+
+        return ok(layout);
+    }
+
+    size_t descriptor_layout_cache::size() const noexcept
+    {
+        std::shared_lock lock { _mutex };
+        return _layouts.size();
+    }
+
+    void descriptor_layout_cache::destroy() noexcept
+    {
+        std::unique_lock lock { _mutex };
+        for (const auto& [key, layout] : _layouts)
+        {
+            vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+        }
+
+        _layouts.clear();
+        _immutable_samplers.clear();
+    }
+
+    expected<std::shared_ptr<descriptor_allocator>, error> descriptor_allocator::create(
+        const VkDevice device,
+        std::shared_ptr<thread_pool> workers,
+        const descriptor_allocator_description& description
+    ) noexcept
+    {
+        if (workers == nullptr || description.frames_in_flight == 0 || description.sets_per_pool == 0 || description.ratios.empty())
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::DESCRIPTOR_ALLOCATOR_FAILED).with_context("needs a thread pool, frames, a pool size and ratios"));
+        }
+
+        std::shared_ptr<descriptor_allocator> allocator { new descriptor_allocator(device) };
+        allocator->_frames_in_flight = description.frames_in_flight;
+        allocator->_max_sets_per_pool = std::max(description.max_sets_per_pool, description.sets_per_pool);
+        allocator->_ratios = description.ratios;
+        allocator->_slots_per_frame = workers->size() + 1;
+        allocator->_workers = std::move(workers);
+        allocator->_slots.resize(static_cast<size_t>(allocator->_slots_per_frame) * description.frames_in_flight);
+
+        for (auto& slot : allocator->_slots)
+        {
+            slot.next_sets = description.sets_per_pool;
+        }
+
+        log::debug("Created descriptor allocator: {} frames x {} pool slots, first pools hold {} sets.",
+            allocator->_frames_in_flight, allocator->_slots_per_frame, description.sets_per_pool);
+
+        return ok(std::move(allocator));
+    }
+
+    VkResult descriptor_allocator::begin_frame(const uint32_t frame_index) noexcept
+    {
+        _frame = frame_index % _frames_in_flight;
+
+        // Resetting a pool frees every set allocated from it at once
+        for (uint32_t worker = 0; worker < _slots_per_frame; ++worker)
+        {
+            pool_slot& slot = _slot(worker);
+            for (const VkDescriptorPool pool : slot.used)
+            {
+                if (const VkResult result = vkResetDescriptorPool(_device, pool, 0); !vk_check(result))
+                {
+                    return result;
+                }
+            }
+
+            slot.free.insert(slot.free.end(), slot.used.begin(), slot.used.end());
+            slot.used.clear();
+        }
+
+        return VK_SUCCESS;
+    }
+
+    expected<VkDescriptorSet, std::string> descriptor_allocator::allocate(const VkDescriptorSetLayout layout) noexcept
+    {
+        const uint32_t worker = _workers->worker_index();
+        const bool external = worker >= _workers->size();
+
+        std::unique_lock lock { _external_mutex, std::defer_lock };
+        if (external)
+        {
+            lock.lock();
+        }
+
+        pool_slot& slot = _slot(external ? _slots_per_frame - 1 : worker);
+
+        VkDescriptorSetAllocateInfo allocate_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = VK_NULL_HANDLE,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &layout,
+        };
+
+        VkDescriptorSet set { VK_NULL_HANDLE };
+        VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+        if (!slot.used.empty())
+        {
+            allocate_info.descriptorPool = slot.used.back();
+            result = vkAllocateDescriptorSets(_device, &allocate_info, &set);
+        }
+
+        // The current pool is exhausted, move on to a recycled or a new one and try once more
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+        {
+            if (result = _add_pool(slot); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to create descriptor pool. vkCreateDescriptorPool failed with {}", vulkan_result_to_string(result)));
+            }
+
+            allocate_info.descriptorPool = slot.used.back();
+            result = vkAllocateDescriptorSets(_device, &allocate_info, &set);
+
+            // Not even an empty pool holds the layout, so another pool would fail the same way. Park the untouched
+            // pool for the next allocation instead of adding one per call
+            if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+            {
+                slot.free.push_back(slot.used.back());
+                slot.used.pop_back();
+                return unexpected<std::string>("Descriptor set layout does not fit an empty pool. Its descriptor types are missing from the pool ratios or need more than a pool reserves");
+            }
+        }
+
+        if (!vk_check(result))
+        {
+            return unexpected(format_str("Failed to allocate descriptor set. vkAllocateDescriptorSets failed with {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(set);
+    }
+
+    descriptor_allocator::pool_slot& descriptor_allocator::_slot(const uint32_t worker) noexcept
+    {
+        return _slots[static_cast<size_t>(_frame) * _slots_per_frame + worker];
+    }
+
+    VkResult descriptor_allocator::_add_pool(pool_slot& slot) noexcept
+    {
+        if (!slot.free.empty())
+        {
+            slot.used.push_back(slot.free.back());
+            slot.free.pop_back();
+            return VK_SUCCESS;
+        }
+
+        std::vector<VkDescriptorPoolSize> sizes {};
+        sizes.reserve(_ratios.size());
+        for (const auto& [type, per_set] : _ratios)
+        {
+            const auto count = static_cast<uint32_t>(std::ceil(per_set * static_cast<float>(slot.next_sets)));
+            sizes.push_back(VkDescriptorPoolSize { .type = type, .descriptorCount = std::max(count, 1u) });
+        }
+
+        const VkDescriptorPoolCreateInfo pool_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = slot.next_sets,
+            .poolSizeCount = static_cast<uint32_t>(sizes.size()),
+            .pPoolSizes = sizes.data(),
+        };
+
+        VkDescriptorPool pool { VK_NULL_HANDLE };
+        if (const VkResult result = vkCreateDescriptorPool(_device, &pool_info, nullptr, &pool); !vk_check(result))
+        {
+            return result;
+        }
+
+        log::debug("Descriptor allocator grew by a pool of {} sets.", slot.next_sets);
+
+        slot.used.push_back(pool);
+        slot.next_sets = std::min(slot.next_sets * 2, _max_sets_per_pool);
+
+        return VK_SUCCESS;
+    }
+
+    void descriptor_allocator::destroy() noexcept
+    {
+        for (auto& slot : _slots)
+        {
+            for (const VkDescriptorPool pool : slot.used)
+            {
+                vkDestroyDescriptorPool(_device, pool, nullptr);
+            }
+
+            for (const VkDescriptorPool pool : slot.free)
+            {
+                vkDestroyDescriptorPool(_device, pool, nullptr);
+            }
+
+            slot.used.clear();
+            slot.free.clear();
+        }
+
+        _layouts.destroy();
+    }
+} // namespace rhi::vk
@@ -0,0 +1,124 @@
+#include "vk/core/device_capability_cache.h"
+
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "core/log.h"
+#include "vk/core/cache_file.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr uint32_t CACHE_FILE_MAGIC = 0x43445652; // "RVDC"
+        constexpr uint32_t CACHE_FILE_VERSION = 3;
+
+        static_assert(std::is_trivially_copyable_v<descriptor_indexing_support>);
+
+        /// The driver and API version are part of the identity instead of the file name, so a driver update
+        /// overwrites the stale entry instead of leaving it behind
+        [[nodiscard]] cache_file_identity identity(const VkPhysicalDeviceProperties& properties, const uint32_t api_version) noexcept
+        {
+            return {
+                .magic = CACHE_FILE_MAGIC,
+                .version = CACHE_FILE_VERSION,
+                .driver_version = properties.driverVersion,
+                .api_version = api_version,
+            };
+        }
+
+        template <typename T>
+        void append(std::vector<std::byte>& data, const T* values, const size_t count) noexcept
+        {
+            const auto* bytes = reinterpret_cast<const std::byte*>(values);
+            data.insert(data.end(), bytes, bytes + sizeof(T) * count);
+        }
+
+        template <typename T>
+        [[nodiscard]] bool read(std::span<const std::byte>& data, T* values, const size_t count) noexcept
+        {
+            const size_t size = sizeof(T) * count;
+            if (data.size() < size)
+            {
+                return false;
+            }
+
+            // An empty vector may hand out a null pointer, which memcpy must not see even for zero bytes
+            if (size > 0)
+            {
+                std::memcpy(values, data.data(), size);
+            }
+            data = data.subspan(size);
+            return true;
+        }
+    }
+
+    std::filesystem::path device_capability_cache::path(const VkPhysicalDeviceProperties& properties) const noexcept
+    {
+        return _directory / cache_file_name("device_caps", properties);
+    }
+
+    std::optional<device_capabilities> device_capability_cache::load(const VkPhysicalDeviceProperties& properties, const uint32_t api_version) const noexcept
+    {
+        const auto file_path = path(properties);
+
+        const auto contents = read_validated(file_path, identity(properties, api_version), "device capability cache");
+        if (!contents.has_value())
+        {
+            return std::nullopt;
+        }
+
+        auto data = std::span<const std::byte> { contents.value() };
+        uint32_t extension_count { 0 };
+        uint32_t queue_family_count { 0 };
+        device_capabilities capabilities {};
+
+        bool valid = read(data, &extension_count, 1) && read(data, &queue_family_count, 1);
+        if (valid)
+        {
+            capabilities.extensions.resize(extension_count);
+            capabilities.queue_families.resize(queue_family_count);
+            valid = read(data, &capabilities.memory_properties, 1)
+                && read(data, &capabilities.descriptor_indexing, 1)
+                && read(data, capabilities.extensions.data(), capabilities.extensions.size())
+                && read(data, capabilities.queue_families.data(), capabilities.queue_families.size())
+                && data.empty();
+        }
+
+        if (!valid)
+        {
+            log::warn("Device capability cache {} does not match its counts, ignoring it", file_path.string());
+            return std::nullopt;
+        }
+
+        return capabilities;
+    }
+
+    bool device_capability_cache::store(const VkPhysicalDeviceProperties& properties, const uint32_t api_version, const device_capabilities& capabilities) const noexcept
+    {
+        if (_directory.empty())
+        {
+            return false;
+        }
+
+        const auto extension_count = static_cast<uint32_t>(capabilities.extensions.size());
+        const auto queue_family_count = static_cast<uint32_t>(capabilities.queue_families.size());
+
+        std::vector<std::byte> data {};
+        append(data, &extension_count, 1);
+        append(data, &queue_family_count, 1);
+        append(data, &capabilities.memory_properties, 1);
+        append(data, &capabilities.descriptor_indexing, 1);
+        append(data, capabilities.extensions.data(), capabilities.extensions.size());
+        append(data, capabilities.queue_families.data(), capabilities.queue_families.size());
+
+        const auto file_path = path(properties);
+        std::lock_guard lock { _write_mutex };
+
+        std::error_code error {};
+        std::filesystem::create_directories(_directory, error);
+
+        return write_atomically(file_path, identity(properties, api_version), data, "device capability cache");
+    }
+} // namespace rhi::vk
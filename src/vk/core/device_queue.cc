@@ -0,0 +1,140 @@
+#include "vk/core/device_queue.h"
+
+#include <vector>
+
+namespace rhi::vk
+{
+    namespace
+    {
+        enum class ownership_side
+        {
+            RELEASE,
+            ACQUIRE,
+            BOTH,
+        };
+
+        void record_ownership_barriers(
+            const VkCommandBuffer cmd,
+            const ownership_side side,
+            const uint32_t src_family,
+            const uint32_t dst_family,
+            const std::span<const buffer_ownership_transfer> buffers,
+            const std::span<const image_ownership_transfer> images
+        ) noexcept
+        {
+            if (buffers.empty() && images.empty())
+            {
+                return;
+            }
+
+            // Release makes the writes available, acquire makes them visible. Access masks on the other half are ignored
+            const bool release = side != ownership_side::ACQUIRE;
+            const bool acquire = side != ownership_side::RELEASE;
+            const uint32_t src_index = side == ownership_side::BOTH ? VK_QUEUE_FAMILY_IGNORED : src_family;
+            const uint32_t dst_index = side == ownership_side::BOTH ? VK_QUEUE_FAMILY_IGNORED : dst_family;
+
+            VkPipelineStageFlags src_stages { 0 };
+            VkPipelineStageFlags dst_stages { 0 };
+
+            std::vector<VkBufferMemoryBarrier> buffer_barriers {};
+            buffer_barriers.reserve(buffers.size());
+            for (const auto& transfer : buffers)
+            {
+                src_stages |= release ? transfer.src_stages : 0;
+                dst_stages |= acquire ? transfer.dst_stages : 0;
+
+                buffer_barriers.push_back(VkBufferMemoryBarrier {
+                    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                    .pNext = nullptr,
+                    .srcAccessMask = release ? transfer.src_access : 0,
+                    .dstAccessMask = acquire ? transfer.dst_access : 0,
+                    .srcQueueFamilyIndex = src_index,
+                    .dstQueueFamilyIndex = dst_index,
+                    .buffer = transfer.buffer,
+                    .offset = transfer.offset,
+                    .size = transfer.size,
+                });
+            }
+
+            std::vector<VkImageMemoryBarrier> image_barriers {};
+            image_barriers.reserve(images.size());
+            for (const auto& transfer : images)
+            {
+                src_stages |= release ? transfer.src_stages : 0;
+                dst_stages |= acquire ? transfer.dst_stages : 0;
+
+                image_barriers.push_back(VkImageMemoryBarrier {
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                    .pNext = nullptr,
+                    .srcAccessMask = release ? transfer.src_access : 0,
+                    .dstAccessMask = acquire ? transfer.dst_access : 0,
+                    .oldLayout = transfer.old_layout,
+                    .newLayout = transfer.new_layout,
+                    .srcQueueFamilyIndex = src_index,
+                    .dstQueueFamilyIndex = dst_index,
+                    .image = transfer.image,
+                    .subresourceRange = transfer.range,
+                });
+            }
+
+            vkCmdPipelineBarrier(cmd,
+                src_stages != 0 ? src_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                dst_stages != 0 ? dst_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+                0,
+                0, nullptr,
+                static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+                static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+        }
+    }
+
+    VkResult device_queue::submit(const std::span<const VkSubmitInfo> submits, const VkFence fence) noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return vkQueueSubmit(_handle, static_cast<uint32_t>(submits.size()), submits.data(), fence);
+    }
+
+    VkResult device_queue::submit(const VkSubmitInfo& submit_info, const VkFence fence) noexcept
+    {
+        return submit(std::span { &submit_info, 1 }, fence);
+    }
+
+    VkResult device_queue::present(const VkPresentInfoKHR& present_info) noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return vkQueuePresentKHR(_handle, &present_info);
+    }
+
+    VkResult device_queue::wait_idle() noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return vkQueueWaitIdle(_handle);
+    }
+
+    void release_ownership(
+        const VkCommandBuffer cmd,
+        const uint32_t src_family,
+        const uint32_t dst_family,
+        const std::span<const buffer_ownership_transfer> buffers,
+        const std::span<const image_ownership_transfer> images
+    ) noexcept
+    {
+        if (src_family == dst_family)
+        {
+            return;
+        }
+
+        record_ownership_barriers(cmd, ownership_side::RELEASE, src_family, dst_family, buffers, images);
+    }
+
+    void acquire_ownership(
+        const VkCommandBuffer cmd,
+        const uint32_t src_family,
+        const uint32_t dst_family,
+        const std::span<const buffer_ownership_transfer> buffers,
+        const std::span<const image_ownership_transfer> images
+    ) noexcept
+    {
+        const auto side = src_family == dst_family ? ownership_side::BOTH : ownership_side::ACQUIRE;
+        record_ownership_barriers(cmd, side, src_family, dst_family, buffers, images);
+    }
+} // namespace rhi::vk
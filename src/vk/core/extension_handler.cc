@@ -1,6 +1,7 @@
 #include "vk/core/extension_handler.h"
 #include "core/log.h"
 #include "vk/vulkan.h"
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <vector>
@@ -16,6 +17,8 @@ namespace rhi::vk
         vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
         _extensions.resize(extension_count);
         vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, _extensions.data());
+
+        _names = name_table::create(_extensions, [](const VkExtensionProperties& extension) { return extension.extensionName; });
     }
 
     template <>
@@ -23,13 +26,14 @@ namespace rhi::vk
     {
     }
 
-    expected<std::vector<const char*>, std::string> extension_handler::get_requested(const std::span<requested_extension> requested_extensions) const noexcept
+    expected<std::span<const char* const>, std::string> extension_handler::get_requested(const std::span<const requested_extension> requested_extensions) noexcept
     {
-        std::vector<const char*> found_extensions {};
+        _enabled.clear();
 
         for (const auto& extension : requested_extensions)
         {
-            if (!is_supported(extension.name))
+            const char* name = _names.find(extension.name);
+            if (name == nullptr)
             {
                 if (extension.is_required)
                 {
@@ -42,28 +46,21 @@ namespace rhi::vk
             else
             {
                 log::debug("Vulkan extension {} found.", extension.name);
-                found_extensions.push_back(extension.name.c_str());
+                _enabled.push_back(name);
             }
         }
+
+        // The table hands out one pointer per name, so duplicates compare equal
+        std::ranges::sort(_enabled);
+        const auto [first_duplicate, end] = std::ranges::unique(_enabled);
+        _enabled.erase(first_duplicate, end);
         log::debug("All requested [required] vulkan extensions found.");
 
-        return ok(found_extensions);
+        return ok(std::span<const char* const> { _enabled });
     }
 
-
-
-    bool extension_handler::is_supported(std::string_view extension_name) const noexcept
+    bool extension_handler::is_supported(const std::string_view extension_name) const noexcept
     {
-        for (const auto& [extensionName, specVersion] : _extensions)
-        {
-            if (strcmp(extensionName, extension_name.data()) == 0)
-            {
-                return true;
-            }
-        }
-
-        return false;
+        return _names.contains(extension_name);
     }
-
-
 } // namespace rhi::vk
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "vk/core/frame_pacer.h"
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    expected<std::shared_ptr<frame_pacer>, std::string> frame_pacer::create(const VkDevice device, const uint32_t frames_in_flight) noexcept
+    {
+        if (frames_in_flight == 0)
+        {
+            return unexpected<std::string>("Frame pacer needs at least one frame in flight");
+        }
+
+        auto semaphore_exp = timeline_semaphore::create(device, 0);
+        if (!semaphore_exp.has_value())
+        {
+            return unexpected(format_str("Failed to create frame pacer: {}", semaphore_exp.unwrap_error()));
+        }
+
+        return ok(std::shared_ptr<frame_pacer> { new frame_pacer(std::move(semaphore_exp).unwrap(), frames_in_flight) });
+    }
+
+    bool frame_pacer::begin_frame(const uint64_t timeout) noexcept
+    {
+        const uint64_t next = _frame_value + 1;
+
+        // The slot was last used by frame next - frames_in_flight, nothing to wait for in the first frames
+        if (next > _frames_in_flight)
+        {
+            if (const VkResult result = _semaphore.wait(next - _frames_in_flight, timeout); result == VK_TIMEOUT)
+            {
+                return false;
+            }
+            else if (!vk_check(result))
+            {
+                log::error("Waiting for frame {} failed with {}", next - _frames_in_flight, vulkan_result_to_string(result));
+                return false;
+            }
+        }
+
+        _frame_value = next;
+        return true;
+    }
+
+    VkTimelineSemaphoreSubmitInfo frame_pacer::signal_submit_info() const noexcept
+    {
+        return VkTimelineSemaphoreSubmitInfo {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = 0,
+            .pWaitSemaphoreValues = nullptr,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &_frame_value,
+        };
+    }
+
+    VkResult frame_pacer::wait_idle(const uint64_t timeout) const noexcept
+    {
+        return _semaphore.wait(_frame_value, timeout);
+    }
+
+    void frame_pacer::destroy() noexcept
+    {
+        _semaphore.destroy();
+    }
+} // namespace rhi::vk
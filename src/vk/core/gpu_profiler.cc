@@ -0,0 +1,577 @@
+#include "vk/core/gpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "core/win32.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        /// Calibration attempts through the queue, the one with the shortest round trip is kept
+        constexpr uint32_t SUBMIT_CALIBRATION_ATTEMPTS = 3;
+
+        /// A host timestamp further than this from steady_clock means the domain is not the clock steady_clock reads
+        constexpr std::chrono::seconds MAX_HOST_CLOCK_MISMATCH { 1 };
+
+        // steady_clock reads CLOCK_MONOTONIC on Linux and the performance counter on Windows
+#if defined(RHI_PLATFORM_WINDOWS)
+        constexpr VkTimeDomainEXT HOST_TIME_DOMAIN = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#elif defined(RHI_PLATFORM_LINUX)
+        constexpr VkTimeDomainEXT HOST_TIME_DOMAIN = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+        [[nodiscard]] double to_microseconds(const std::chrono::steady_clock::duration duration) noexcept
+        {
+            return std::chrono::duration<double, std::micro> { duration }.count();
+        }
+
+        void append_json_string(std::string& out, const char* text) noexcept
+        {
+            out += '"';
+            for (const char* c = text; *c != '\0'; ++c)
+            {
+                switch (*c)
+                {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20)
+                    {
+                        out += format_str("\\u{:04x}", static_cast<uint32_t>(*c));
+                    }
+                    else
+                    {
+                        out += *c;
+                    }
+                }
+            }
+            out += '"';
+        }
+    }
+
+    expected<std::shared_ptr<gpu_profiler>, error> gpu_profiler::create(
+        const VkDevice device,
+        const physical_device& physical_device,
+        device_queue& queue,
+        const bool calibrated_timestamps,
+        const gpu_profiler_description& description
+    ) noexcept
+    {
+        if (description.queries_per_frame < 2)
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::GPU_PROFILER_FAILED).with_context("needs at least two queries per frame"));
+        }
+
+        const auto& families = physical_device.get_queue_families();
+        const uint32_t valid_bits = queue.family_index() < families.size() ? families[queue.family_index()].timestampValidBits : 0;
+        if (valid_bits == 0)
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::GPU_PROFILER_FAILED).with_context("queue family {} has no timestamps", queue.family_index()));
+        }
+
+        std::shared_ptr<gpu_profiler> profiler { new gpu_profiler() };
+        profiler->_device = device;
+        profiler->_queue = &queue;
+        profiler->_description = description;
+        profiler->_period = physical_device.get_properties().limits.timestampPeriod;
+        profiler->_tick_mask = valid_bits >= 64 ? UINT64_MAX : (uint64_t { 1 } << valid_bits) - 1;
+        profiler->_pool_count = description.latency + 1;
+        profiler->_pools = std::make_unique<frame_pool[]>(profiler->_pool_count);
+        profiler->_results.resize(size_t { description.queries_per_frame } * 2);
+
+        const VkQueryPoolCreateInfo pool_info {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = description.queries_per_frame,
+            .pipelineStatistics = 0,
+        };
+
+        for (uint32_t i = 0; i < profiler->_pool_count; i++)
+        {
+            if (const VkResult result = vkCreateQueryPool(device, &pool_info, nullptr, &profiler->_pools[i].pool); !vk_check(result))
+            {
+                profiler->destroy();
+                return unexpected(error(error::code::DEVICE_FAIL, error::message_id::GPU_PROFILER_FAILED, result).with_context("vkCreateQueryPool"));
+            }
+        }
+
+#if defined(RHI_PLATFORM_WINDOWS) || defined(RHI_PLATFORM_LINUX)
+        // Asking for a time domain the device did not report is invalid usage, so both clocks have to be listed
+        const auto domains = calibrated_timestamps ? physical_device.get_calibrateable_time_domains() : std::vector<VkTimeDomainEXT> {};
+        if (std::ranges::find(domains, VK_TIME_DOMAIN_DEVICE_EXT) != domains.end() && std::ranges::find(domains, HOST_TIME_DOMAIN) != domains.end())
+        {
+            profiler->_get_calibrated_timestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT");
+        }
+        else if (calibrated_timestamps)
+        {
+            log::debug("{} cannot calibrate its timestamps against steady_clock, measuring the clock offset through the queue", physical_device.name());
+        }
+#endif
+
+        if (const VkResult result = profiler->calibrate(); !vk_check(result))
+        {
+            profiler->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::GPU_PROFILER_FAILED, result).with_context("timestamp calibration"));
+        }
+
+        log::debug("GPU profiler: {} pools of {} queries, {}ns per tick, calibrated {} to {}ns",
+            profiler->_pool_count, description.queries_per_frame, profiler->_period,
+            profiler->_statistics.calibrated_timestamps ? "by VK_EXT_calibrated_timestamps" : "by a submitted timestamp",
+            profiler->_statistics.calibration_error.count());
+
+        return ok(std::move(profiler));
+    }
+
+    void gpu_profiler::begin_frame(const VkCommandBuffer command_buffer) noexcept
+    {
+        ++_frame;
+        _harvest(_frame > _pool_count ? _frame - _pool_count : 0);
+
+        if (_get_calibrated_timestamps && _description.recalibration_interval.count() > 0
+            && std::chrono::steady_clock::now() - _calibrated_at >= _description.recalibration_interval)
+        {
+            // Keeps the old offset on failure, it is still close
+            (void)_calibrate_with_extension();
+        }
+
+        const uint32_t index = static_cast<uint32_t>(_frame % _pool_count);
+        frame_pool& pool = _pools[index];
+        {
+            std::lock_guard lock { pool.mutex };
+            pool.scopes.clear();
+        }
+        pool.used.store(0, std::memory_order_relaxed);
+        pool.frame = _frame;
+
+        vkCmdResetQueryPool(command_buffer, pool.pool, 0, _description.queries_per_frame);
+        _current.store(index, std::memory_order_release);
+    }
+
+    uint32_t gpu_profiler::begin_scope(const VkCommandBuffer command_buffer, const char* name) noexcept
+    {
+        const uint32_t index = _current.load(std::memory_order_acquire);
+        frame_pool& pool = _pools[index];
+
+        const uint32_t query = pool.used.fetch_add(2, std::memory_order_relaxed);
+        if (query + 2 > _description.queries_per_frame)
+        {
+            _dropped_scopes.fetch_add(1, std::memory_order_relaxed);
+            return invalid_scope;
+        }
+
+        {
+            std::lock_guard lock { pool.mutex };
+            pool.scopes.push_back(scope_record { .name = name, .query = query });
+        }
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool.pool, query);
+        return index * _description.queries_per_frame + query;
+    }
+
+    void gpu_profiler::end_scope(const VkCommandBuffer command_buffer, const uint32_t scope) noexcept
+    {
+        if (scope == invalid_scope)
+        {
+            return;
+        }
+
+        const frame_pool& pool = _pools[scope / _description.queries_per_frame];
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool.pool, scope % _description.queries_per_frame + 1);
+    }
+
+    VkResult gpu_profiler::calibrate() noexcept
+    {
+        if (_get_calibrated_timestamps)
+        {
+            const VkResult result = _calibrate_with_extension();
+            if (vk_check(result))
+            {
+                return result;
+            }
+
+            log::warn("Calibrated timestamps failed with {}, measuring the clock offset through the queue", vulkan_result_to_string(result));
+            _get_calibrated_timestamps = nullptr;
+        }
+
+        return _calibrate_with_submit();
+    }
+
+    std::vector<gpu_event> gpu_profiler::last_frame() const noexcept
+    {
+        std::lock_guard lock { _events_mutex };
+        return _last_frame;
+    }
+
+    std::string gpu_profiler::chrome_trace() const noexcept
+    {
+        const auto origin = log::start_time();
+
+        std::string trace { R"({"displayTimeUnit":"ns","traceEvents":[)" };
+        trace += R"({"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"GPU"}})";
+
+        std::lock_guard lock { _events_mutex };
+        for (const gpu_event& event : _events)
+        {
+            trace += R"(,{"name":)";
+            append_json_string(trace, event.name);
+            trace += format_str(R"(,"cat":"gpu","ph":"X","pid":0,"tid":0,"ts":{:.3f},"dur":{:.3f},"args":{{"frame":{}}}}})",
+                to_microseconds(event.begin - origin), to_microseconds(event.end - event.begin), event.frame);
+        }
+        trace += "]}\n";
+
+        return trace;
+    }
+
+    bool gpu_profiler::write_chrome_trace(const std::filesystem::path& path) const noexcept
+    {
+        const std::string trace = chrome_trace();
+
+        std::ofstream file { path, std::ios::binary | std::ios::trunc };
+        file.write(trace.data(), static_cast<std::streamsize>(trace.size()));
+        if (!file.good())
+        {
+            log::error("Failed to write GPU trace {}", path.string());
+            return false;
+        }
+
+        return true;
+    }
+
+    gpu_profiler_statistics gpu_profiler::get_statistics() const noexcept
+    {
+        std::lock_guard lock { _events_mutex };
+        gpu_profiler_statistics statistics = _statistics;
+        statistics.dropped_scopes = _dropped_scopes.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    void gpu_profiler::destroy() noexcept
+    {
+        // The device is idle, everything that was submitted is final
+        while (_harvested < _frame)
+        {
+            frame_pool& pool = _pools[++_harvested % _pool_count];
+            if (pool.frame == _harvested)
+            {
+                (void)_read(pool, true);
+            }
+        }
+
+        for (uint32_t i = 0; _pools && i < _pool_count; i++)
+        {
+            if (_pools[i].pool != VK_NULL_HANDLE)
+            {
+                vkDestroyQueryPool(_device, _pools[i].pool, nullptr);
+                _pools[i].pool = VK_NULL_HANDLE;
+            }
+        }
+
+        if (_calibration_fence != VK_NULL_HANDLE)
+        {
+            vkDestroyFence(_device, _calibration_fence, nullptr);
+            _calibration_fence = VK_NULL_HANDLE;
+        }
+
+        if (_calibration_pool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(_device, _calibration_pool, nullptr);
+            _calibration_pool = VK_NULL_HANDLE;
+        }
+
+        if (_calibration_commands != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(_device, _calibration_commands, nullptr);
+            _calibration_commands = VK_NULL_HANDLE;
+            _calibration_buffer = VK_NULL_HANDLE;
+        }
+    }
+
+    void gpu_profiler::_harvest(const uint64_t reused) noexcept
+    {
+        // Frames are read in order. Anything older than the reused frame was forced out by an earlier begin_frame()
+        while (_harvested + _description.latency < _frame)
+        {
+            const uint64_t next = _harvested + 1;
+            frame_pool& pool = _pools[next % _pool_count];
+            if (pool.frame == next && !_read(pool, next == reused))
+            {
+                break;
+            }
+            _harvested = next;
+        }
+    }
+
+    bool gpu_profiler::_read(frame_pool& pool, const bool force) noexcept
+    {
+        std::lock_guard pool_lock { pool.mutex };
+
+        const uint32_t count = std::min(pool.used.load(std::memory_order_relaxed), _description.queries_per_frame);
+        if (count > 0)
+        {
+            // Availability is written next to every value, so a partially finished frame can still be read when forced
+            const VkResult result = vkGetQueryPoolResults(_device, pool.pool, 0, count, count * 2 * sizeof(uint64_t), _results.data(),
+                2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+            // Query 0 is the first thing a frame writes after its reset, so it tells apart old results from new ones
+            const bool stale = _results[1] != 0 && _results[0] == pool.stale_tick;
+            if ((stale || result == VK_NOT_READY) && !force)
+            {
+                return false;
+            }
+
+            if (result != VK_SUCCESS && result != VK_NOT_READY)
+            {
+                log::warn("Dropping GPU timestamps of frame {}, vkGetQueryPoolResults failed with {}", pool.frame, vulkan_result_to_string(result));
+            }
+
+            if (stale || (result != VK_SUCCESS && result != VK_NOT_READY))
+            {
+                std::fill(_results.begin(), _results.begin() + count * 2, 0);
+            }
+            else if (_results[1] != 0)
+            {
+                pool.stale_tick = _results[0];
+            }
+        }
+
+        std::vector<gpu_event> events {};
+        events.reserve(pool.scopes.size());
+        uint64_t late { 0 };
+        for (const scope_record& scope : pool.scopes)
+        {
+            const uint64_t* begin = &_results[size_t { scope.query } * 2];
+            const uint64_t* end = begin + 2;
+            if (begin[1] == 0 || end[1] == 0)
+            {
+                ++late;
+                continue;
+            }
+
+            events.push_back(gpu_event {
+                .name = scope.name,
+                .frame = pool.frame,
+                .begin = _to_cpu_time(begin[0]),
+                .end = _to_cpu_time(end[0]),
+            });
+        }
+        pool.scopes.clear();
+        pool.frame = 0;
+
+        // Scopes of parallel recorded command buffers were added in recording order, not in the order they ran
+        std::sort(events.begin(), events.end(), [](const gpu_event& a, const gpu_event& b) { return a.begin < b.begin; });
+
+        std::lock_guard lock { _events_mutex };
+        _statistics.frames++;
+        _statistics.events += events.size();
+        _statistics.late_scopes += late;
+
+        _events.insert(_events.end(), events.begin(), events.end());
+        while (_events.size() > _description.max_events)
+        {
+            _events.pop_front();
+        }
+        _last_frame = std::move(events);
+
+        return true;
+    }
+
+    std::chrono::steady_clock::time_point gpu_profiler::_to_cpu_time(const uint64_t ticks) const noexcept
+    {
+        // Only the valid bits count and may have wrapped. Read the difference as signed so ticks before the anchor stay before it
+        const uint64_t delta = (ticks - _gpu_anchor) & _tick_mask;
+        const int64_t signed_delta = delta > (_tick_mask >> 1) ? static_cast<int64_t>(delta - _tick_mask - 1) : static_cast<int64_t>(delta);
+
+        const std::chrono::nanoseconds offset { std::llround(static_cast<double>(signed_delta) * _period) };
+        return _cpu_anchor + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+    }
+
+    VkResult gpu_profiler::_calibrate_with_extension() noexcept
+    {
+#if !defined(RHI_PLATFORM_WINDOWS) && !defined(RHI_PLATFORM_LINUX)
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+#else
+        const VkCalibratedTimestampInfoEXT infos[] = {
+            { .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .pNext = nullptr, .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT },
+            { .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .pNext = nullptr, .timeDomain = HOST_TIME_DOMAIN },
+        };
+
+        uint64_t timestamps[2] {};
+        uint64_t deviation { 0 };
+        if (const VkResult result = _get_calibrated_timestamps(_device, 2, infos, timestamps, &deviation); !vk_check(result))
+        {
+            return result;
+        }
+
+#if defined(RHI_PLATFORM_WINDOWS)
+        LARGE_INTEGER frequency {};
+        QueryPerformanceFrequency(&frequency);
+        const uint64_t ticks_per_second = static_cast<uint64_t>(frequency.QuadPart);
+        const std::chrono::nanoseconds host_time {
+            timestamps[1] / ticks_per_second * 1'000'000'000 + timestamps[1] % ticks_per_second * 1'000'000'000 / ticks_per_second
+        };
+#else
+        const std::chrono::nanoseconds host_time { timestamps[1] };
+#endif
+
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point host { std::chrono::duration_cast<std::chrono::steady_clock::duration>(host_time) };
+        if (now - host > MAX_HOST_CLOCK_MISMATCH || host - now > MAX_HOST_CLOCK_MISMATCH)
+        {
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+
+        _gpu_anchor = timestamps[0];
+        _cpu_anchor = host;
+        _calibrated_at = now;
+
+        std::lock_guard lock { _events_mutex };
+        _statistics.calibration_error = std::chrono::nanoseconds { deviation };
+        _statistics.calibrated_timestamps = true;
+
+        return VK_SUCCESS;
+#endif
+    }
+
+    VkResult gpu_profiler::_calibrate_with_submit() noexcept
+    {
+        if (_calibration_commands == VK_NULL_HANDLE)
+        {
+            const VkCommandPoolCreateInfo command_pool_info {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                .queueFamilyIndex = _queue->family_index(),
+            };
+
+            if (const VkResult result = vkCreateCommandPool(_device, &command_pool_info, nullptr, &_calibration_commands); !vk_check(result))
+            {
+                return result;
+            }
+
+            const VkCommandBufferAllocateInfo buffer_info {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = _calibration_commands,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1,
+            };
+
+            if (const VkResult result = vkAllocateCommandBuffers(_device, &buffer_info, &_calibration_buffer); !vk_check(result))
+            {
+                return result;
+            }
+
+            const VkQueryPoolCreateInfo pool_info {
+                .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                .queryCount = 1,
+                .pipelineStatistics = 0,
+            };
+
+            if (const VkResult result = vkCreateQueryPool(_device, &pool_info, nullptr, &_calibration_pool); !vk_check(result))
+            {
+                return result;
+            }
+
+            const VkFenceCreateInfo fence_info {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+            };
+
+            if (const VkResult result = vkCreateFence(_device, &fence_info, nullptr, &_calibration_fence); !vk_check(result))
+            {
+                return result;
+            }
+        }
+
+        const VkCommandBufferBeginInfo begin_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        const VkSubmitInfo submit_info {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &_calibration_buffer,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr,
+        };
+
+        // The timestamp is written somewhere between the submit and the fence wait returning. Take the middle of the
+        // shortest round trip, half of it bounds the error
+        std::chrono::steady_clock::duration best_window = std::chrono::steady_clock::duration::max();
+        for (uint32_t attempt = 0; attempt < SUBMIT_CALIBRATION_ATTEMPTS; attempt++)
+        {
+            if (const VkResult result = vkBeginCommandBuffer(_calibration_buffer, &begin_info); !vk_check(result))
+            {
+                return result;
+            }
+            vkCmdResetQueryPool(_calibration_buffer, _calibration_pool, 0, 1);
+            vkCmdWriteTimestamp(_calibration_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _calibration_pool, 0);
+            if (const VkResult result = vkEndCommandBuffer(_calibration_buffer); !vk_check(result))
+            {
+                return result;
+            }
+
+            if (const VkResult result = vkResetFences(_device, 1, &_calibration_fence); !vk_check(result))
+            {
+                return result;
+            }
+
+            const auto submitted = std::chrono::steady_clock::now();
+            if (const VkResult result = _queue->submit(submit_info, _calibration_fence); !vk_check(result))
+            {
+                return result;
+            }
+
+            if (const VkResult result = vkWaitForFences(_device, 1, &_calibration_fence, VK_TRUE, UINT64_MAX); !vk_check(result))
+            {
+                return result;
+            }
+            const auto finished = std::chrono::steady_clock::now();
+
+            uint64_t ticks { 0 };
+            if (const VkResult result = vkGetQueryPoolResults(_device, _calibration_pool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT); !vk_check(result))
+            {
+                return result;
+            }
+
+            const auto window = finished - submitted;
+            if (window < best_window)
+            {
+                best_window = window;
+                _gpu_anchor = ticks;
+                _cpu_anchor = submitted + window / 2;
+                _calibrated_at = finished;
+            }
+        }
+
+        std::lock_guard lock { _events_mutex };
+        _statistics.calibration_error = std::chrono::duration_cast<std::chrono::nanoseconds>(best_window / 2);
+        _statistics.calibrated_timestamps = false;
+
+        return VK_SUCCESS;
+    }
+} // namespace rhi::vk
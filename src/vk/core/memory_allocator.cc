@@ -0,0 +1,586 @@
+#include "vk/core/memory_allocator.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/tlsf_allocator.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    struct memory_block
+    {
+        VkDeviceMemory memory { VK_NULL_HANDLE };
+        VkDeviceSize size { 0 };
+        void* mapped { nullptr };
+        tlsf_allocator allocator;
+    };
+
+    struct memory_pool
+    {
+        std::mutex mutex {};
+        uint32_t memory_type { 0 };
+
+        /// Slots are never erased so block indices stored in allocations stay valid
+        std::vector<std::unique_ptr<memory_block>> blocks {};
+    };
+
+    namespace
+    {
+        constexpr VkDeviceSize small_heap_size = 1024ull * 1024 * 1024;
+
+        void update_peak(std::atomic<VkDeviceSize>& peak, const VkDeviceSize value) noexcept
+        {
+            VkDeviceSize current = peak.load(std::memory_order_relaxed);
+            while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        struct memory_type_preference
+        {
+            VkMemoryPropertyFlags required { 0 };
+            VkMemoryPropertyFlags preferred { 0 };
+            VkMemoryPropertyFlags avoided { 0 };
+        };
+
+        memory_type_preference get_preference(const memory_usage usage) noexcept
+        {
+            switch (usage)
+            {
+            case memory_usage::GPU_ONLY:
+                return { 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT };
+            case memory_usage::CPU_TO_GPU:
+                return { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT };
+            case memory_usage::GPU_TO_CPU:
+                return { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0 };
+            case memory_usage::CPU_ONLY:
+                return { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+            }
+
+            return {};
+        }
+    }
+
+    memory_allocator::memory_allocator(const VkDevice device, const physical_device& physical_device, const memory_allocator_description& description) noexcept
+        : _device{ device }
+        , _memory_properties{ physical_device.get_memory_properties() }
+        , _buffer_image_granularity{ std::max<VkDeviceSize>(1, physical_device.get_properties().limits.bufferImageGranularity) }
+        , _non_coherent_atom_size{ std::max<VkDeviceSize>(1, physical_device.get_properties().limits.nonCoherentAtomSize) }
+        , _max_allocation_count{ physical_device.get_properties().limits.maxMemoryAllocationCount }
+        , _block_size{ description.block_size }
+        , _dedicated_threshold{ description.dedicated_threshold ? description.dedicated_threshold : description.block_size / 2 }
+        , _heap_budget_fraction{ std::clamp(description.heap_budget_fraction, 0.0f, 1.0f) }
+    {
+        _pools.resize(static_cast<size_t>(_memory_properties.memoryTypeCount) * 2);
+        for (size_t i = 0; i < _pools.size(); ++i)
+        {
+            _pools[i] = std::make_unique<memory_pool>();
+            _pools[i]->memory_type = static_cast<uint32_t>(i / 2);
+        }
+    }
+
+    memory_allocator::~memory_allocator() noexcept = default;
+
+    int32_t memory_allocator::_find_memory_type(const uint32_t type_bits, const memory_usage usage) const noexcept
+    {
+        const auto [required, preferred, avoided] = get_preference(usage);
+
+        int32_t best_type { -1 };
+        int best_score { INT32_MIN };
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; ++type)
+        {
+            const VkMemoryPropertyFlags flags = _memory_properties.memoryTypes[type].propertyFlags;
+            if (!(type_bits & (1u << type)) || (flags & required) != required)
+            {
+                continue;
+            }
+
+            const int score = std::popcount(flags & preferred) - std::popcount(flags & avoided);
+            if (score > best_score)
+            {
+                best_score = score;
+                best_type = static_cast<int32_t>(type);
+            }
+        }
+
+        return best_type;
+    }
+
+    uint32_t memory_allocator::_pool_index(const uint32_t memory_type, const memory_resource_kind kind) const noexcept
+    {
+        // Without a granularity requirement linear and optimal resources can share blocks
+        if (_buffer_image_granularity <= 1)
+        {
+            return memory_type * 2;
+        }
+
+        return memory_type * 2 + (kind == memory_resource_kind::OPTIMAL ? 1 : 0);
+    }
+
+    bool memory_allocator::_is_host_visible(const uint32_t memory_type) const noexcept
+    {
+        return _memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+
+    VkDeviceSize memory_allocator::_preferred_block_size(const uint32_t heap) const noexcept
+    {
+        const VkDeviceSize heap_size = _memory_properties.memoryHeaps[heap].size;
+        return heap_size <= small_heap_size ? std::min(_block_size, heap_size / 8) : _block_size;
+    }
+
+    expected<memory_allocation, std::string> memory_allocator::allocate(const VkMemoryRequirements& requirements, const allocation_create_info& info) noexcept
+    {
+        if (requirements.size == 0)
+        {
+            return unexpected<std::string>("Cannot allocate zero bytes of device memory");
+        }
+
+        uint32_t type_bits = requirements.memoryTypeBits;
+        std::string last_error { "No memory type satisfies the requirements" };
+
+        // Fall back through compatible memory types when the best one is exhausted
+        for (int32_t type = _find_memory_type(type_bits, info.usage); type >= 0; type = _find_memory_type(type_bits, info.usage))
+        {
+            auto allocation_exp = _allocate_from_type(static_cast<uint32_t>(type), requirements, info);
+            if (allocation_exp.has_value())
+            {
+                return allocation_exp;
+            }
+
+            last_error = allocation_exp.unwrap_error();
+            log::debug("Allocation from memory type {} failed: {}", type, last_error);
+            type_bits &= ~(1u << type);
+        }
+
+        return unexpected(format_str("Failed to allocate {} bytes: {}", requirements.size, last_error));
+    }
+
+    expected<memory_allocation, std::string> memory_allocator::allocate_for_buffer(const VkBuffer buffer, const allocation_create_info& info) noexcept
+    {
+        VkMemoryRequirements requirements {};
+        vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+
+        allocation_create_info buffer_info = info;
+        buffer_info.kind = memory_resource_kind::LINEAR;
+
+        auto allocation_exp = allocate(requirements, buffer_info);
+        if (!allocation_exp.has_value())
+        {
+            return unexpected(std::move(allocation_exp).unwrap_error());
+        }
+
+        auto allocation = allocation_exp.unwrap();
+        if (const VkResult result = vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset); !vk_check(result))
+        {
+            free(allocation);
+            return unexpected(format_str("vkBindBufferMemory failed with {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(allocation);
+    }
+
+    expected<memory_allocation, std::string> memory_allocator::allocate_for_image(const VkImage image, const allocation_create_info& info, const VkImageTiling tiling) noexcept
+    {
+        VkMemoryRequirements requirements {};
+        vkGetImageMemoryRequirements(_device, image, &requirements);
+
+        allocation_create_info image_info = info;
+        image_info.kind = tiling == VK_IMAGE_TILING_OPTIMAL ? memory_resource_kind::OPTIMAL : memory_resource_kind::LINEAR;
+
+        auto allocation_exp = allocate(requirements, image_info);
+        if (!allocation_exp.has_value())
+        {
+            return unexpected(std::move(allocation_exp).unwrap_error());
+        }
+
+        auto allocation = allocation_exp.unwrap();
+        if (const VkResult result = vkBindImageMemory(_device, image, allocation.memory, allocation.offset); !vk_check(result))
+        {
+            free(allocation);
+            return unexpected(format_str("vkBindImageMemory failed with {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(allocation);
+    }
+
+    expected<memory_allocation, std::string> memory_allocator::_allocate_from_type(const uint32_t memory_type, const VkMemoryRequirements& requirements, const allocation_create_info& info) noexcept
+    {
+        if (info.dedicated || requirements.size >= _dedicated_threshold)
+        {
+            return _allocate_dedicated(memory_type, requirements.size);
+        }
+
+        const uint32_t pool_index = _pool_index(memory_type, info.kind);
+        auto& pool = *_pools[pool_index];
+        std::lock_guard lock { pool.mutex };
+
+        const auto make_allocation = [&](const uint32_t block_index, const tlsf_allocator::allocation& range) noexcept
+        {
+            const auto& block = *pool.blocks[block_index];
+
+            memory_allocation allocation {};
+            allocation.memory = block.memory;
+            allocation.offset = range.offset;
+            allocation.size = range.size;
+            allocation.mapped_data = block.mapped ? static_cast<std::byte*>(block.mapped) + range.offset : nullptr;
+            allocation.memory_type = memory_type;
+            allocation._pool = pool_index;
+            allocation._block = block_index;
+            allocation._node = range.node;
+
+            _track_allocation(memory_type, range.size);
+            return allocation;
+        };
+
+        for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+        {
+            if (!pool.blocks[i])
+            {
+                continue;
+            }
+
+            if (const auto range = pool.blocks[i]->allocator.allocate(requirements.size, requirements.alignment))
+            {
+                return ok(make_allocation(i, range.value()));
+            }
+        }
+
+        // No room in the existing blocks. Start with the preferred size and shrink toward the
+        // request if the heap budget cannot take a whole block.
+        const uint32_t heap = _memory_properties.memoryTypes[memory_type].heapIndex;
+        VkDeviceSize block_size = std::max(_preferred_block_size(heap), requirements.size);
+
+        VkDeviceMemory memory { VK_NULL_HANDLE };
+        while (memory == VK_NULL_HANDLE)
+        {
+            auto memory_exp = _allocate_device_memory(memory_type, block_size);
+            if (memory_exp.has_value())
+            {
+                memory = memory_exp.unwrap();
+            }
+            else if (block_size == requirements.size)
+            {
+                return unexpected(std::move(memory_exp).unwrap_error());
+            }
+            else
+            {
+                block_size = std::max(block_size / 2, requirements.size);
+            }
+        }
+
+        auto block = std::make_unique<memory_block>(memory, block_size, nullptr, tlsf_allocator{ block_size });
+        if (_is_host_visible(memory_type))
+        {
+            if (const VkResult result = vkMapMemory(_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped); !vk_check(result))
+            {
+                _free_device_memory(memory_type, block->memory, block_size, false);
+                return unexpected(format_str("vkMapMemory failed with {}", vulkan_result_to_string(result)));
+            }
+        }
+
+        // Take the range before the block joins the pool, so a block that cannot serve the request is never kept
+        const auto range = block->allocator.allocate(requirements.size, requirements.alignment);
+        if (!range.has_value())
+        {
+            _free_device_memory(memory_type, block->memory, block_size, block->mapped != nullptr);
+            return unexpected<std::string>("Fresh memory block could not satisfy the request alignment");
+        }
+
+        log::debug("Allocated {} KiB device memory block for memory type {} (heap {}).", block_size / 1024, memory_type, heap);
+
+        const auto slot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+        const auto block_index = static_cast<uint32_t>(slot - pool.blocks.begin());
+        if (slot == pool.blocks.end())
+        {
+            pool.blocks.push_back(std::move(block));
+        }
+        else
+        {
+            *slot = std::move(block);
+        }
+
+        return ok(make_allocation(block_index, range.value()));
+    }
+
+    expected<memory_allocation, std::string> memory_allocator::_allocate_dedicated(const uint32_t memory_type, const VkDeviceSize size) noexcept
+    {
+        auto memory_exp = _allocate_device_memory(memory_type, size);
+        if (!memory_exp.has_value())
+        {
+            return unexpected(std::move(memory_exp).unwrap_error());
+        }
+
+        memory_allocation allocation {};
+        allocation.memory = memory_exp.unwrap();
+        allocation.offset = 0;
+        allocation.size = size;
+        allocation.memory_type = memory_type;
+
+        if (_is_host_visible(memory_type))
+        {
+            if (const VkResult result = vkMapMemory(_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped_data); !vk_check(result))
+            {
+                _free_device_memory(memory_type, allocation.memory, size, false);
+                return unexpected(format_str("vkMapMemory failed with {}", vulkan_result_to_string(result)));
+            }
+        }
+
+        _track_allocation(memory_type, size);
+        {
+            std::lock_guard lock { _dedicated_mutex };
+            _dedicated.emplace(allocation.memory, allocation);
+        }
+
+        return ok(allocation);
+    }
+
+    expected<VkDeviceMemory, std::string> memory_allocator::_allocate_device_memory(const uint32_t memory_type, const VkDeviceSize size) noexcept
+    {
+        const uint32_t heap = _memory_properties.memoryTypes[memory_type].heapIndex;
+        auto& counters = _heaps[heap];
+
+        // Reserve the bytes and the allocation before calling the driver, so concurrent allocations cannot all pass the check
+        const auto budget = static_cast<VkDeviceSize>(static_cast<double>(_memory_properties.memoryHeaps[heap].size) * _heap_budget_fraction);
+        VkDeviceSize block_bytes = counters.block_bytes.load(std::memory_order_relaxed);
+        do
+        {
+            if (block_bytes + size > budget)
+            {
+                return unexpected(format_str("Heap {} budget of {} bytes exceeded", heap, budget));
+            }
+        }
+        while (!counters.block_bytes.compare_exchange_weak(block_bytes, block_bytes + size, std::memory_order_relaxed));
+
+        uint32_t device_memory_count = _device_memory_count.load(std::memory_order_relaxed);
+        do
+        {
+            if (_max_allocation_count && device_memory_count >= _max_allocation_count)
+            {
+                counters.block_bytes.fetch_sub(size, std::memory_order_relaxed);
+                return unexpected(format_str("maxMemoryAllocationCount ({}) reached", _max_allocation_count));
+            }
+        }
+        while (!_device_memory_count.compare_exchange_weak(device_memory_count, device_memory_count + 1, std::memory_order_relaxed));
+
+        const VkMemoryAllocateInfo allocate_info {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .allocationSize = size,
+            .memoryTypeIndex = memory_type,
+        };
+
+        VkDeviceMemory memory { VK_NULL_HANDLE };
+        if (const VkResult result = vkAllocateMemory(_device, &allocate_info, nullptr, &memory); !vk_check(result))
+        {
+            counters.block_bytes.fetch_sub(size, std::memory_order_relaxed);
+            _device_memory_count.fetch_sub(1, std::memory_order_relaxed);
+            return unexpected(format_str("vkAllocateMemory failed with {}", vulkan_result_to_string(result)));
+        }
+
+        counters.block_count.fetch_add(1, std::memory_order_relaxed);
+        update_peak(counters.peak_block_bytes, block_bytes + size);
+
+        return ok(memory);
+    }
+
+    void memory_allocator::_free_device_memory(const uint32_t memory_type, const VkDeviceMemory memory, const VkDeviceSize size, const bool mapped) noexcept
+    {
+        if (mapped)
+        {
+            vkUnmapMemory(_device, memory);
+        }
+        vkFreeMemory(_device, memory, nullptr);
+
+        auto& counters = _heaps[_memory_properties.memoryTypes[memory_type].heapIndex];
+        counters.block_bytes.fetch_sub(size, std::memory_order_relaxed);
+        counters.block_count.fetch_sub(1, std::memory_order_relaxed);
+        _device_memory_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void memory_allocator::_track_allocation(const uint32_t memory_type, const VkDeviceSize size) noexcept
+    {
+        auto& counters = _heaps[_memory_properties.memoryTypes[memory_type].heapIndex];
+        counters.allocation_count.fetch_add(1, std::memory_order_relaxed);
+        update_peak(counters.peak_allocation_bytes, counters.allocation_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+    }
+
+    void memory_allocator::_untrack_allocation(const uint32_t memory_type, const VkDeviceSize size) noexcept
+    {
+        auto& counters = _heaps[_memory_properties.memoryTypes[memory_type].heapIndex];
+        counters.allocation_count.fetch_sub(1, std::memory_order_relaxed);
+        counters.allocation_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    void memory_allocator::free(memory_allocation& allocation) noexcept
+    {
+        if (!allocation.is_valid())
+        {
+            return;
+        }
+
+        _untrack_allocation(allocation.memory_type, allocation.size);
+
+        if (allocation.is_dedicated())
+        {
+            {
+                std::lock_guard lock { _dedicated_mutex };
+                _dedicated.erase(allocation.memory);
+            }
+            _free_device_memory(allocation.memory_type, allocation.memory, allocation.size, allocation.mapped_data != nullptr);
+            allocation = {};
+            return;
+        }
+
+        auto& pool = *_pools[allocation._pool];
+        std::lock_guard lock { pool.mutex };
+
+        auto& block = pool.blocks[allocation._block];
+        block->allocator.free(allocation._node);
+
+        // Keep one empty block around per pool so that alloc/free churn does not hit vkAllocateMemory
+        if (block->allocator.empty())
+        {
+            const bool has_other_block = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&block](const auto& other)
+            {
+                return other && other != block;
+            });
+
+            if (has_other_block)
+            {
+                _free_device_memory(pool.memory_type, block->memory, block->size, block->mapped != nullptr);
+                block.reset();
+            }
+        }
+
+        allocation = {};
+    }
+
+    VkMappedMemoryRange memory_allocator::_mapped_range(const memory_allocation& allocation, const VkDeviceSize offset, const VkDeviceSize size) const noexcept
+    {
+        const VkDeviceSize begin = allocation.offset + offset;
+        const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+        const VkDeviceSize aligned_begin = begin / _non_coherent_atom_size * _non_coherent_atom_size;
+        const VkDeviceSize aligned_end = (end + _non_coherent_atom_size - 1) / _non_coherent_atom_size * _non_coherent_atom_size;
+
+        // Rounding up can step past the end of the VkDeviceMemory, in which case the spec wants VK_WHOLE_SIZE
+        VkDeviceSize memory_size = allocation.size;
+        if (!allocation.is_dedicated())
+        {
+            auto& pool = *_pools[allocation._pool];
+            std::lock_guard lock { pool.mutex };
+            memory_size = pool.blocks[allocation._block]->size;
+        }
+
+        return VkMappedMemoryRange {
+            .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .pNext = nullptr,
+            .memory = allocation.memory,
+            .offset = aligned_begin,
+            .size = aligned_end >= memory_size ? VK_WHOLE_SIZE : aligned_end - aligned_begin,
+        };
+    }
+
+    VkResult memory_allocator::flush(const memory_allocation& allocation, const VkDeviceSize offset, const VkDeviceSize size) const noexcept
+    {
+        if (!allocation.is_valid() || _memory_properties.memoryTypes[allocation.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        {
+            return VK_SUCCESS;
+        }
+
+        const VkMappedMemoryRange range = _mapped_range(allocation, offset, size);
+        return vkFlushMappedMemoryRanges(_device, 1, &range);
+    }
+
+    VkResult memory_allocator::invalidate(const memory_allocation& allocation, const VkDeviceSize offset, const VkDeviceSize size) const noexcept
+    {
+        if (!allocation.is_valid() || _memory_properties.memoryTypes[allocation.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        {
+            return VK_SUCCESS;
+        }
+
+        const VkMappedMemoryRange range = _mapped_range(allocation, offset, size);
+        return vkInvalidateMappedMemoryRanges(_device, 1, &range);
+    }
+
+    memory_statistics memory_allocator::get_statistics() const noexcept
+    {
+        memory_statistics statistics {};
+        statistics.device_memory_count = _device_memory_count.load(std::memory_order_relaxed);
+
+        for (uint32_t heap = 0; heap < _memory_properties.memoryHeapCount; ++heap)
+        {
+            const auto& counters = _heaps[heap];
+            statistics.heaps.push_back(memory_heap_statistics {
+                .budget = static_cast<VkDeviceSize>(static_cast<double>(_memory_properties.memoryHeaps[heap].size) * _heap_budget_fraction),
+                .block_bytes = counters.block_bytes.load(std::memory_order_relaxed),
+                .allocation_bytes = counters.allocation_bytes.load(std::memory_order_relaxed),
+                .peak_block_bytes = counters.peak_block_bytes.load(std::memory_order_relaxed),
+                .peak_allocation_bytes = counters.peak_allocation_bytes.load(std::memory_order_relaxed),
+                .block_count = counters.block_count.load(std::memory_order_relaxed),
+                .allocation_count = counters.allocation_count.load(std::memory_order_relaxed),
+            });
+        }
+
+        VkDeviceSize largest_free_sum { 0 };
+        for (const auto& pool : _pools)
+        {
+            std::lock_guard lock { pool->mutex };
+            for (const auto& block : pool->blocks)
+            {
+                if (block)
+                {
+                    statistics.free_block_bytes += block->allocator.free_size();
+                    largest_free_sum += block->allocator.largest_free_range();
+                }
+            }
+        }
+
+        if (statistics.free_block_bytes > 0)
+        {
+            statistics.fragmentation = 1.0f - static_cast<float>(static_cast<double>(largest_free_sum) / static_cast<double>(statistics.free_block_bytes));
+        }
+
+        return statistics;
+    }
+
+    void memory_allocator::destroy() noexcept
+    {
+        uint32_t leaked { 0 };
+
+        for (const auto& pool : _pools)
+        {
+            std::lock_guard lock { pool->mutex };
+            for (auto& block : pool->blocks)
+            {
+                if (!block)
+                {
+                    continue;
+                }
+
+                leaked += block->allocator.allocation_count();
+                _free_device_memory(pool->memory_type, block->memory, block->size, block->mapped != nullptr);
+                block.reset();
+            }
+            pool->blocks.clear();
+        }
+
+        {
+            std::lock_guard lock { _dedicated_mutex };
+            for (const auto& [memory, allocation] : _dedicated)
+            {
+                leaked++;
+                _free_device_memory(allocation.memory_type, memory, allocation.size, allocation.mapped_data != nullptr);
+            }
+            _dedicated.clear();
+        }
+
+        if (leaked > 0)
+        {
+            log::warn("Memory allocator destroyed with {} outstanding allocations.", leaked);
+        }
+    }
+} // namespace rhi::vk
@@ -0,0 +1,39 @@
+#include "vk/core/name_table.h"
+
+#include <algorithm>
+
+namespace rhi::vk
+{
+    name_table::name_table(std::vector<std::string_view>& names) noexcept
+    {
+        std::ranges::sort(names);
+        const auto [first_duplicate, end] = std::ranges::unique(names);
+        names.erase(first_duplicate, end);
+
+        size_t storage_size { 0 };
+        for (const std::string_view name : names)
+        {
+            storage_size += name.size() + 1;
+        }
+
+        _storage.reserve(storage_size);
+        _offsets.reserve(names.size());
+        for (const std::string_view name : names)
+        {
+            _offsets.push_back(static_cast<uint32_t>(_storage.size()));
+            _storage.insert(_storage.end(), name.begin(), name.end());
+            _storage.push_back('\0');
+        }
+    }
+
+    const char* name_table::find(const std::string_view name) const noexcept
+    {
+        const auto it = std::ranges::lower_bound(_offsets, name, {}, [this](const uint32_t offset) { return _at(offset); });
+        if (it == _offsets.end() || _at(*it) != name)
+        {
+            return nullptr;
+        }
+
+        return _storage.data() + *it;
+    }
+} // namespace rhi::vk
@@ -0,0 +1,396 @@
+#include "vk/core/offscreen_target.h"
+
+#include <algorithm>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        /// Bytes per texel of the color formats a readback makes sense for, 0 for the rest
+        constexpr uint32_t texel_size(const VkFormat format) noexcept
+        {
+            switch (format)
+            {
+            case VK_FORMAT_R8_UNORM:
+            case VK_FORMAT_R8_UINT:
+                return 1;
+            case VK_FORMAT_R8G8_UNORM:
+            case VK_FORMAT_R16_SFLOAT:
+            case VK_FORMAT_R16_UNORM:
+                return 2;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+            case VK_FORMAT_R16G16_SFLOAT:
+            case VK_FORMAT_R32_SFLOAT:
+            case VK_FORMAT_R32_UINT:
+                return 4;
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+            case VK_FORMAT_R16G16B16A16_UNORM:
+            case VK_FORMAT_R32G32_SFLOAT:
+                return 8;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return 16;
+            default:
+                return 0;
+            }
+        }
+
+        constexpr VkImageSubresourceRange color_range {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+    }
+
+    expected<std::shared_ptr<offscreen_target>, std::string> offscreen_target::create(
+        const VkDevice device,
+        memory_allocator& allocator,
+        const offscreen_target_description& description,
+        offscreen_frame_callback callback
+    ) noexcept
+    {
+        if (description.readback_slots == 0)
+        {
+            return unexpected<std::string>("Offscreen target needs at least one readback slot");
+        }
+
+        if (description.extent.width == 0 || description.extent.height == 0)
+        {
+            return unexpected<std::string>("Offscreen target needs a non-zero extent");
+        }
+
+        const uint32_t texel = texel_size(description.format);
+        if (texel == 0)
+        {
+            return unexpected(format_str("Readback of format {} is not supported", static_cast<int32_t>(description.format)));
+        }
+
+        auto timeline_exp = timeline_semaphore::create(device, 0);
+        if (!timeline_exp.has_value())
+        {
+            return unexpected(format_str("Failed to create offscreen target: {}", timeline_exp.unwrap_error()));
+        }
+
+        std::shared_ptr<offscreen_target> target { new offscreen_target(std::move(timeline_exp).unwrap()) };
+        target->_device = device;
+        target->_allocator = &allocator;
+        target->_description = description;
+        target->_callback = std::move(callback);
+        target->_row_pitch = description.extent.width * texel;
+        target->_frame_size = VkDeviceSize { target->_row_pitch } * description.extent.height;
+
+        const VkImageCreateInfo image_info {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = description.format,
+            .extent = VkExtent3D { description.extent.width, description.extent.height, 1 },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = description.usage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        if (const VkResult result = vkCreateImage(device, &image_info, nullptr, &target->_image); !vk_check(result))
+        {
+            target->destroy();
+            return unexpected(format_str("Failed to create offscreen image. vkCreateImage failed with {}", vulkan_result_to_string(result)));
+        }
+
+        auto image_memory_exp = allocator.allocate_for_image(target->_image, allocation_create_info { .usage = memory_usage::GPU_ONLY });
+        if (!image_memory_exp.has_value())
+        {
+            target->destroy();
+            return unexpected(format_str("Failed to allocate offscreen image memory: {}", image_memory_exp.unwrap_error()));
+        }
+
+        target->_image_memory = image_memory_exp.unwrap();
+
+        const VkImageViewCreateInfo view_info {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = target->_image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = description.format,
+            .components = {},
+            .subresourceRange = color_range,
+        };
+
+        if (const VkResult result = vkCreateImageView(device, &view_info, nullptr, &target->_view); !vk_check(result))
+        {
+            target->destroy();
+            return unexpected(format_str("Failed to create offscreen image view. vkCreateImageView failed with {}", vulkan_result_to_string(result)));
+        }
+
+        target->_slots.resize(description.readback_slots);
+        for (auto& slot : target->_slots)
+        {
+            const VkBufferCreateInfo buffer_info {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .size = target->_frame_size,
+                .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices = nullptr,
+            };
+
+            if (const VkResult result = vkCreateBuffer(device, &buffer_info, nullptr, &slot.buffer); !vk_check(result))
+            {
+                target->destroy();
+                return unexpected(format_str("Failed to create readback buffer. vkCreateBuffer failed with {}", vulkan_result_to_string(result)));
+            }
+
+            auto memory_exp = allocator.allocate_for_buffer(slot.buffer, allocation_create_info { .usage = memory_usage::GPU_TO_CPU, .dedicated = true });
+            if (!memory_exp.has_value())
+            {
+                target->destroy();
+                return unexpected(format_str("Failed to allocate readback memory: {}", memory_exp.unwrap_error()));
+            }
+
+            slot.memory = memory_exp.unwrap();
+            slot.data = static_cast<const std::byte*>(slot.memory.mapped_data);
+            if (slot.data == nullptr)
+            {
+                target->destroy();
+                return unexpected<std::string>("Readback memory is not host visible");
+            }
+        }
+
+        log::debug("Created {}x{} offscreen target with {} readback slots of {} KiB.",
+            description.extent.width, description.extent.height, description.readback_slots, target->_frame_size / 1024);
+
+        return ok(std::move(target));
+    }
+
+    bool offscreen_target::begin_frame(const uint64_t timeout) noexcept
+    {
+        const uint64_t next = _frame_value + 1;
+        (void)poll();
+
+        // The slot still holds a frame the GPU has not finished, only that frame is waited for
+        if (const uint64_t pending = _slot_of(next).frame; pending != 0)
+        {
+            _statistics.stalls++;
+            if (const VkResult result = _timeline.wait(pending, timeout); result == VK_TIMEOUT)
+            {
+                return false;
+            }
+            else if (!vk_check(result))
+            {
+                log::error("Waiting for offscreen frame {} failed with {}", pending, vulkan_result_to_string(result));
+                return false;
+            }
+
+            (void)_deliver(pending);
+        }
+
+        _frame_value = next;
+        return true;
+    }
+
+    void offscreen_target::record_readback(const VkCommandBuffer cmd) noexcept
+    {
+        if (_frame_value == 0 || _recorded == _frame_value)
+        {
+            log::error("Offscreen readback recorded outside of a frame or twice in frame {}", _frame_value);
+            return;
+        }
+
+        readback_slot& slot = _slot_of(_frame_value);
+
+        const VkImageMemoryBarrier to_transfer {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = _description.render_access,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout = _description.render_layout,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _image,
+            .subresourceRange = color_range,
+        };
+
+        vkCmdPipelineBarrier(cmd, _description.render_stages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &to_transfer);
+
+        const VkBufferImageCopy region {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = VkImageSubresourceLayers { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+            .imageOffset = VkOffset3D { 0, 0, 0 },
+            .imageExtent = VkExtent3D { _description.extent.width, _description.extent.height, 1 },
+        };
+
+        vkCmdCopyImageToBuffer(cmd, _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+        // Make the copy visible to the host, and have the next frame's rendering wait for the copy to read the image
+        const VkBufferMemoryBarrier to_host {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = slot.buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+
+        const VkImageMemoryBarrier to_render {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = 0,
+            .dstAccessMask = _description.render_access,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .newLayout = _description.render_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _image,
+            .subresourceRange = color_range,
+        };
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+            0, nullptr, 1, &to_host, 0, nullptr);
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, _description.render_stages, 0,
+            0, nullptr, 0, nullptr, 1, &to_render);
+
+        slot.frame = _frame_value;
+        _recorded = _frame_value;
+    }
+
+    uint32_t offscreen_target::poll() noexcept
+    {
+        if (_delivered == _recorded)
+        {
+            return 0;
+        }
+
+        return _deliver(_timeline.value());
+    }
+
+    VkResult offscreen_target::wait_idle(const uint64_t timeout) noexcept
+    {
+        if (_delivered == _recorded)
+        {
+            return VK_SUCCESS;
+        }
+
+        if (const VkResult result = _timeline.wait(_recorded, timeout); !vk_check(result))
+        {
+            return result;
+        }
+
+        (void)_deliver(_recorded);
+        return VK_SUCCESS;
+    }
+
+    VkTimelineSemaphoreSubmitInfo offscreen_target::signal_submit_info() const noexcept
+    {
+        return VkTimelineSemaphoreSubmitInfo {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = 0,
+            .pWaitSemaphoreValues = nullptr,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &_frame_value,
+        };
+    }
+
+    uint32_t offscreen_target::_deliver(const uint64_t completed) noexcept
+    {
+        uint32_t delivered { 0 };
+        const uint64_t last = std::min(completed, _recorded);
+        for (uint64_t frame = _delivered + 1; frame <= last; frame++)
+        {
+            // Frames that recorded no readback have nothing to deliver
+            readback_slot& slot = _slot_of(frame);
+            if (slot.frame != frame)
+            {
+                continue;
+            }
+
+            (void)_allocator->invalidate(slot.memory, 0, _frame_size);
+            if (_callback)
+            {
+                _callback(offscreen_frame {
+                    .index = frame,
+                    .extent = _description.extent,
+                    .format = _description.format,
+                    .row_pitch = _row_pitch,
+                    .pixels = std::span { slot.data, static_cast<size_t>(_frame_size) },
+                });
+            }
+
+            slot.frame = 0;
+            _statistics.frames++;
+            _statistics.bytes += _frame_size;
+            delivered++;
+        }
+
+        _delivered = std::max(_delivered, last);
+        return delivered;
+    }
+
+    void offscreen_target::destroy() noexcept
+    {
+        if (_recorded > _delivered)
+        {
+            (void)_timeline.wait(_recorded);
+        }
+
+        for (auto& slot : _slots)
+        {
+            if (slot.buffer != VK_NULL_HANDLE)
+            {
+                vkDestroyBuffer(_device, slot.buffer, nullptr);
+            }
+
+            if (slot.memory.is_valid())
+            {
+                _allocator->free(slot.memory);
+            }
+        }
+        _slots.clear();
+
+        if (_view != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(_device, _view, nullptr);
+            _view = VK_NULL_HANDLE;
+        }
+
+        if (_image != VK_NULL_HANDLE)
+        {
+            vkDestroyImage(_device, _image, nullptr);
+            _image = VK_NULL_HANDLE;
+        }
+
+        if (_image_memory.is_valid())
+        {
+            _allocator->free(_image_memory);
+        }
+
+        _delivered = _recorded;
+        _timeline.destroy();
+    }
+} // namespace rhi::vk
@@ -1,11 +1,14 @@
 #include "vk/core/physical_device_handler.h"
 
+#include <algorithm>
+#include <future>
+
 #include "core/log.h"
 #include "vk/core/utils.h"
 
 namespace rhi::vk
 {
-    physical_device_handler::physical_device_handler(const VkInstance instance, const VkSurfaceKHR surface) noexcept
+    physical_device_handler::physical_device_handler(const VkInstance instance, const VkSurfaceKHR surface, const uint32_t api_version, const device_capability_cache* cache) noexcept
         : _instance{ instance }
         , _surface{ surface }
     {
@@ -14,17 +17,34 @@ namespace rhi::vk
         std::vector<VkPhysicalDevice> physical_devices(_device_count);
         vkEnumeratePhysicalDevices(_instance, &_device_count, physical_devices.data());
 
-        for (const VkPhysicalDevice physical_device : physical_devices)
+        // Each probe is a handful of driver queries with no shared state, so the devices are probed concurrently
+        const auto probe = [instance, api_version, cache](const VkPhysicalDevice handle) noexcept
         {
             VkPhysicalDeviceProperties device_props {};
             VkPhysicalDeviceFeatures device_features {};
 
-            vkGetPhysicalDeviceProperties(physical_device, &device_props);
-            vkGetPhysicalDeviceFeatures(physical_device, &device_features);
+            vkGetPhysicalDeviceProperties(handle, &device_props);
+            vkGetPhysicalDeviceFeatures(handle, &device_features);
 
-            auto device = physical_device::create(physical_device, device_props, device_features);
+            return physical_device::create(instance, handle, device_props, device_features, api_version, cache);
+        };
 
-            _devices.push_back(device);
+        std::vector<std::future<physical_device>> probes {};
+        probes.reserve(physical_devices.size());
+        for (size_t i = 1; i < physical_devices.size(); i++)
+        {
+            probes.push_back(std::async(std::launch::async, probe, physical_devices[i]));
+        }
+
+        _devices.reserve(physical_devices.size());
+        if (!physical_devices.empty())
+        {
+            _devices.push_back(probe(physical_devices[0]));
+        }
+
+        for (auto& device : probes)
+        {
+            _devices.push_back(device.get());
         }
     }
 
@@ -63,7 +83,7 @@ namespace rhi::vk
                 return false;
             }
 
-            if (auto swapchain_support_info = swapchain_support_info_exp.unwrap();
+            if (const auto& swapchain_support_info = swapchain_support_info_exp.unwrap();
                 swapchain_support_info.formats.empty()
                 || swapchain_support_info.present_modes.empty())
             {
@@ -87,6 +107,12 @@ namespace rhi::vk
             }
         }
 
+        if (_require_descriptor_indexing && !device.get_descriptor_indexing().is_bindless_capable())
+        {
+            log::debug("Device {} does not support the descriptor indexing features needed for bindless descriptors", device.name());
+            return false;
+        }
+
         return true;
     }
 
@@ -98,25 +124,140 @@ namespace rhi::vk
         }
     }
 
+    void physical_device_handler::require_descriptor_indexing(const bool required) noexcept
+    {
+        _require_descriptor_indexing = required;
+    }
+
+    void physical_device_handler::score_weights(const device_score_weights& weights) noexcept
+    {
+        _score_weights = weights;
+    }
+
+    device_score_input device_score_input::from(const physical_device& device) noexcept
+    {
+        return device_score_input {
+            .properties = device.get_properties(),
+            .memory_properties = device.get_memory_properties(),
+            .queue_families = device.get_queue_families(),
+            .extensions = device.get_extension_names(),
+        };
+    }
+
+    float score_physical_device(const device_score_input& input, const device_score_weights& weights) noexcept
+    {
+        float score { 0.0f };
+
+        switch (input.properties.deviceType)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   score += weights.discrete_gpu; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += weights.integrated_gpu; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    score += weights.virtual_gpu; break;
+        default: break;
+        }
+
+        // Integrated GPUs report system memory as device local too, which the type bonus is there to outweigh
+        VkDeviceSize device_local { 0 };
+        for (uint32_t i = 0; i < input.memory_properties.memoryHeapCount; i++)
+        {
+            const VkMemoryHeap& heap = input.memory_properties.memoryHeaps[i];
+            if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                device_local = std::max(device_local, heap.size);
+            }
+        }
+        score += weights.device_local_gib * static_cast<float>(static_cast<double>(device_local) / (1024.0 * 1024.0 * 1024.0));
+
+        const queue_family_indices families { VK_NULL_HANDLE, input.queue_families, VK_NULL_HANDLE };
+        if (families.has_dedicated_compute())
+        {
+            score += weights.dedicated_compute;
+        }
+
+        if (families.has_dedicated_transfer())
+        {
+            score += weights.dedicated_transfer;
+        }
+
+        score += weights.max_image_dimension_2d * static_cast<float>(input.properties.limits.maxImageDimension2D);
+
+        for (const auto& extension : weights.optional_extensions)
+        {
+            if (input.extensions.contains(extension))
+            {
+                score += weights.optional_extension;
+            }
+        }
+
+        return score;
+    }
+
+    std::vector<size_t> rank_physical_devices(const std::span<const device_score_input> inputs, const device_score_weights& weights) noexcept
+    {
+        std::vector<float> scores {};
+        std::vector<size_t> order {};
+        scores.reserve(inputs.size());
+        order.reserve(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            scores.push_back(score_physical_device(inputs[i], weights));
+            order.push_back(i);
+        }
+
+        std::ranges::stable_sort(order, [&scores](const size_t a, const size_t b) { return scores[a] > scores[b]; });
+
+        return order;
+    }
+
     std::vector<physical_device> physical_device_handler::get_suitable_devices() const noexcept
     {
         log::debug("Getting suitable vulkan physical devices...");
-        std::vector<physical_device> suitable_devices {};
-        for (auto device : _devices)
+
+        // Queue family, extension and swapchain queries of different devices are independent.
+        // The checks run concurrently and the results keep the enumeration order
+        std::vector<physical_device> candidates { _devices };
+        std::vector<std::future<bool>> checks {};
+        checks.reserve(candidates.size());
+        for (size_t i = 1; i < candidates.size(); i++)
         {
-            log::debug("Checking {}...", device.name());
-            if (_is_device_suitable(device))
+            checks.push_back(std::async(std::launch::async, [this, &device = candidates[i]]() noexcept
             {
-                log::debug("Suitable.");
-                suitable_devices.emplace_back(device);
-            }
-            else
+                return _is_device_suitable(device);
+            }));
+        }
+
+        std::vector<bool> suitable(candidates.size(), false);
+        if (!candidates.empty())
+        {
+            suitable[0] = _is_device_suitable(candidates[0]);
+        }
+
+        for (size_t i = 1; i < candidates.size(); i++)
+        {
+            suitable[i] = checks[i - 1].get();
+        }
+
+        std::vector<physical_device> suitable_devices {};
+        std::vector<device_score_input> score_inputs {};
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            log::debug("{}: {}", candidates[i].name(), suitable[i] ? "Suitable." : "Not suitable.");
+            if (suitable[i])
             {
-                log::debug("Not suitable.");
+                score_inputs.push_back(device_score_input::from(candidates[i]));
+                suitable_devices.emplace_back(std::move(candidates[i]));
             }
         }
 
-        return suitable_devices;
+        std::vector<physical_device> ranked_devices {};
+        ranked_devices.reserve(suitable_devices.size());
+        for (const size_t index : rank_physical_devices(score_inputs, _score_weights))
+        {
+            log::debug("Device {} scored {}", suitable_devices[index].name(), score_physical_device(score_inputs[index], _score_weights));
+            ranked_devices.push_back(std::move(suitable_devices[index]));
+        }
+
+        return ranked_devices;
     }
 
 
@@ -126,6 +267,8 @@ namespace rhi::vk
         vkEnumerateDeviceExtensionProperties(_handle, nullptr, &extension_count, nullptr);
         _extensions.resize(extension_count);
         vkEnumerateDeviceExtensionProperties(_handle, nullptr, &extension_count, _extensions.data());
+
+        _extension_names = name_table::create(_extensions, [](const VkExtensionProperties& extension) { return extension.extensionName; });
     }
 
     VkSampleCountFlags physical_device::_get_max_sample_count() const noexcept
@@ -144,38 +287,146 @@ namespace rhi::vk
 
 
 
-    physical_device physical_device::create(VkPhysicalDevice p_device, VkPhysicalDeviceProperties p_properties, VkPhysicalDeviceFeatures p_features) noexcept
+    void physical_device::_query_descriptor_indexing(const uint32_t api_version) noexcept
+    {
+        // Core in 1.2, VK_EXT_descriptor_indexing before that. Either way the query needs the 1.1 entry points,
+        // which an instance created for 1.0 does not expose even when the device supports them
+        if (api_version < VK_API_VERSION_1_1)
+        {
+            return;
+        }
+
+        if (api_version < VK_API_VERSION_1_2 && !is_extension_supported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+        {
+            return;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexing_features {};
+        indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexing_features;
+        vkGetPhysicalDeviceFeatures2(_handle, &features);
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexing_properties {};
+        indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexing_properties;
+        vkGetPhysicalDeviceProperties2(_handle, &properties);
+
+        _descriptor_indexing = descriptor_indexing_support {
+            .sampled_image_update_after_bind = indexing_features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE,
+            .storage_buffer_update_after_bind = indexing_features.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE,
+            .partially_bound = indexing_features.descriptorBindingPartiallyBound == VK_TRUE,
+            .runtime_array = indexing_features.runtimeDescriptorArray == VK_TRUE,
+            .sampled_image_non_uniform_indexing = indexing_features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE,
+            .storage_buffer_non_uniform_indexing = indexing_features.shaderStorageBufferArrayNonUniformIndexing == VK_TRUE,
+            .max_update_after_bind_sampled_images = indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+            .max_update_after_bind_storage_buffers = indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            .max_update_after_bind_samplers = indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+            .max_per_stage_update_after_bind_sampled_images = indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            .max_per_stage_update_after_bind_storage_buffers = indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+            .max_per_stage_update_after_bind_samplers = indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+            .max_per_stage_update_after_bind_resources = indexing_properties.maxPerStageUpdateAfterBindResources,
+        };
+
+        log::debug("Descriptor indexing: bindless {}, update after bind limits {} images, {} buffers, {} samplers",
+            _descriptor_indexing.is_bindless_capable() ? "supported" : "unsupported",
+            _descriptor_indexing.max_update_after_bind_sampled_images,
+            _descriptor_indexing.max_update_after_bind_storage_buffers,
+            _descriptor_indexing.max_update_after_bind_samplers);
+    }
+
+    physical_device physical_device::create(
+        VkInstance instance,
+        VkPhysicalDevice p_device,
+        VkPhysicalDeviceProperties p_properties,
+        VkPhysicalDeviceFeatures p_features,
+        const uint32_t api_version,
+        const device_capability_cache* cache
+    ) noexcept
     {
         log::debug("Creating vulkan physical device: {}", p_properties.deviceName);
         physical_device device {};
+        device._instance = instance;
         device._handle = p_device;
         device._properties = p_properties;
         device._features = p_features;
 
         log::debug("Properties: \n{}", format_physical_device_properties(device._properties, "\t"));
 
-        device._get_extensions();
-
         device._max_sample_count = device._get_max_sample_count();
         device._max_sampler_anisotropy = p_properties.limits.maxSamplerAnisotropy;
 
+        // What can be queried depends on the version both sides support, so the cache entry is keyed by it too
+        const uint32_t effective_version = std::min(api_version, p_properties.apiVersion);
+        if (auto cached = cache != nullptr ? cache->load(p_properties, effective_version) : std::nullopt; cached.has_value())
+        {
+            log::debug("Loaded capabilities of {} from the cache.", p_properties.deviceName);
+            device._memory_properties = cached->memory_properties;
+            device._descriptor_indexing = cached->descriptor_indexing;
+            device._extensions = std::move(cached->extensions);
+            device._extension_names = name_table::create(device._extensions, [](const VkExtensionProperties& extension) { return extension.extensionName; });
+            device._queue_families = std::move(cached->queue_families);
+            return device;
+        }
+
+        device._get_extensions();
+        vkGetPhysicalDeviceMemoryProperties(p_device, &device._memory_properties);
+        device._queue_families = queue_family_indices::query_families(p_device);
+        device._query_descriptor_indexing(effective_version);
+
+        if (cache != nullptr)
+        {
+            (void)cache->store(p_properties, effective_version, device_capabilities {
+                .memory_properties = device._memory_properties,
+                .descriptor_indexing = device._descriptor_indexing,
+                .extensions = device._extensions,
+                .queue_families = device._queue_families,
+            });
+        }
+
         return device;
     }
 
     bool physical_device::is_extension_supported(const char* extension_name) const noexcept
     {
-        for (const auto& extension : _extensions)
+        return _extension_names.contains(extension_name);
+    }
+
+    std::vector<VkTimeDomainEXT> physical_device::get_calibrateable_time_domains() const noexcept
+    {
+        if (!is_extension_supported(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
         {
-            if (strcmp(extension_name, extension.extensionName) == 0)
-            {
-                return true;
-            }
+            return {};
+        }
+
+        const auto get_domains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+        if (get_domains == nullptr)
+        {
+            return {};
+        }
+
+        uint32_t count { 0 };
+        if (!vk_check(get_domains(_handle, &count, nullptr)))
+        {
+            return {};
+        }
+
+        std::vector<VkTimeDomainEXT> domains(count);
+        if (!vk_check(get_domains(_handle, &count, domains.data())))
+        {
+            return {};
         }
+        domains.resize(count);
 
-        return false;
+        return domains;
     }
 
-    expected<swapchain_support, std::string> physical_device::get_swapchain_support(const VkSurfaceKHR surface) noexcept
+    expected<swapchain_support, error> physical_device::get_swapchain_support(const VkSurfaceKHR surface) noexcept
     {
         if (_swapchain_support.has_value())
         {
@@ -198,19 +449,19 @@ namespace rhi::vk
 
         if (const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_handle, surface, &support.capabilities);!vk_check(result))
         {
-            return unexpected<std::string>("Failed to retrieve device surface capabilities");
+            return unexpected(error(error::code::PHYSICAL_DEVICE_FAIL, error::message_id::SURFACE_CAPABILITIES_FAILED, result));
         }
 
         _swapchain_support = support;
 
-        return ok(support);
+        return ok(std::move(support));
     }
 
 
 
     queue_family_indices physical_device::get_queue_family_indices(const VkSurfaceKHR& surface) const noexcept
     {
-        return queue_family_indices{ _handle, surface };
+        return queue_family_indices{ _handle, _queue_families, surface };
     }
 
 
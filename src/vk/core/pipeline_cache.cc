@@ -0,0 +1,234 @@
+#include "vk/core/pipeline_cache.h"
+
+#include <cstring>
+
+#include "core/log.h"
+#include "vk/core/cache_file.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr uint32_t CACHE_FILE_MAGIC = 0x43505652; // "RVPC"
+        constexpr uint32_t CACHE_FILE_VERSION = 2;
+
+        [[nodiscard]] cache_file_identity identity(const VkPhysicalDeviceProperties& properties) noexcept
+        {
+            return {
+                .magic = CACHE_FILE_MAGIC,
+                .version = CACHE_FILE_VERSION,
+                .driver_version = properties.driverVersion,
+                .api_version = properties.apiVersion,
+            };
+        }
+    }
+
+    expected<std::shared_ptr<pipeline_cache>, error> pipeline_cache::create(
+        const VkDevice device,
+        const physical_device& physical_device,
+        const pipeline_cache_description& description
+    ) noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::shared_ptr<pipeline_cache> cache { new pipeline_cache() };
+        cache->_device = device;
+        cache->_properties = physical_device.get_properties();
+        if (!description.directory.empty())
+        {
+            cache->_path = description.directory / cache_file_name("pipeline_cache", cache->_properties);
+        }
+
+        const std::vector<std::byte> initial_data = cache->_load();
+
+        const VkPipelineCacheCreateInfo create_info {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .initialDataSize = initial_data.size(),
+            .pInitialData = initial_data.empty() ? nullptr : initial_data.data(),
+        };
+
+        VkResult result = vkCreatePipelineCache(device, &create_info, nullptr, &cache->_cache);
+        if (result == VK_ERROR_INITIALIZATION_FAILED && !initial_data.empty())
+        {
+            // The driver may still refuse a blob that passed our checks, starting cold is always valid
+            log::warn("Driver rejected pipeline cache {}, starting empty", cache->_path.string());
+            const VkPipelineCacheCreateInfo empty_info {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .initialDataSize = 0,
+                .pInitialData = nullptr,
+            };
+            result = vkCreatePipelineCache(device, &empty_info, nullptr, &cache->_cache);
+        }
+
+        if (!vk_check(result))
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::PIPELINE_CACHE_FAILED, result).with_context("vkCreatePipelineCache"));
+        }
+
+        cache->_statistics.warm = !initial_data.empty();
+        cache->_statistics.loaded_size = initial_data.size();
+        cache->_statistics.load_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        cache->_saved_size = initial_data.size();
+
+        log::debug("Created {} pipeline cache from {} ({} bytes) in {} us.",
+            cache->_statistics.warm ? "warm" : "cold", cache->_path.string(), initial_data.size(), cache->_statistics.load_time.count());
+
+        if (!cache->_path.empty() && description.autosave_interval.count() > 0)
+        {
+            cache->_autosave = std::thread([raw = cache.get(), interval = description.autosave_interval]() { raw->_autosave_loop(interval); });
+        }
+
+        return ok(std::move(cache));
+    }
+
+    std::shared_future<bool> pipeline_cache::save_async() noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        if (_path.empty() || _cache == VK_NULL_HANDLE)
+        {
+            std::promise<bool> skipped {};
+            skipped.set_value(false);
+            return skipped.get_future().share();
+        }
+
+        // Snapshot on the calling thread so the write does not race with destroy()
+        size_t size { 0 };
+        std::vector<std::byte> data {};
+        VkResult result = vkGetPipelineCacheData(_device, _cache, &size, nullptr);
+        if (vk_check(result))
+        {
+            data.resize(size);
+            result = vkGetPipelineCacheData(_device, _cache, &size, data.data());
+            data.resize(size);
+        }
+
+        if (!vk_check(result))
+        {
+            log::error("vkGetPipelineCacheData failed with {}", vulkan_result_to_string(result));
+            std::promise<bool> failed {};
+            failed.set_value(false);
+            return failed.get_future().share();
+        }
+
+        // Writes are serialized so an older snapshot can never replace a newer one
+        _pending_save = std::async(std::launch::async, [this, previous = _pending_save, data = std::move(data)]()
+        {
+            if (previous.valid())
+            {
+                previous.wait();
+            }
+            return _write(data);
+        }).share();
+
+        return _pending_save;
+    }
+
+    pipeline_cache_statistics pipeline_cache::get_statistics() const noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return _statistics;
+    }
+
+    void pipeline_cache::destroy() noexcept
+    {
+        if (_autosave.joinable())
+        {
+            {
+                std::lock_guard lock { _mutex };
+                _stopping = true;
+            }
+            _autosave_condition.notify_all();
+            _autosave.join();
+        }
+
+        if (_cache == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        if (!_path.empty())
+        {
+            save_async().wait();
+        }
+
+        vkDestroyPipelineCache(_device, _cache, nullptr);
+        _cache = VK_NULL_HANDLE;
+    }
+
+    std::vector<std::byte> pipeline_cache::_load() const noexcept
+    {
+        if (_path.empty())
+        {
+            return {};
+        }
+
+        auto data = read_validated(_path, identity(_properties), "pipeline cache");
+        if (!data.has_value() || !_validate(data.value()))
+        {
+            return {};
+        }
+
+        return std::move(data).value();
+    }
+
+    bool pipeline_cache::_validate(const std::span<const std::byte> blob) const noexcept
+    {
+        VkPipelineCacheHeaderVersionOne vk_header {};
+        if (blob.size() < sizeof(vk_header))
+        {
+            log::warn("Pipeline cache {} is too small to hold a driver header, ignoring it", _path.string());
+            return false;
+        }
+        std::memcpy(&vk_header, blob.data(), sizeof(vk_header));
+
+        if (vk_header.headerSize < sizeof(vk_header)
+            || vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            || vk_header.vendorID != _properties.vendorID
+            || vk_header.deviceID != _properties.deviceID
+            || std::memcmp(vk_header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            log::debug("Pipeline cache {} does not match this device, ignoring it", _path.string());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool pipeline_cache::_write(const std::vector<std::byte>& data) noexcept
+    {
+        if (!write_atomically(_path, identity(_properties), data, "pipeline cache"))
+        {
+            return false;
+        }
+
+        std::lock_guard lock { _mutex };
+        _saved_size = data.size();
+        ++_statistics.saves;
+
+        return true;
+    }
+
+    void pipeline_cache::_autosave_loop(const std::chrono::seconds interval) noexcept
+    {
+        std::unique_lock lock { _mutex };
+        while (!_autosave_condition.wait_for(lock, interval, [this]() { return _stopping; }))
+        {
+            // Growth is the only cheap signal that the driver added pipelines since the last save
+            size_t size { 0 };
+            if (!vk_check(vkGetPipelineCacheData(_device, _cache, &size, nullptr)) || size == _saved_size)
+            {
+                continue;
+            }
+
+            lock.unlock();
+            save_async().wait();
+            lock.lock();
+        }
+    }
+} // namespace rhi::vk
@@ -0,0 +1,340 @@
+#include "vk/core/pipeline_compiler.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        /// Serializes the create info into a map key, following every pointer the driver would read
+        class create_info_key
+        {
+        public:
+            /// The key, empty if the create info chains a struct whose contents are not known here
+            [[nodiscard]] std::string get() && noexcept { return _cacheable ? std::move(_key) : std::string {}; }
+
+            void bytes(const void* data, const size_t size) noexcept
+            {
+                _key.append(static_cast<const char*>(data), size);
+            }
+
+            template <typename T>
+            requires std::is_trivially_copyable_v<T>
+            void value(const T& value) noexcept
+            {
+                bytes(&value, sizeof(T));
+            }
+
+            /// Only for Vulkan structs made of 32/64-bit scalars, where there is no padding to pick up
+            template <typename T>
+            requires std::is_trivially_copyable_v<T>
+            void array(const T* values, const uint32_t count) noexcept
+            {
+                value(count);
+                if (values != nullptr)
+                {
+                    bytes(values, sizeof(T) * count);
+                }
+            }
+
+            void string(const char* text) noexcept
+            {
+                if (text != nullptr)
+                {
+                    bytes(text, std::strlen(text));
+                }
+                value('\0');
+            }
+
+            /// Extension structs go into the key by contents. Any other struct may point anywhere, so its
+            /// request is left out of the cache rather than keyed by an address that can be reused
+            void chain(const void* next) noexcept
+            {
+                for (auto* base = static_cast<const VkBaseInStructure*>(next); base != nullptr; base = base->pNext)
+                {
+                    value(base->sType);
+                    switch (base->sType)
+                    {
+                    case VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO:
+                    {
+                        const auto* rendering = reinterpret_cast<const VkPipelineRenderingCreateInfo*>(base);
+                        value(rendering->viewMask);
+                        array(rendering->pColorAttachmentFormats, rendering->colorAttachmentCount);
+                        value(rendering->depthAttachmentFormat);
+                        value(rendering->stencilAttachmentFormat);
+                        break;
+                    }
+                    default:
+                        _cacheable = false;
+                        return;
+                    }
+                }
+                value(VK_STRUCTURE_TYPE_MAX_ENUM);
+            }
+
+            void stage(const VkPipelineShaderStageCreateInfo& stage) noexcept
+            {
+                chain(stage.pNext);
+                value(stage.flags);
+                value(stage.stage);
+                value(stage.module);
+                string(stage.pName);
+
+                const VkSpecializationInfo* specialization = stage.pSpecializationInfo;
+                value(specialization != nullptr);
+                if (specialization != nullptr)
+                {
+                    array(specialization->pMapEntries, specialization->mapEntryCount);
+                    value(specialization->dataSize);
+                    bytes(specialization->pData, specialization->dataSize);
+                }
+            }
+
+            template <typename State, typename F>
+            void optional_state(const State* state, F&& function) noexcept
+            {
+                value(state != nullptr);
+                if (state != nullptr)
+                {
+                    chain(state->pNext);
+                    value(state->flags);
+                    function(*state);
+                }
+            }
+
+        private:
+            std::string _key {};
+            bool _cacheable { true };
+        };
+
+        std::string key_create_info(const VkGraphicsPipelineCreateInfo& info) noexcept
+        {
+            create_info_key key {};
+            key.value(info.sType);
+            key.chain(info.pNext);
+            key.value(info.flags);
+
+            key.value(info.stageCount);
+            for (uint32_t i = 0; i < info.stageCount; ++i)
+            {
+                key.stage(info.pStages[i]);
+            }
+
+            key.optional_state(info.pVertexInputState, [&](const VkPipelineVertexInputStateCreateInfo& state)
+            {
+                key.array(state.pVertexBindingDescriptions, state.vertexBindingDescriptionCount);
+                key.array(state.pVertexAttributeDescriptions, state.vertexAttributeDescriptionCount);
+            });
+            key.optional_state(info.pInputAssemblyState, [&](const VkPipelineInputAssemblyStateCreateInfo& state)
+            {
+                key.value(state.topology);
+                key.value(state.primitiveRestartEnable);
+            });
+            key.optional_state(info.pTessellationState, [&](const VkPipelineTessellationStateCreateInfo& state)
+            {
+                key.value(state.patchControlPoints);
+            });
+            key.optional_state(info.pViewportState, [&](const VkPipelineViewportStateCreateInfo& state)
+            {
+                key.array(state.pViewports, state.viewportCount);
+                key.array(state.pScissors, state.scissorCount);
+            });
+            key.optional_state(info.pRasterizationState, [&](const VkPipelineRasterizationStateCreateInfo& state)
+            {
+                key.value(state.depthClampEnable);
+                key.value(state.rasterizerDiscardEnable);
+                key.value(state.polygonMode);
+                key.value(state.cullMode);
+                key.value(state.frontFace);
+                key.value(state.depthBiasEnable);
+                key.value(state.depthBiasConstantFactor);
+                key.value(state.depthBiasClamp);
+                key.value(state.depthBiasSlopeFactor);
+                key.value(state.lineWidth);
+            });
+            key.optional_state(info.pMultisampleState, [&](const VkPipelineMultisampleStateCreateInfo& state)
+            {
+                key.value(state.rasterizationSamples);
+                key.value(state.sampleShadingEnable);
+                key.value(state.minSampleShading);
+                key.array(state.pSampleMask, state.pSampleMask != nullptr ? (state.rasterizationSamples + 31) / 32 : 0);
+                key.value(state.alphaToCoverageEnable);
+                key.value(state.alphaToOneEnable);
+            });
+            key.optional_state(info.pDepthStencilState, [&](const VkPipelineDepthStencilStateCreateInfo& state)
+            {
+                key.value(state.depthTestEnable);
+                key.value(state.depthWriteEnable);
+                key.value(state.depthCompareOp);
+                key.value(state.depthBoundsTestEnable);
+                key.value(state.stencilTestEnable);
+                key.value(state.front);
+                key.value(state.back);
+                key.value(state.minDepthBounds);
+                key.value(state.maxDepthBounds);
+            });
+            key.optional_state(info.pColorBlendState, [&](const VkPipelineColorBlendStateCreateInfo& state)
+            {
+                key.value(state.logicOpEnable);
+                key.value(state.logicOp);
+                key.array(state.pAttachments, state.attachmentCount);
+                key.value(state.blendConstants);
+            });
+            key.optional_state(info.pDynamicState, [&](const VkPipelineDynamicStateCreateInfo& state)
+            {
+                key.array(state.pDynamicStates, state.dynamicStateCount);
+            });
+
+            key.value(info.layout);
+            key.value(info.renderPass);
+            key.value(info.subpass);
+            key.value(info.basePipelineHandle);
+            key.value(info.basePipelineIndex);
+
+            return std::move(key).get();
+        }
+
+        std::string key_create_info(const VkComputePipelineCreateInfo& info) noexcept
+        {
+            create_info_key key {};
+            key.value(info.sType);
+            key.chain(info.pNext);
+            key.value(info.flags);
+            key.stage(info.stage);
+            key.value(info.layout);
+            key.value(info.basePipelineHandle);
+            key.value(info.basePipelineIndex);
+
+            return std::move(key).get();
+        }
+
+        VkResult create_pipeline(const VkDevice device, const VkPipelineCache cache, const VkGraphicsPipelineCreateInfo& info, VkPipeline& pipeline) noexcept
+        {
+            return vkCreateGraphicsPipelines(device, cache, 1, &info, nullptr, &pipeline);
+        }
+
+        VkResult create_pipeline(const VkDevice device, const VkPipelineCache cache, const VkComputePipelineCreateInfo& info, VkPipeline& pipeline) noexcept
+        {
+            return vkCreateComputePipelines(device, cache, 1, &info, nullptr, &pipeline);
+        }
+    }
+
+    pipeline_compiler::pipeline_compiler(const VkDevice device, const VkPipelineCache cache, std::shared_ptr<thread_pool> workers) noexcept
+        : _device { device }
+        , _cache { cache }
+        , _workers { std::move(workers) }
+    {}
+
+    std::vector<pipeline_future> pipeline_compiler::compile(const std::span<const VkGraphicsPipelineCreateInfo> infos) noexcept
+    {
+        return _compile(infos);
+    }
+
+    std::vector<pipeline_future> pipeline_compiler::compile(const std::span<const VkComputePipelineCreateInfo> infos) noexcept
+    {
+        return _compile(infos);
+    }
+
+    template <typename CreateInfo>
+    std::vector<pipeline_future> pipeline_compiler::_compile(const std::span<const CreateInfo> infos) noexcept
+    {
+        std::vector<pipeline_future> futures {};
+        futures.reserve(infos.size());
+
+        // Build the keys outside the lock, it walks every state struct and dominates the cost of a cache hit
+        std::vector<std::string> keys(infos.size());
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+            keys[i] = key_create_info(infos[i]);
+        }
+
+        std::lock_guard lock { _mutex };
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+            const uint64_t id = _next_id++;
+            if (keys[i].empty())
+            {
+                pipeline_future future = _submit(&infos[i], {}, id);
+                _uncached.push_back(future);
+                futures.push_back(std::move(future));
+                continue;
+            }
+
+            // The map compares the whole key on a hit, so two create infos only share a pipeline when they are equal
+            if (const auto it = _pipelines.find(keys[i]); it != _pipelines.end())
+            {
+                futures.push_back(it->second.future);
+                continue;
+            }
+
+            pipeline_future future = _submit(&infos[i], keys[i], id);
+            _pipelines.emplace(std::move(keys[i]), entry { future, id });
+            futures.push_back(std::move(future));
+        }
+
+        return futures;
+    }
+
+    template <typename CreateInfo>
+    pipeline_future pipeline_compiler::_submit(const CreateInfo* info, std::string key, const uint64_t id) noexcept
+    {
+        return _workers->submit([this, info, key = std::move(key), id]()
+        {
+            VkPipeline pipeline { VK_NULL_HANDLE };
+            if (const VkResult result = create_pipeline(_device, _cache, *info, pipeline); !vk_check(result))
+            {
+                log::error("Pipeline compilation failed with {}", vulkan_result_to_string(result));
+
+                // Forget the failure so the next request compiles again, unless destroy() already took the entry
+                if (!key.empty())
+                {
+                    std::lock_guard lock { _mutex };
+                    if (const auto it = _pipelines.find(key); it != _pipelines.end() && it->second.id == id)
+                    {
+                        _pipelines.erase(it);
+                    }
+                }
+
+                return VkPipeline { VK_NULL_HANDLE };
+            }
+
+            return pipeline;
+        }).share();
+    }
+
+    size_t pipeline_compiler::size() const noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return _pipelines.size() + _uncached.size();
+    }
+
+    void pipeline_compiler::destroy() noexcept
+    {
+        // Take everything out under the lock but wait without it, a failing compilation locks it to erase its entry
+        std::unordered_map<std::string, entry> pipelines {};
+        std::vector<pipeline_future> uncached {};
+        {
+            std::lock_guard lock { _mutex };
+            pipelines.swap(_pipelines);
+            uncached.swap(_uncached);
+        }
+
+        for (auto& [key, entry] : pipelines)
+        {
+            uncached.push_back(std::move(entry.future));
+        }
+
+        for (auto& future : uncached)
+        {
+            if (const VkPipeline pipeline = future.get(); pipeline != VK_NULL_HANDLE)
+            {
+                vkDestroyPipeline(_device, pipeline, nullptr);
+            }
+        }
+    }
+} // namespace rhi::vk
@@ -1,14 +1,18 @@
 #include "vk/core/queue_family_indices.h"
 
+#include <algorithm>
+#include <map>
 #include <vector>
-#include <ranges>
-#include <set>
 
 #include "core/format.h"
 
 namespace rhi::vk
 {
     queue_family_indices::queue_family_indices(VkPhysicalDevice device, VkSurfaceKHR surface) noexcept
+        : queue_family_indices(device, query_families(device), surface)
+    {}
+
+    std::vector<VkQueueFamilyProperties> queue_family_indices::query_families(VkPhysicalDevice device) noexcept
     {
         uint32_t family_count { 0 };
         std::vector<VkQueueFamilyProperties> properties {};
@@ -17,27 +21,53 @@ namespace rhi::vk
         properties.resize(family_count);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, properties.data());
 
+        return properties;
+    }
+
+    queue_family_indices::queue_family_indices(
+        VkPhysicalDevice device,
+        const std::span<const VkQueueFamilyProperties> properties,
+        VkSurfaceKHR surface
+    ) noexcept
+    {
+        _queue_counts.reserve(properties.size());
+        uint32_t max_queue_count { 1 };
+
         uint32_t idx { 0 };
         for (const auto& prop : properties)
         {
-            if (_graphics_family_index && _present_family_index)
+            _queue_counts.push_back(prop.queueCount);
+            max_queue_count = std::max(max_queue_count, prop.queueCount);
+
+            const bool graphics = prop.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            const bool compute = prop.queueFlags & VK_QUEUE_COMPUTE_BIT;
+            const bool transfer = prop.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+            // Graphics/compute
+            if (graphics && compute && !_graphics_family_index.has_value())
             {
-                break;
+                _graphics_family_index = idx;
             }
 
-            // Graphics/compute
+            // Async compute
+            if (compute && !graphics && !_compute_family_index.has_value())
             {
-                if (prop.queueFlags & VK_QUEUE_GRAPHICS_BIT && prop.queueFlags & VK_QUEUE_COMPUTE_BIT)
-                {
-                    _graphics_family_index = idx;
-                }
+                _compute_family_index = idx;
+            }
+
+            // Copy engine. Graphics and compute families support transfers implicitly, so only transfer-only families count
+            if (transfer && !graphics && !compute && !_transfer_family_index.has_value())
+            {
+                _transfer_family_index = idx;
             }
 
             // Present [VK_NULL_HANDLE for surface is assumed to be headless
             if (surface != VK_NULL_HANDLE) {
                 VkBool32 present_support = VK_FALSE;
                 vkGetPhysicalDeviceSurfaceSupportKHR(device, idx, surface, &present_support);
-                if (present_support)
+
+                // Prefer presenting from the graphics family so no ownership transfer is needed
+                if (present_support && (!_present_family_index.has_value() || idx == _graphics_family_index))
                 {
                     _present_family_index = idx;
                 }
@@ -45,45 +75,56 @@ namespace rhi::vk
 
             idx++;
         }
+
+        _priorities.assign(max_queue_count, 1.0f);
     }
 
-    std::string queue_family_indices::get_formatted() const noexcept
+    uint32_t queue_family_indices::get_queue_count(const uint32_t family_index) const noexcept
     {
-        const std::string graphics_string = _graphics_family_index.has_value()
-        ? format_str("{}", _graphics_family_index.value())
-            : "None";
+        return family_index < _queue_counts.size() ? _queue_counts[family_index] : 0;
+    }
 
-        const std::string present_string = _present_family_index.has_value()
-        ? format_str("{}", _present_family_index.value())
-            : "None";
+    std::string queue_family_indices::get_formatted() const noexcept
+    {
+        const auto to_string = [](const std::optional<uint32_t>& index) -> std::string
+        {
+            return index.has_value() ? format_str("{}", index.value()) : "None";
+        };
 
-        return format_str("Graphics Index: {}. Present Index: {}", graphics_string, present_string);
+        return format_str("Graphics Index: {}. Present Index: {}. Compute Index: {}. Transfer Index: {}",
+            to_string(_graphics_family_index), to_string(_present_family_index),
+            to_string(_compute_family_index), to_string(_transfer_family_index));
     }
 
-    std::vector<VkDeviceQueueCreateInfo> queue_family_indices::get_create_infos() const noexcept
+    std::vector<VkDeviceQueueCreateInfo> queue_family_indices::get_create_infos(
+        const uint32_t graphics_count,
+        const uint32_t compute_count,
+        const uint32_t transfer_count
+    ) const noexcept
     {
-        constexpr float priority = 1.0f;
         std::vector<VkDeviceQueueCreateInfo> create_infos {};
-        std::set<uint32_t> unique_indices {};
+        std::map<uint32_t, uint32_t> family_queue_counts {};
 
         if (_graphics_family_index.has_value())
         {
-            unique_indices.insert(_graphics_family_index.value());
+            family_queue_counts[get_graphics()] += std::max(graphics_count, 1u);
+            family_queue_counts[get_compute()] += compute_count;
+            family_queue_counts[get_transfer()] += transfer_count;
         }
 
         if (_present_family_index.has_value())
         {
-            unique_indices.insert(_present_family_index.value());
+            family_queue_counts.try_emplace(_present_family_index.value(), 1);
         }
 
-        for (const auto family_index : unique_indices)
+        for (const auto& [family_index, requested] : family_queue_counts)
         {
             VkDeviceQueueCreateInfo create_info {
                 .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
                 .pNext = nullptr,
                 .queueFamilyIndex = family_index,
-                .queueCount = 1,
-                .pQueuePriorities = &priority,
+                .queueCount = std::clamp(requested, 1u, std::max(get_queue_count(family_index), 1u)),
+                .pQueuePriorities = _priorities.data(),
             };
 
             create_infos.push_back(create_info);
@@ -91,6 +132,4 @@ namespace rhi::vk
 
         return create_infos;
     }
-
-
-}
+} // namespace rhi::vk
@@ -6,6 +6,7 @@
 #define RHI_QUEUE_FAMILY_INDICES_H
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,12 @@ namespace rhi::vk
     public:
         [[nodiscard]] queue_family_indices(VkPhysicalDevice, VkSurfaceKHR) noexcept;
 
+        /// @brief Pick the families from properties fetched earlier. Only present support is queried, as it depends on the surface
+        [[nodiscard]] queue_family_indices(VkPhysicalDevice, std::span<const VkQueueFamilyProperties>, VkSurfaceKHR) noexcept;
+
+        /// @brief vkGetPhysicalDeviceQueueFamilyProperties for every family of the device
+        [[nodiscard]] static std::vector<VkQueueFamilyProperties> query_families(VkPhysicalDevice) noexcept;
+
         [[nodiscard]] bool is_complete() const noexcept
         {
             return _graphics_family_index.has_value() && _present_family_index.has_value();
@@ -26,16 +33,40 @@ namespace rhi::vk
         [[nodiscard]] bool has_graphics() const noexcept { return _graphics_family_index.has_value(); }
         [[nodiscard]] bool has_present() const noexcept { return _present_family_index.has_value(); }
 
+        /// Compute-capable family without graphics, which runs alongside the graphics queue on most desktop GPUs
+        [[nodiscard]] bool has_dedicated_compute() const noexcept { return _compute_family_index.has_value(); }
+
+        /// Transfer family without graphics or compute, usually backed by the copy engines
+        [[nodiscard]] bool has_dedicated_transfer() const noexcept { return _transfer_family_index.has_value(); }
+
         [[nodiscard]] uint32_t get_graphics() const noexcept { return _graphics_family_index.value(); }
         [[nodiscard]] uint32_t get_present() const noexcept { return _present_family_index.value(); }
 
+        /// @brief Dedicated compute family, or the graphics family when there is none
+        [[nodiscard]] uint32_t get_compute() const noexcept { return _compute_family_index.value_or(get_graphics()); }
+
+        /// @brief Dedicated transfer family, falling back to the compute family and then the graphics family
+        [[nodiscard]] uint32_t get_transfer() const noexcept { return _transfer_family_index.value_or(get_compute()); }
+
+        /// @brief Number of queues the family exposes
+        [[nodiscard]] uint32_t get_queue_count(uint32_t family_index) const noexcept;
+
         [[nodiscard]] std::string get_formatted() const noexcept;
 
-        [[nodiscard]] std::vector<VkDeviceQueueCreateInfo> get_create_infos() const noexcept;
+        /// @brief One create info per distinct family, asking for the sum of the queues of every role that maps
+        /// to it, clamped to what the family offers. The priorities point into this object
+        [[nodiscard]] std::vector<VkDeviceQueueCreateInfo> get_create_infos(uint32_t graphics_count = 1, uint32_t compute_count = 0, uint32_t transfer_count = 0) const noexcept;
 
     private:
         std::optional<uint32_t> _graphics_family_index { std::nullopt };
         std::optional<uint32_t> _present_family_index  { std::nullopt };
+        std::optional<uint32_t> _compute_family_index  { std::nullopt };
+        std::optional<uint32_t> _transfer_family_index { std::nullopt };
+
+        std::vector<uint32_t> _queue_counts {};
+
+        /// Backing storage for pQueuePriorities, sized for the largest family
+        std::vector<float> _priorities {};
     };
 } // namespace rhi::vk
 
@@ -0,0 +1,441 @@
+#include "vk/core/swapchain.h"
+
+#include <algorithm>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        VkSurfaceFormatKHR choose_format(const std::vector<VkSurfaceFormatKHR>& formats, const VkSurfaceFormatKHR preferred) noexcept
+        {
+            // A single UNDEFINED entry means the surface takes any format
+            if (formats.size() == 1 && formats.front().format == VK_FORMAT_UNDEFINED)
+            {
+                return preferred;
+            }
+
+            for (const auto& format : formats)
+            {
+                if (format.format == preferred.format && format.colorSpace == preferred.colorSpace)
+                {
+                    return format;
+                }
+            }
+
+            for (const auto& format : formats)
+            {
+                if (format.colorSpace == preferred.colorSpace)
+                {
+                    return format;
+                }
+            }
+
+            return formats.front();
+        }
+
+        VkPresentModeKHR choose_present_mode(const std::vector<VkPresentModeKHR>& modes, const bool low_latency) noexcept
+        {
+            if (low_latency)
+            {
+                for (const VkPresentModeKHR preferred : { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR })
+                {
+                    if (std::ranges::find(modes, preferred) != modes.end())
+                    {
+                        return preferred;
+                    }
+                }
+            }
+
+            // The only mode every surface has to support
+            return VK_PRESENT_MODE_FIFO_KHR;
+        }
+
+        const char* present_mode_name(const VkPresentModeKHR mode) noexcept
+        {
+            switch (mode)
+            {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:
+                return "IMMEDIATE";
+            case VK_PRESENT_MODE_MAILBOX_KHR:
+                return "MAILBOX";
+            case VK_PRESENT_MODE_FIFO_KHR:
+                return "FIFO";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+                return "FIFO_RELAXED";
+            default:
+                return "UNKNOWN";
+            }
+        }
+
+        VkCompositeAlphaFlagBitsKHR choose_composite_alpha(const VkCompositeAlphaFlagsKHR supported) noexcept
+        {
+            for (const VkCompositeAlphaFlagBitsKHR alpha : {
+                     VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+                     VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+                     VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR,
+                     VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR })
+            {
+                if ((supported & alpha) != 0)
+                {
+                    return alpha;
+                }
+            }
+
+            return VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        }
+
+        VkResult create_semaphore(const VkDevice device, VkSemaphore& semaphore) noexcept
+        {
+            const VkSemaphoreCreateInfo semaphore_info {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+            };
+
+            return vkCreateSemaphore(device, &semaphore_info, nullptr, &semaphore);
+        }
+    }
+
+    expected<std::shared_ptr<swapchain>, error> swapchain::create(
+        const VkDevice device,
+        const VkPhysicalDevice physical_device,
+        const VkSurfaceKHR surface,
+        device_queue& present_queue,
+        const swapchain_support& support,
+        const swapchain_description& description
+    ) noexcept
+    {
+        if (surface == VK_NULL_HANDLE)
+        {
+            return unexpected(error(error::code::SWAPCHAIN_FAIL, error::message_id::CREATE_SWAPCHAIN_FAILED).with_context("no surface"));
+        }
+
+        if (support.formats.empty())
+        {
+            return unexpected(error(error::code::SWAPCHAIN_FAIL, error::message_id::CREATE_SWAPCHAIN_FAILED).with_context("surface reports no formats"));
+        }
+
+        std::shared_ptr<swapchain> result { new swapchain() };
+        result->_device = device;
+        result->_physical_device = physical_device;
+        result->_surface = surface;
+        result->_present_queue = &present_queue;
+        result->_description = description;
+        result->_format = choose_format(support.formats, description.format);
+        result->_present_mode = choose_present_mode(support.present_modes, description.low_latency);
+
+        if (description.low_latency && result->_present_mode == VK_PRESENT_MODE_FIFO_KHR)
+        {
+            log::warn("Low latency presentation requested, but the surface supports neither MAILBOX nor IMMEDIATE. Using FIFO");
+        }
+
+        // A minimized window gets its images on the first acquire instead
+        if (const VkResult rebuild_result = result->rebuild(description.extent); rebuild_result != VK_SUCCESS && rebuild_result != VK_NOT_READY)
+        {
+            result->destroy();
+            return unexpected(error(error::code::SWAPCHAIN_FAIL, error::message_id::CREATE_SWAPCHAIN_FAILED, rebuild_result).with_context("initial creation"));
+        }
+
+        // Rebuilds after this count as resizes
+        result->_statistics.rebuilds = 0;
+        return ok(std::move(result));
+    }
+
+    VkResult swapchain::acquire(swapchain_frame& frame, const uint64_t timeout) noexcept
+    {
+        _release_retired();
+
+        if (_needs_rebuild || _current.handle == VK_NULL_HANDLE)
+        {
+            if (const VkResult result = rebuild(); !vk_check(result))
+            {
+                return result;
+            }
+        }
+
+        // A resize between rebuilding and acquiring is answered with one more rebuild, not a loop
+        for (uint32_t attempt = 0; attempt < 2; attempt++)
+        {
+            const VkSemaphore acquired = _acquire_semaphores[_acquire_index];
+            uint32_t image_index { 0 };
+
+            const auto start = std::chrono::steady_clock::now();
+            const VkResult result = vkAcquireNextImageKHR(_device, _current.handle, timeout, acquired, VK_NULL_HANDLE, &image_index);
+            _acquired_at = std::chrono::steady_clock::now();
+            _last_timing.acquire_wait = std::chrono::duration_cast<std::chrono::nanoseconds>(_acquired_at - start);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                _statistics.out_of_date++;
+                if (const VkResult rebuild_result = rebuild(); !vk_check(rebuild_result))
+                {
+                    return rebuild_result;
+                }
+                continue;
+            }
+
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                return result;
+            }
+
+            // Still presentable, the images are recreated before the next frame
+            if (result == VK_SUBOPTIMAL_KHR)
+            {
+                _statistics.suboptimal++;
+                _needs_rebuild = true;
+            }
+
+            frame = swapchain_frame {
+                .image_index = image_index,
+                .image = _current.images[image_index],
+                .view = _current.views[image_index],
+                .acquired = acquired,
+                .render_finished = _current.render_finished[image_index],
+            };
+
+            _acquire_index = (_acquire_index + 1) % static_cast<uint32_t>(_acquire_semaphores.size());
+            _frames++;
+            return result;
+        }
+
+        return VK_ERROR_OUT_OF_DATE_KHR;
+    }
+
+    VkResult swapchain::present(const swapchain_frame& frame) noexcept
+    {
+        const VkPresentInfoKHR present_info {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &frame.render_finished,
+            .swapchainCount = 1,
+            .pSwapchains = &_current.handle,
+            .pImageIndices = &frame.image_index,
+            .pResults = nullptr,
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        const VkResult result = _present_queue->present(present_info);
+        const auto end = std::chrono::steady_clock::now();
+
+        _last_timing.acquire_to_present = std::chrono::duration_cast<std::chrono::nanoseconds>(start - _acquired_at);
+        _last_timing.present = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+
+        _statistics.frames++;
+        _statistics.total.acquire_wait += _last_timing.acquire_wait;
+        _statistics.total.acquire_to_present += _last_timing.acquire_to_present;
+        _statistics.total.present += _last_timing.present;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            _statistics.out_of_date++;
+            _needs_rebuild = true;
+        }
+        else if (result == VK_SUBOPTIMAL_KHR)
+        {
+            _statistics.suboptimal++;
+            _needs_rebuild = true;
+        }
+
+        return result;
+    }
+
+    VkResult swapchain::rebuild(const VkExtent2D extent) noexcept
+    {
+        VkSurfaceCapabilitiesKHR capabilities {};
+        if (const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physical_device, _surface, &capabilities); !vk_check(result))
+        {
+            log::error("Failed to query surface capabilities: {}", vulkan_result_to_string(result));
+            return result;
+        }
+
+        // currentExtent is the window size, except for surfaces that let the swapchain decide
+        VkExtent2D image_extent = capabilities.currentExtent;
+        if (image_extent.width == UINT32_MAX)
+        {
+            const VkExtent2D requested = extent.width != 0 && extent.height != 0 ? extent : _description.extent;
+            image_extent.width = std::clamp(requested.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+            image_extent.height = std::clamp(requested.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+        }
+
+        // Minimized, nothing to present to until the window comes back
+        if (image_extent.width == 0 || image_extent.height == 0)
+        {
+            _needs_rebuild = true;
+            return VK_NOT_READY;
+        }
+
+        uint32_t image_count = capabilities.minImageCount + _description.extra_images;
+        if (capabilities.maxImageCount > 0)
+        {
+            image_count = std::min(image_count, capabilities.maxImageCount);
+        }
+
+        const VkSwapchainCreateInfoKHR create_info {
+            .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+            .pNext = nullptr,
+            .flags = 0,
+            .surface = _surface,
+            .minImageCount = image_count,
+            .imageFormat = _format.format,
+            .imageColorSpace = _format.colorSpace,
+            .imageExtent = image_extent,
+            .imageArrayLayers = 1,
+            .imageUsage = _description.usage,
+            .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .preTransform = capabilities.currentTransform,
+            .compositeAlpha = choose_composite_alpha(capabilities.supportedCompositeAlpha),
+            .presentMode = _present_mode,
+            .clipped = VK_TRUE,
+            .oldSwapchain = _current.handle,
+        };
+
+        generation next {};
+        next.extent = image_extent;
+        if (const VkResult result = vkCreateSwapchainKHR(_device, &create_info, nullptr, &next.handle); !vk_check(result))
+        {
+            log::error("vkCreateSwapchainKHR failed with {}", vulkan_result_to_string(result));
+            _retire_current();
+            return result;
+        }
+
+        uint32_t created_count { 0 };
+        VkResult result = vkGetSwapchainImagesKHR(_device, next.handle, &created_count, nullptr);
+        if (vk_check(result))
+        {
+            next.images.resize(created_count);
+            result = vkGetSwapchainImagesKHR(_device, next.handle, &created_count, next.images.data());
+        }
+
+        for (size_t i = 0; i < next.images.size() && vk_check(result); i++)
+        {
+            const VkImageViewCreateInfo view_info {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .image = next.images[i],
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = _format.format,
+                .components = {},
+                .subresourceRange = VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+            };
+
+            VkImageView view { VK_NULL_HANDLE };
+            result = vkCreateImageView(_device, &view_info, nullptr, &view);
+            if (vk_check(result))
+            {
+                next.views.push_back(view);
+
+                VkSemaphore semaphore { VK_NULL_HANDLE };
+                result = create_semaphore(_device, semaphore);
+                if (vk_check(result))
+                {
+                    next.render_finished.push_back(semaphore);
+                }
+            }
+        }
+
+        // The application holds at most images - minImageCount + 1 images without blocking in acquire
+        const uint32_t frames_in_flight = std::max(1u, created_count + 1 - std::min(created_count, capabilities.minImageCount));
+        while (vk_check(result) && _acquire_semaphores.size() < frames_in_flight + 1)
+        {
+            VkSemaphore semaphore { VK_NULL_HANDLE };
+            result = create_semaphore(_device, semaphore);
+            if (vk_check(result))
+            {
+                _acquire_semaphores.push_back(semaphore);
+            }
+        }
+
+        if (!vk_check(result))
+        {
+            log::error("Failed to set up swapchain images: {}", vulkan_result_to_string(result));
+
+            _destroy(next);
+            _retire_current();
+            return result;
+        }
+
+        if (_current.handle != VK_NULL_HANDLE)
+        {
+            _retire_current();
+            _statistics.rebuilds++;
+        }
+
+        _current = std::move(next);
+        _frames_in_flight = frames_in_flight;
+        _needs_rebuild = false;
+
+        log::debug("Swapchain {}x{}: {} images, {} frames in flight, {} present mode.",
+            image_extent.width, image_extent.height, created_count, frames_in_flight, present_mode_name(_present_mode));
+
+        return VK_SUCCESS;
+    }
+
+    void swapchain::_retire_current() noexcept
+    {
+        // Passing a swapchain as oldSwapchain retires it even if the creation fails, it cannot be presented to anymore
+        if (_current.handle != VK_NULL_HANDLE)
+        {
+            _current.retired_at = _frames;
+            _retired.push_back(std::move(_current));
+        }
+
+        _current = {};
+        _needs_rebuild = true;
+    }
+
+    void swapchain::_release_retired() noexcept
+    {
+        // Once frames_in_flight newer frames were acquired, the paced frames that used the old images are done
+        while (!_retired.empty() && _frames >= _retired.front().retired_at + _frames_in_flight + 1)
+        {
+            _destroy(_retired.front());
+            _retired.pop_front();
+        }
+    }
+
+    void swapchain::_destroy(generation& generation) const noexcept
+    {
+        for (const VkSemaphore semaphore : generation.render_finished)
+        {
+            vkDestroySemaphore(_device, semaphore, nullptr);
+        }
+
+        for (const VkImageView view : generation.views)
+        {
+            vkDestroyImageView(_device, view, nullptr);
+        }
+
+        if (generation.handle != VK_NULL_HANDLE)
+        {
+            vkDestroySwapchainKHR(_device, generation.handle, nullptr);
+        }
+
+        generation = {};
+    }
+
+    void swapchain::destroy() noexcept
+    {
+        for (auto& retired : _retired)
+        {
+            _destroy(retired);
+        }
+        _retired.clear();
+
+        _destroy(_current);
+
+        for (const VkSemaphore semaphore : _acquire_semaphores)
+        {
+            vkDestroySemaphore(_device, semaphore, nullptr);
+        }
+        _acquire_semaphores.clear();
+    }
+} // namespace rhi::vk
@@ -0,0 +1,103 @@
+#include "vk/core/timeline_semaphore.h"
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        PFN_vkVoidFunction load_device_function(const VkDevice device, const char* core_name, const char* khr_name) noexcept
+        {
+            if (const PFN_vkVoidFunction function = vkGetDeviceProcAddr(device, core_name))
+            {
+                return function;
+            }
+
+            return vkGetDeviceProcAddr(device, khr_name);
+        }
+    }
+
+    expected<timeline_semaphore, std::string> timeline_semaphore::create(const VkDevice device, const uint64_t initial_value) noexcept
+    {
+        timeline_semaphore semaphore {};
+        semaphore._handle = VK_NULL_HANDLE;
+        semaphore._device = device;
+        semaphore._wait = (PFN_vkWaitSemaphores)load_device_function(device, "vkWaitSemaphores", "vkWaitSemaphoresKHR");
+        semaphore._signal = (PFN_vkSignalSemaphore)load_device_function(device, "vkSignalSemaphore", "vkSignalSemaphoreKHR");
+        semaphore._get_value = (PFN_vkGetSemaphoreCounterValue)load_device_function(device, "vkGetSemaphoreCounterValue", "vkGetSemaphoreCounterValueKHR");
+
+        if (semaphore._wait == nullptr || semaphore._signal == nullptr || semaphore._get_value == nullptr)
+        {
+            return unexpected<std::string>("Timeline semaphores are not enabled on this device");
+        }
+
+        const VkSemaphoreTypeCreateInfo type_info {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .pNext = nullptr,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = initial_value,
+        };
+
+        const VkSemaphoreCreateInfo create_info {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_info,
+            .flags = 0,
+        };
+
+        if (const VkResult result = vkCreateSemaphore(device, &create_info, nullptr, &semaphore._handle); !vk_check(result))
+        {
+            return unexpected(format_str("Failed to create timeline semaphore. vkCreateSemaphore failed with {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(std::move(semaphore));
+    }
+
+    VkResult timeline_semaphore::signal(const uint64_t value) const noexcept
+    {
+        const VkSemaphoreSignalInfo signal_info {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+            .pNext = nullptr,
+            .semaphore = _handle,
+            .value = value,
+        };
+
+        return _signal(_device, &signal_info);
+    }
+
+    VkResult timeline_semaphore::wait(const uint64_t value, const uint64_t timeout) const noexcept
+    {
+        const VkSemaphoreWaitInfo wait_info {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .semaphoreCount = 1,
+            .pSemaphores = &_handle,
+            .pValues = &value,
+        };
+
+        return _wait(_device, &wait_info, timeout);
+    }
+
+    uint64_t timeline_semaphore::value() const noexcept
+    {
+        uint64_t value { 0 };
+        if (const VkResult result = _get_value(_device, _handle, &value); !vk_check(result))
+        {
+            log::error("vkGetSemaphoreCounterValue failed with {}", vulkan_result_to_string(result));
+            return 0;
+        }
+
+        return value;
+    }
+
+    void timeline_semaphore::destroy() noexcept
+    {
+        if (_handle != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(_device, _handle, nullptr);
+            _handle = VK_NULL_HANDLE;
+        }
+    }
+} // namespace rhi::vk
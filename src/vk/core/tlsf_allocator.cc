@@ -0,0 +1,312 @@
+#include "vk/core/tlsf_allocator.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr uint64_t align_up(const uint64_t value, const uint64_t alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    tlsf_allocator::tlsf_allocator(const uint64_t size) noexcept
+        : _size{ size }
+    {
+        for (auto& heads : _free_heads)
+        {
+            heads.fill(invalid_node);
+        }
+
+        if (size == 0)
+        {
+            return;
+        }
+
+        const uint32_t root = _new_node();
+        _nodes[root].offset = 0;
+        _nodes[root].size = size;
+        _insert_free(root);
+    }
+
+    tlsf_allocator::mapping tlsf_allocator::_map(const uint64_t size) noexcept
+    {
+        if (size < _sl_index_count)
+        {
+            return { 0, static_cast<uint32_t>(size) };
+        }
+
+        const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        return {
+            msb - _sl_index_log2 + 1,
+            static_cast<uint32_t>(size >> (msb - _sl_index_log2)) ^ _sl_index_count
+        };
+    }
+
+    tlsf_allocator::mapping tlsf_allocator::_map_search(uint64_t size) noexcept
+    {
+        // Round the request up to the next list boundary so that every range in the
+        // list we land on is guaranteed to be large enough.
+        if (size >= _sl_index_count)
+        {
+            const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+            const uint64_t round = (uint64_t { 1 } << (msb - _sl_index_log2)) - 1;
+            if (size > UINT64_MAX - round)
+            {
+                return { _fl_index_count, 0 };
+            }
+            size += round;
+        }
+
+        return _map(size);
+    }
+
+    uint32_t tlsf_allocator::_find_free(const uint64_t size) const noexcept
+    {
+        auto [fl, sl] = _map_search(size);
+        if (fl >= _fl_index_count)
+        {
+            return invalid_node;
+        }
+
+        uint32_t sl_map = _sl_bitmaps[fl] & (~0u << sl);
+        if (sl_map == 0)
+        {
+            const uint64_t fl_map = fl + 1 < 64 ? _fl_bitmap & (~uint64_t { 0 } << (fl + 1)) : 0;
+            if (fl_map == 0)
+            {
+                return invalid_node;
+            }
+
+            fl = static_cast<uint32_t>(std::countr_zero(fl_map));
+            sl_map = _sl_bitmaps[fl];
+        }
+
+        sl = static_cast<uint32_t>(std::countr_zero(sl_map));
+        return _free_heads[fl][sl];
+    }
+
+    std::optional<tlsf_allocator::allocation> tlsf_allocator::allocate(const uint64_t size, uint64_t alignment) noexcept
+    {
+        if (size == 0 || size > _free_size)
+        {
+            return std::nullopt;
+        }
+
+        alignment = alignment == 0 ? 1 : alignment;
+
+        // Most ranges already start on a suitable boundary, so try the good fit first and only
+        // pay for the worst case padding when that fails.
+        uint32_t index = _find_free(size);
+        if (index != invalid_node)
+        {
+            const auto& candidate = _nodes[index];
+            if (align_up(candidate.offset, alignment) + size > candidate.offset + candidate.size)
+            {
+                index = invalid_node;
+            }
+        }
+
+        if (index == invalid_node && alignment > 1)
+        {
+            index = _find_free(size + alignment - 1);
+        }
+
+        // Rounding up skips the list the size itself maps to, whose ranges may still fit. Without this
+        // a request exactly the size of a free range fails unless the size is a list boundary
+        if (index == invalid_node)
+        {
+            const auto [fl, sl] = _map(size);
+            const uint32_t head = _free_heads[fl][sl];
+            if (head != invalid_node && align_up(_nodes[head].offset, alignment) + size <= _nodes[head].offset + _nodes[head].size)
+            {
+                index = head;
+            }
+        }
+
+        if (index == invalid_node)
+        {
+            return std::nullopt;
+        }
+
+        _remove_free(index);
+
+        const uint64_t padding = align_up(_nodes[index].offset, alignment) - _nodes[index].offset;
+        if (padding > 0)
+        {
+            const uint32_t tail = _split(index, padding);
+            _insert_free(index);
+            index = tail;
+        }
+
+        if (_nodes[index].size > size)
+        {
+            const uint32_t rest = _split(index, size);
+            _insert_free(rest);
+        }
+
+        _nodes[index].is_free = false;
+        _allocation_count++;
+
+        return allocation { _nodes[index].offset, _nodes[index].size, index };
+    }
+
+    void tlsf_allocator::free(uint32_t index) noexcept
+    {
+        if (index >= _nodes.size() || _nodes[index].is_free)
+        {
+            return;
+        }
+
+        _allocation_count--;
+
+        if (const uint32_t next = _nodes[index].next_physical; next != invalid_node && _nodes[next].is_free)
+        {
+            _remove_free(next);
+            _merge_with_next(index);
+        }
+
+        if (const uint32_t prev = _nodes[index].prev_physical; prev != invalid_node && _nodes[prev].is_free)
+        {
+            _remove_free(prev);
+            _merge_with_next(prev);
+            index = prev;
+        }
+
+        _insert_free(index);
+    }
+
+    uint64_t tlsf_allocator::largest_free_range() const noexcept
+    {
+        if (_fl_bitmap == 0)
+        {
+            return 0;
+        }
+
+        const uint32_t fl = 63 - static_cast<uint32_t>(std::countl_zero(_fl_bitmap));
+        const uint32_t sl = 31 - static_cast<uint32_t>(std::countl_zero(_sl_bitmaps[fl]));
+
+        uint64_t largest { 0 };
+        for (uint32_t index = _free_heads[fl][sl]; index != invalid_node; index = _nodes[index].next_free)
+        {
+            largest = std::max(largest, _nodes[index].size);
+        }
+
+        return largest;
+    }
+
+    uint32_t tlsf_allocator::_new_node() noexcept
+    {
+        if (!_unused_nodes.empty())
+        {
+            const uint32_t index = _unused_nodes.back();
+            _unused_nodes.pop_back();
+            _nodes[index] = node {};
+            return index;
+        }
+
+        _nodes.emplace_back();
+        return static_cast<uint32_t>(_nodes.size() - 1);
+    }
+
+    void tlsf_allocator::_release_node(const uint32_t index) noexcept
+    {
+        _nodes[index] = node {};
+        _unused_nodes.push_back(index);
+    }
+
+    void tlsf_allocator::_insert_free(const uint32_t index) noexcept
+    {
+        const auto [fl, sl] = _map(_nodes[index].size);
+        const uint32_t head = _free_heads[fl][sl];
+
+        auto& n = _nodes[index];
+        n.is_free = true;
+        n.prev_free = invalid_node;
+        n.next_free = head;
+        if (head != invalid_node)
+        {
+            _nodes[head].prev_free = index;
+        }
+
+        _free_heads[fl][sl] = index;
+        _sl_bitmaps[fl] |= 1u << sl;
+        _fl_bitmap |= uint64_t { 1 } << fl;
+
+        _free_size += n.size;
+        _free_range_count++;
+    }
+
+    void tlsf_allocator::_remove_free(const uint32_t index) noexcept
+    {
+        auto& n = _nodes[index];
+        const auto [fl, sl] = _map(n.size);
+
+        if (n.prev_free != invalid_node)
+        {
+            _nodes[n.prev_free].next_free = n.next_free;
+        }
+        if (n.next_free != invalid_node)
+        {
+            _nodes[n.next_free].prev_free = n.prev_free;
+        }
+
+        if (_free_heads[fl][sl] == index)
+        {
+            _free_heads[fl][sl] = n.next_free;
+            if (n.next_free == invalid_node)
+            {
+                _sl_bitmaps[fl] &= ~(1u << sl);
+                if (_sl_bitmaps[fl] == 0)
+                {
+                    _fl_bitmap &= ~(uint64_t { 1 } << fl);
+                }
+            }
+        }
+
+        n.is_free = false;
+        n.prev_free = invalid_node;
+        n.next_free = invalid_node;
+
+        _free_size -= n.size;
+        _free_range_count--;
+    }
+
+    uint32_t tlsf_allocator::_split(const uint32_t index, const uint64_t size) noexcept
+    {
+        const uint32_t rest = _new_node();
+
+        auto& n = _nodes[index];
+        auto& r = _nodes[rest];
+        r.offset = n.offset + size;
+        r.size = n.size - size;
+        r.prev_physical = index;
+        r.next_physical = n.next_physical;
+        if (n.next_physical != invalid_node)
+        {
+            _nodes[n.next_physical].prev_physical = rest;
+        }
+
+        n.next_physical = rest;
+        n.size = size;
+
+        return rest;
+    }
+
+    void tlsf_allocator::_merge_with_next(const uint32_t index) noexcept
+    {
+        const uint32_t next = _nodes[index].next_physical;
+
+        _nodes[index].size += _nodes[next].size;
+        _nodes[index].next_physical = _nodes[next].next_physical;
+        if (_nodes[next].next_physical != invalid_node)
+        {
+            _nodes[_nodes[next].next_physical].prev_physical = index;
+        }
+
+        _release_node(next);
+    }
+} // namespace rhi::vk
@@ -0,0 +1,90 @@
+#ifndef RHI_TLSF_ALLOCATOR_H
+#define RHI_TLSF_ALLOCATOR_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rhi::vk
+{
+    /// Two-Level Segregated Fit bookkeeping for a single range of memory.
+    /// This only tracks offsets, it never touches the memory itself, so the same
+    /// structure can sit on top of a VkDeviceMemory block or anything else.
+    class tlsf_allocator
+    {
+    public:
+        static constexpr uint32_t invalid_node = UINT32_MAX;
+
+        struct allocation
+        {
+            uint64_t offset { 0 };
+            uint64_t size { 0 };
+            uint32_t node { invalid_node };
+        };
+
+    public:
+        [[nodiscard]] explicit tlsf_allocator(uint64_t size) noexcept;
+
+        /// @brief Allocate a range of the given size whose offset is a multiple of alignment (power of two)
+        [[nodiscard]] std::optional<allocation> allocate(uint64_t size, uint64_t alignment) noexcept;
+
+        /// @brief Release the range owned by the node returned from allocate()
+        void free(uint32_t node) noexcept;
+
+        [[nodiscard]] uint64_t size() const noexcept { return _size; }
+        [[nodiscard]] uint64_t free_size() const noexcept { return _free_size; }
+        [[nodiscard]] uint64_t largest_free_range() const noexcept;
+        [[nodiscard]] uint32_t allocation_count() const noexcept { return _allocation_count; }
+        [[nodiscard]] uint32_t free_range_count() const noexcept { return _free_range_count; }
+        [[nodiscard]] bool empty() const noexcept { return _allocation_count == 0; }
+
+    private:
+        static constexpr uint32_t _sl_index_log2 = 4;
+        static constexpr uint32_t _sl_index_count = 1u << _sl_index_log2;
+        static constexpr uint32_t _fl_index_count = 64 - _sl_index_log2 + 1;
+
+        struct node
+        {
+            uint64_t offset { 0 };
+            uint64_t size { 0 };
+            uint32_t prev_physical { invalid_node };
+            uint32_t next_physical { invalid_node };
+            uint32_t prev_free { invalid_node };
+            uint32_t next_free { invalid_node };
+            bool is_free { false };
+        };
+
+        struct mapping
+        {
+            uint32_t fl { 0 };
+            uint32_t sl { 0 };
+        };
+
+        [[nodiscard]] static mapping _map(uint64_t size) noexcept;
+        [[nodiscard]] static mapping _map_search(uint64_t size) noexcept;
+
+        [[nodiscard]] uint32_t _find_free(uint64_t size) const noexcept;
+        [[nodiscard]] uint32_t _new_node() noexcept;
+        void _release_node(uint32_t) noexcept;
+        void _insert_free(uint32_t) noexcept;
+        void _remove_free(uint32_t) noexcept;
+        [[nodiscard]] uint32_t _split(uint32_t, uint64_t) noexcept;
+        void _merge_with_next(uint32_t) noexcept;
+
+    private:
+        uint64_t _size { 0 };
+        uint64_t _free_size { 0 };
+        uint32_t _allocation_count { 0 };
+        uint32_t _free_range_count { 0 };
+
+        uint64_t _fl_bitmap { 0 };
+        std::array<uint32_t, _fl_index_count> _sl_bitmaps {};
+        std::array<std::array<uint32_t, _sl_index_count>, _fl_index_count> _free_heads {};
+
+        std::vector<node> _nodes {};
+        std::vector<uint32_t> _unused_nodes {};
+    };
+} // namespace rhi::vk
+
+#endif //RHI_TLSF_ALLOCATOR_H
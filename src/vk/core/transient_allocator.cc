@@ -0,0 +1,208 @@
+#include "vk/core/transient_allocator.h"
+
+#include <algorithm>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr VkDeviceSize align_up(const VkDeviceSize value, const VkDeviceSize alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    expected<std::shared_ptr<transient_allocator>, error> transient_allocator::create(
+        const VkDevice device,
+        memory_allocator& allocator,
+        const physical_device& physical_device,
+        const transient_allocator_description& description
+    ) noexcept
+    {
+        if (description.frame_size == 0 || description.frames_in_flight == 0)
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::TRANSIENT_ALLOCATOR_FAILED).with_context("needs a non-zero frame size and frame count"));
+        }
+
+        std::shared_ptr<transient_allocator> transient { new transient_allocator() };
+        transient->_device = device;
+        transient->_allocator = &allocator;
+
+        const auto& limits = physical_device.get_properties().limits;
+        transient->_alignment = std::max<VkDeviceSize>({
+            1,
+            limits.minUniformBufferOffsetAlignment,
+            limits.minStorageBufferOffsetAlignment,
+        });
+        transient->_frame_size = align_up(description.frame_size, transient->_alignment);
+        transient->_frame = description.frames_in_flight - 1;
+        transient->_fences.resize(description.frames_in_flight, VK_NULL_HANDLE);
+        transient->_retire_values.resize(description.frames_in_flight, 0);
+
+        const VkBufferCreateInfo buffer_info {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = transient->_frame_size * description.frames_in_flight,
+            .usage = description.usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+        };
+
+        if (const VkResult result = vkCreateBuffer(device, &buffer_info, nullptr, &transient->_buffer); !vk_check(result))
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::TRANSIENT_ALLOCATOR_FAILED, result).with_context("vkCreateBuffer"));
+        }
+
+        auto memory_exp = allocator.allocate_for_buffer(transient->_buffer, allocation_create_info { .usage = memory_usage::CPU_TO_GPU });
+        if (!memory_exp.has_value())
+        {
+            vkDestroyBuffer(device, transient->_buffer, nullptr);
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::TRANSIENT_ALLOCATOR_FAILED).with_context(memory_exp.unwrap_error()));
+        }
+
+        transient->_memory = memory_exp.unwrap();
+        transient->_data = static_cast<std::byte*>(transient->_memory.mapped_data);
+        if (transient->_data == nullptr)
+        {
+            transient->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::TRANSIENT_ALLOCATOR_FAILED).with_context("transient buffer memory is not host visible"));
+        }
+
+        log::debug("Created transient allocator: {} frames of {} KiB, alignment {}.",
+            description.frames_in_flight, transient->_frame_size / 1024, transient->_alignment);
+
+        return ok(std::move(transient));
+    }
+
+    std::optional<transient_allocation> transient_allocator::allocate(const VkDeviceSize size) noexcept
+    {
+        const VkDeviceSize aligned_size = align_up(size, _alignment);
+
+        // Every size is a multiple of the base alignment so a single add keeps the head aligned
+        const VkDeviceSize offset = _head.fetch_add(aligned_size, std::memory_order_relaxed);
+        if (offset + aligned_size > _frame_size)
+        {
+            return std::nullopt;
+        }
+
+        const VkDeviceSize buffer_offset = static_cast<VkDeviceSize>(_frame) * _frame_size + offset;
+        return transient_allocation { _buffer, buffer_offset, size, _data + buffer_offset };
+    }
+
+    std::optional<transient_allocation> transient_allocator::allocate(const VkDeviceSize size, const VkDeviceSize alignment) noexcept
+    {
+        if (alignment <= _alignment)
+        {
+            return allocate(size);
+        }
+
+        const VkDeviceSize aligned_size = align_up(size, _alignment);
+        const VkDeviceSize frame_base = static_cast<VkDeviceSize>(_frame) * _frame_size;
+
+        VkDeviceSize head = _head.load(std::memory_order_relaxed);
+        VkDeviceSize offset { 0 };
+        do
+        {
+            offset = align_up(frame_base + head, alignment) - frame_base;
+            if (offset + aligned_size > _frame_size)
+            {
+                return std::nullopt;
+            }
+        } while (!_head.compare_exchange_weak(head, offset + aligned_size, std::memory_order_relaxed));
+
+        return transient_allocation { _buffer, frame_base + offset, size, _data + frame_base + offset };
+    }
+
+    std::optional<transient_allocation> transient_allocator::push(const std::span<const std::byte> bytes) noexcept
+    {
+        auto allocation = allocate(bytes.size());
+        if (allocation.has_value())
+        {
+            std::memcpy(allocation->data, bytes.data(), bytes.size());
+        }
+
+        return allocation;
+    }
+
+    bool transient_allocator::begin_frame(const uint64_t timeout) noexcept
+    {
+        const uint32_t next = (_frame + 1) % static_cast<uint32_t>(_fences.size());
+
+        if (VkFence& fence = _fences[next]; fence != VK_NULL_HANDLE)
+        {
+            if (const VkResult result = vkWaitForFences(_device, 1, &fence, VK_TRUE, timeout); result == VK_TIMEOUT)
+            {
+                return false;
+            }
+            else if (!vk_check(result))
+            {
+                log::error("Waiting on transient frame {} failed with {}", next, vulkan_result_to_string(result));
+                return false;
+            }
+            fence = VK_NULL_HANDLE;
+        }
+
+        if (uint64_t& retire_value = _retire_values[next]; retire_value != 0)
+        {
+            if (const VkResult result = _timeline->wait(retire_value, timeout); result == VK_TIMEOUT)
+            {
+                return false;
+            }
+            else if (!vk_check(result))
+            {
+                log::error("Waiting on transient frame {} failed with {}", next, vulkan_result_to_string(result));
+                return false;
+            }
+            retire_value = 0;
+        }
+
+        _frame = next;
+        _head.store(0, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    void transient_allocator::end_frame(const VkFence fence) noexcept
+    {
+        _fences[_frame] = fence;
+        _flush_frame();
+    }
+
+    void transient_allocator::end_frame(const timeline_semaphore& timeline, const uint64_t value) noexcept
+    {
+        _timeline = &timeline;
+        _retire_values[_frame] = value;
+        _flush_frame();
+    }
+
+    void transient_allocator::_flush_frame() const noexcept
+    {
+        if (const VkDeviceSize frame_used = used(); frame_used > 0)
+        {
+            _allocator->flush(_memory, static_cast<VkDeviceSize>(_frame) * _frame_size, frame_used);
+        }
+    }
+
+    VkDeviceSize transient_allocator::used() const noexcept
+    {
+        return std::min(_head.load(std::memory_order_relaxed), _frame_size);
+    }
+
+    void transient_allocator::destroy() noexcept
+    {
+        if (_buffer != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(_device, _buffer, nullptr);
+            _buffer = VK_NULL_HANDLE;
+        }
+
+        _allocator->free(_memory);
+        _data = nullptr;
+    }
+} // namespace rhi::vk
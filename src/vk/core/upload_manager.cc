@@ -0,0 +1,597 @@
+#include "vk/core/upload_manager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        constexpr VkDeviceSize align_up(const VkDeviceSize value, const VkDeviceSize alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        constexpr bool same_subresource(const image_upload_description& a, const image_upload_description& b) noexcept
+        {
+            return a.image == b.image
+                && a.subresource.aspectMask == b.subresource.aspectMask
+                && a.subresource.mipLevel == b.subresource.mipLevel
+                && a.subresource.baseArrayLayer == b.subresource.baseArrayLayer
+                && a.subresource.layerCount == b.subresource.layerCount;
+        }
+
+        constexpr VkImageSubresourceRange to_range(const VkImageSubresourceLayers& layers) noexcept
+        {
+            return VkImageSubresourceRange {
+                .aspectMask = layers.aspectMask,
+                .baseMipLevel = layers.mipLevel,
+                .levelCount = 1,
+                .baseArrayLayer = layers.baseArrayLayer,
+                .layerCount = layers.layerCount,
+            };
+        }
+    }
+
+    expected<std::shared_ptr<upload_manager>, error> upload_manager::create(
+        const VkDevice device,
+        memory_allocator& allocator,
+        const physical_device& physical_device,
+        device_queue& transfer_queue,
+        const uint32_t consumer_family_index,
+        const upload_manager_description& description
+    ) noexcept
+    {
+        if (description.staging_size == 0)
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED).with_context("needs a non-zero staging size"));
+        }
+
+        auto timeline_exp = timeline_semaphore::create(device, 0);
+        if (!timeline_exp.has_value())
+        {
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED).with_context(timeline_exp.unwrap_error()));
+        }
+
+        std::shared_ptr<upload_manager> manager { new upload_manager(std::move(timeline_exp).unwrap()) };
+        manager->_device = device;
+        manager->_allocator = &allocator;
+        manager->_queue = &transfer_queue;
+        manager->_consumer_family_index = consumer_family_index;
+        manager->_batch_size = description.batch_size;
+
+        // Image copies need texel aligned offsets, 16 covers every format up to RGBA32
+        const auto& limits = physical_device.get_properties().limits;
+        manager->_alignment = std::max<VkDeviceSize>(16, limits.optimalBufferCopyOffsetAlignment);
+        manager->_staging_size = align_up(description.staging_size, manager->_alignment);
+
+        const VkCommandPoolCreateInfo pool_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = transfer_queue.family_index(),
+        };
+
+        if (const VkResult result = vkCreateCommandPool(device, &pool_info, nullptr, &manager->_pool); !vk_check(result))
+        {
+            manager->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED, result).with_context("vkCreateCommandPool"));
+        }
+
+        const VkBufferCreateInfo buffer_info {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = manager->_staging_size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+        };
+
+        if (const VkResult result = vkCreateBuffer(device, &buffer_info, nullptr, &manager->_staging); !vk_check(result))
+        {
+            manager->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED, result).with_context("vkCreateBuffer"));
+        }
+
+        auto memory_exp = allocator.allocate_for_buffer(manager->_staging, allocation_create_info { .usage = memory_usage::CPU_ONLY, .dedicated = true });
+        if (!memory_exp.has_value())
+        {
+            manager->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED).with_context(memory_exp.unwrap_error()));
+        }
+
+        manager->_staging_memory = memory_exp.unwrap();
+        manager->_staging_data = static_cast<std::byte*>(manager->_staging_memory.mapped_data);
+        if (manager->_staging_data == nullptr)
+        {
+            manager->destroy();
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::UPLOAD_MANAGER_FAILED).with_context("staging memory is not host visible"));
+        }
+
+        log::debug("Created upload manager: {} MiB staging ring on queue family {}, consumer family {}.",
+            manager->_staging_size / (1024 * 1024), transfer_queue.family_index(), consumer_family_index);
+
+        return ok(std::move(manager));
+    }
+
+    expected<upload_ticket, std::string> upload_manager::upload(const buffer_upload_description& description, const std::span<const std::byte> data) noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        // Data larger than the ring goes through in ring sized pieces, each piece may end up in its own batch
+        VkDeviceSize uploaded { 0 };
+        while (uploaded < data.size())
+        {
+            const VkDeviceSize chunk = std::min<VkDeviceSize>(data.size() - uploaded, _staging_size);
+
+            auto offset_exp = _reserve(chunk);
+            if (!offset_exp.has_value())
+            {
+                return unexpected(std::move(offset_exp).unwrap_error());
+            }
+
+            const VkDeviceSize offset = offset_exp.unwrap();
+            _stage(offset, data.subspan(uploaded, chunk));
+
+            const VkDeviceSize dst_offset = description.offset + uploaded;
+
+            // Back to back writes into one buffer become a single region
+            if (!_buffer_copies.empty())
+            {
+                auto& [target, region] = _buffer_copies.back();
+                if (target.buffer == description.buffer
+                    && target.dst_stages == description.dst_stages
+                    && target.dst_access == description.dst_access
+                    && region.srcOffset + region.size == offset
+                    && region.dstOffset + region.size == dst_offset)
+                {
+                    region.size += chunk;
+                    _pending_bytes += chunk;
+                    uploaded += chunk;
+                    continue;
+                }
+            }
+
+            _buffer_copies.push_back(buffer_copy {
+                .target = description,
+                .region = VkBufferCopy { .srcOffset = offset, .dstOffset = dst_offset, .size = chunk },
+            });
+
+            _pending_bytes += chunk;
+            uploaded += chunk;
+        }
+
+        _statistics.uploads++;
+        _statistics.bytes += data.size();
+
+        const upload_ticket ticket = _next_ticket;
+        if (_batch_size > 0 && _pending_bytes >= _batch_size)
+        {
+            if (const VkResult result = _submit(); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to submit uploads: {}", vulkan_result_to_string(result)));
+            }
+        }
+
+        return ok(ticket);
+    }
+
+    expected<upload_ticket, std::string> upload_manager::upload(const image_upload_description& description, const std::span<const std::byte> data) noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        if (data.size() > _staging_size)
+        {
+            return unexpected(format_str("Image upload of {} bytes does not fit the {} byte staging ring", data.size(), _staging_size));
+        }
+
+        auto offset_exp = _reserve(data.size());
+        if (!offset_exp.has_value())
+        {
+            return unexpected(std::move(offset_exp).unwrap_error());
+        }
+
+        const VkDeviceSize offset = offset_exp.unwrap();
+        _stage(offset, data);
+
+        _image_copies.push_back(image_copy {
+            .target = description,
+            .region = VkBufferImageCopy {
+                .bufferOffset = offset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = description.subresource,
+                .imageOffset = description.offset,
+                .imageExtent = description.extent,
+            },
+        });
+
+        _pending_bytes += data.size();
+        _statistics.uploads++;
+        _statistics.bytes += data.size();
+
+        const upload_ticket ticket = _next_ticket;
+        if (_batch_size > 0 && _pending_bytes >= _batch_size)
+        {
+            if (const VkResult result = _submit(); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to submit uploads: {}", vulkan_result_to_string(result)));
+            }
+        }
+
+        return ok(ticket);
+    }
+
+    expected<upload_ticket, std::string> upload_manager::flush() noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        if (const VkResult result = _submit(); !vk_check(result))
+        {
+            return unexpected(format_str("Failed to submit uploads: {}", vulkan_result_to_string(result)));
+        }
+
+        return ok(_next_ticket - 1);
+    }
+
+    bool upload_manager::is_complete(const upload_ticket ticket) const noexcept
+    {
+        return _timeline.is_reached(ticket);
+    }
+
+    VkResult upload_manager::wait(const upload_ticket ticket, const uint64_t timeout) noexcept
+    {
+        {
+            std::lock_guard lock { _mutex };
+            if (ticket >= _next_ticket)
+            {
+                if (const VkResult result = _submit(); !vk_check(result))
+                {
+                    return result;
+                }
+            }
+        }
+
+        return _timeline.wait(ticket, timeout);
+    }
+
+    upload_ticket upload_manager::record_acquires(const VkCommandBuffer cmd) noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        if (_buffer_acquires.empty() && _image_acquires.empty())
+        {
+            return 0;
+        }
+
+        acquire_ownership(cmd, _queue->family_index(), _consumer_family_index, _buffer_acquires, _image_acquires);
+        _buffer_acquires.clear();
+        _image_acquires.clear();
+
+        return _acquire_ticket;
+    }
+
+    upload_statistics upload_manager::get_statistics() const noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return _statistics;
+    }
+
+    expected<VkDeviceSize, std::string> upload_manager::_reserve(const VkDeviceSize size) noexcept
+    {
+        const VkDeviceSize aligned_size = align_up(size, _alignment);
+
+        while (true)
+        {
+            _retire();
+
+            // Allocations never wrap around the end of the ring, the rest of the lap is skipped instead
+            const VkDeviceSize ring_offset = _head % _staging_size;
+            VkDeviceSize padding = ring_offset + aligned_size > _staging_size ? _staging_size - ring_offset : 0;
+
+            // Nothing staged or in flight, the skipped bytes can be released right away
+            if (_head == _tail)
+            {
+                _head += padding;
+                _tail = _head;
+                padding = 0;
+            }
+
+            if (_head + padding + aligned_size - _tail <= _staging_size)
+            {
+                _head += padding + aligned_size;
+                return ok((_head - aligned_size) % _staging_size);
+            }
+
+            // Out of space. Queued copies hold part of the ring, so they go out first
+            if (!_buffer_copies.empty() || !_image_copies.empty())
+            {
+                if (const VkResult result = _submit(); !vk_check(result))
+                {
+                    return unexpected(format_str("Failed to submit uploads: {}", vulkan_result_to_string(result)));
+                }
+            }
+
+            if (_in_flight.empty())
+            {
+                return unexpected(format_str("Staging ring of {} bytes cannot hold {} bytes", _staging_size, size));
+            }
+
+            _statistics.stalls++;
+            if (const VkResult result = _timeline.wait(_in_flight.front().ticket); !vk_check(result))
+            {
+                return unexpected(format_str("Waiting for staging space failed with {}", vulkan_result_to_string(result)));
+            }
+        }
+    }
+
+    void upload_manager::_stage(const VkDeviceSize offset, const std::span<const std::byte> data) const noexcept
+    {
+        std::memcpy(_staging_data + offset, data.data(), data.size());
+        (void)_allocator->flush(_staging_memory, offset, data.size());
+    }
+
+    void upload_manager::_retire() noexcept
+    {
+        if (_in_flight.empty())
+        {
+            return;
+        }
+
+        const uint64_t completed = _timeline.value();
+        while (!_in_flight.empty() && _in_flight.front().ticket <= completed)
+        {
+            _free_command_buffers.push_back(_in_flight.front().cmd);
+            _tail = _in_flight.front().staging_end;
+            _in_flight.pop_front();
+        }
+    }
+
+    VkResult upload_manager::_submit() noexcept
+    {
+        if (_buffer_copies.empty() && _image_copies.empty())
+        {
+            return VK_SUCCESS;
+        }
+
+        VkCommandBuffer cmd { VK_NULL_HANDLE };
+        if (const VkResult result = _acquire_command_buffer(cmd); !vk_check(result))
+        {
+            return result;
+        }
+
+        std::vector<buffer_ownership_transfer> buffers {};
+        std::vector<image_ownership_transfer> images {};
+        if (const VkResult result = _record(cmd, buffers, images); !vk_check(result))
+        {
+            _free_command_buffers.push_back(cmd);
+            return result;
+        }
+
+        const upload_ticket ticket = _next_ticket;
+        const VkSemaphore semaphore = _timeline.get();
+
+        const VkTimelineSemaphoreSubmitInfo timeline_info {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = 0,
+            .pWaitSemaphoreValues = nullptr,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &ticket,
+        };
+
+        const VkSubmitInfo submit_info {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &timeline_info,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmd,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &semaphore,
+        };
+
+        if (const VkResult result = _queue->submit(submit_info); !vk_check(result))
+        {
+            _free_command_buffers.push_back(cmd);
+            return result;
+        }
+
+        // Only a submitted release may be acquired, a failed batch stays queued and is recorded again
+        _in_flight.push_back(batch { .cmd = cmd, .ticket = ticket, .staging_end = _head });
+        _buffer_acquires.insert(_buffer_acquires.end(), buffers.begin(), buffers.end());
+        _image_acquires.insert(_image_acquires.end(), images.begin(), images.end());
+        _acquire_ticket = ticket;
+        _next_ticket++;
+
+        _buffer_copies.clear();
+        _image_copies.clear();
+        _pending_bytes = 0;
+        _statistics.submits++;
+
+        return VK_SUCCESS;
+    }
+
+    VkResult upload_manager::_acquire_command_buffer(VkCommandBuffer& cmd) noexcept
+    {
+        if (!_free_command_buffers.empty())
+        {
+            cmd = _free_command_buffers.back();
+            _free_command_buffers.pop_back();
+            return VK_SUCCESS;
+        }
+
+        const VkCommandBufferAllocateInfo allocate_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = _pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        return vkAllocateCommandBuffers(_device, &allocate_info, &cmd);
+    }
+
+    VkResult upload_manager::_record(
+        const VkCommandBuffer cmd,
+        std::vector<buffer_ownership_transfer>& buffers,
+        std::vector<image_ownership_transfer>& images
+    ) noexcept
+    {
+        const VkCommandBufferBeginInfo begin_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        // The pool allows individual resets, so beginning a recycled buffer resets it implicitly
+        if (const VkResult result = vkBeginCommandBuffer(cmd, &begin_info); !vk_check(result))
+        {
+            return result;
+        }
+
+        // Every subresource is moved to TRANSFER_DST once per batch, before its first copy
+        std::vector<VkImageMemoryBarrier> barriers {};
+        for (size_t i = 0; i < _image_copies.size(); i++)
+        {
+            const auto& target = _image_copies[i].target;
+            const bool seen = std::any_of(_image_copies.begin(), _image_copies.begin() + static_cast<std::ptrdiff_t>(i),
+                [&](const image_copy& earlier) { return same_subresource(earlier.target, target); });
+
+            if (seen)
+            {
+                continue;
+            }
+
+            barriers.push_back(VkImageMemoryBarrier {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .oldLayout = target.initial_layout,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = target.image,
+                .subresourceRange = to_range(target.subresource),
+            });
+
+            images.push_back(image_ownership_transfer {
+                .image = target.image,
+                .range = to_range(target.subresource),
+                .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .new_layout = target.final_layout,
+                .src_stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .src_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dst_stages = target.dst_stages,
+                .dst_access = target.dst_access,
+            });
+        }
+
+        if (!barriers.empty())
+        {
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        }
+
+        // Group by destination so each buffer and image gets one copy command with all of its regions
+        std::ranges::stable_sort(_buffer_copies, {}, [](const buffer_copy& c) { return c.target.buffer; });
+        std::ranges::stable_sort(_image_copies, {}, [](const image_copy& c) { return c.target.image; });
+
+        std::vector<VkBufferCopy> buffer_regions {};
+        for (size_t first = 0; first < _buffer_copies.size();)
+        {
+            const VkBuffer buffer = _buffer_copies[first].target.buffer;
+
+            buffer_regions.clear();
+            size_t last = first;
+            for (; last < _buffer_copies.size() && _buffer_copies[last].target.buffer == buffer; last++)
+            {
+                const auto& [target, region] = _buffer_copies[last];
+                buffer_regions.push_back(region);
+                buffers.push_back(buffer_ownership_transfer {
+                    .buffer = buffer,
+                    .offset = region.dstOffset,
+                    .size = region.size,
+                    .src_stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .src_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dst_stages = target.dst_stages,
+                    .dst_access = target.dst_access,
+                });
+            }
+
+            vkCmdCopyBuffer(cmd, _staging, buffer, static_cast<uint32_t>(buffer_regions.size()), buffer_regions.data());
+            _statistics.copy_commands++;
+            first = last;
+        }
+
+        std::vector<VkBufferImageCopy> image_regions {};
+        for (size_t first = 0; first < _image_copies.size();)
+        {
+            const VkImage image = _image_copies[first].target.image;
+
+            image_regions.clear();
+            size_t last = first;
+            for (; last < _image_copies.size() && _image_copies[last].target.image == image; last++)
+            {
+                image_regions.push_back(_image_copies[last].region);
+            }
+
+            vkCmdCopyBufferToImage(cmd, _staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(image_regions.size()), image_regions.data());
+            _statistics.copy_commands++;
+            first = last;
+        }
+
+        // Hand the data to the consumer family. With a shared family the release is a no-op and the
+        // acquire side records the whole barrier
+        release_ownership(cmd, _queue->family_index(), _consumer_family_index, buffers, images);
+
+        return vkEndCommandBuffer(cmd);
+    }
+
+    void upload_manager::destroy() noexcept
+    {
+        std::lock_guard lock { _mutex };
+
+        if (_pool != VK_NULL_HANDLE)
+        {
+            if (const VkResult result = _submit(); !vk_check(result))
+            {
+                log::warn("Dropping queued uploads, submit failed with {}", vulkan_result_to_string(result));
+            }
+
+            if (!_in_flight.empty())
+            {
+                (void)_timeline.wait(_in_flight.back().ticket);
+            }
+
+            _in_flight.clear();
+            _free_command_buffers.clear();
+            vkDestroyCommandPool(_device, _pool, nullptr);
+            _pool = VK_NULL_HANDLE;
+        }
+
+        if (_staging != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(_device, _staging, nullptr);
+            _staging = VK_NULL_HANDLE;
+        }
+
+        if (_staging_memory.is_valid())
+        {
+            _allocator->free(_staging_memory);
+        }
+
+        _staging_data = nullptr;
+        _timeline.destroy();
+    }
+} // namespace rhi::vk
@@ -0,0 +1,173 @@
+#include "vk/core/validation_filter.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "core/format.h"
+#include "core/log.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        /// Messages without an id number, e.g. from the loader, are keyed by their name or text instead
+        uint64_t message_key(const VkDebugUtilsMessengerCallbackDataEXT& data) noexcept
+        {
+            if (data.messageIdNumber != 0)
+            {
+                return static_cast<uint32_t>(data.messageIdNumber);
+            }
+
+            const char* name = data.pMessageIdName != nullptr ? data.pMessageIdName : data.pMessage;
+            const size_t hash = std::hash<std::string_view> {}(name != nullptr ? name : "");
+            return static_cast<uint64_t>(hash) | (uint64_t { 1 } << 63);
+        }
+    }
+
+    validation_filter::validation_filter(const validation_filter_settings& settings) noexcept
+        : _settings { settings }
+        , _last_summary { std::chrono::steady_clock::now() }
+    {}
+
+    bool validation_filter::admit(const VkDebugUtilsMessengerCallbackDataEXT& data, const VkDebugUtilsMessageSeverityFlagBitsEXT severity) noexcept
+    {
+        const auto now = std::chrono::steady_clock::now();
+        bool admitted { true };
+        std::string summary {};
+        {
+            std::lock_guard lock { _mutex };
+            auto [it, inserted] = _entries.try_emplace(message_key(data));
+            entry& message = it->second;
+            if (inserted)
+            {
+                message.stats.id = data.messageIdNumber;
+                message.stats.name = data.pMessageIdName != nullptr ? data.pMessageIdName : "";
+                message.window_start = now;
+            }
+
+            message.stats.count++;
+            message.stats.severity = std::max(message.stats.severity, severity);
+            _total_messages++;
+
+            if (_settings.messages_per_window > 0)
+            {
+                if (now - message.window_start >= _settings.rate_window)
+                {
+                    message.window_start = now;
+                    message.window_count = 0;
+                }
+
+                admitted = message.window_count < _settings.messages_per_window;
+                if (admitted)
+                {
+                    message.window_count++;
+                }
+                else
+                {
+                    message.stats.suppressed++;
+                    message.suppressed_since_summary++;
+                    _total_suppressed++;
+                }
+            }
+
+            if (_settings.summary_interval.count() > 0 && now - _last_summary >= _settings.summary_interval)
+            {
+                summary = _take_summary(now);
+            }
+        }
+
+        // Logged outside the lock, the log sink may block
+        if (!summary.empty())
+        {
+            log::warn("{}", summary);
+        }
+
+        return admitted;
+    }
+
+    std::vector<validation_message_stats> validation_filter::stats() const noexcept
+    {
+        std::vector<validation_message_stats> result {};
+        {
+            std::lock_guard lock { _mutex };
+            result.reserve(_entries.size());
+            for (const auto& [key, message] : _entries)
+            {
+                result.push_back(message.stats);
+            }
+        }
+
+        std::ranges::sort(result, std::ranges::greater {}, &validation_message_stats::count);
+        return result;
+    }
+
+    uint64_t validation_filter::total_messages() const noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return _total_messages;
+    }
+
+    uint64_t validation_filter::total_suppressed() const noexcept
+    {
+        std::lock_guard lock { _mutex };
+        return _total_suppressed;
+    }
+
+    void validation_filter::log_summary() noexcept
+    {
+        std::string summary {};
+        {
+            std::lock_guard lock { _mutex };
+            summary = _take_summary(std::chrono::steady_clock::now());
+        }
+
+        if (!summary.empty())
+        {
+            log::warn("{}", summary);
+        }
+    }
+
+    std::string validation_filter::_take_summary(const std::chrono::steady_clock::time_point now) noexcept
+    {
+        const std::chrono::duration<double> elapsed = now - _last_summary;
+        _last_summary = now;
+
+        std::vector<entry*> suppressed {};
+        uint64_t suppressed_total { 0 };
+        for (auto& [key, message] : _entries)
+        {
+            if (message.suppressed_since_summary > 0)
+            {
+                suppressed.push_back(&message);
+                suppressed_total += message.suppressed_since_summary;
+            }
+        }
+
+        if (suppressed.empty())
+        {
+            return {};
+        }
+
+        std::ranges::sort(suppressed, std::ranges::greater {}, &entry::suppressed_since_summary);
+
+        std::string summary = format_str("Suppressed {} repeated validation messages in the last {:.1f}s:", suppressed_total, elapsed.count());
+        const size_t listed = std::min<size_t>(suppressed.size(), _settings.summary_entries);
+        for (size_t i = 0; i < listed; i++)
+        {
+            const entry& message = *suppressed[i];
+            summary += format_str(" [{} 0x{:08x}] x{}", message.stats.name, static_cast<uint32_t>(message.stats.id), message.suppressed_since_summary);
+        }
+
+        if (listed < suppressed.size())
+        {
+            summary += format_str(" and {} more ids", suppressed.size() - listed);
+        }
+
+        for (entry* message : suppressed)
+        {
+            message->suppressed_since_summary = 0;
+        }
+
+        return summary;
+    }
+} // namespace rhi::vk
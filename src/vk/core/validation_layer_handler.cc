@@ -1,4 +1,4 @@
-#include <cstring>
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 
@@ -14,28 +14,23 @@ namespace rhi::vk
         vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
         _layers.resize(layer_count);
         vkEnumerateInstanceLayerProperties(&layer_count, _layers.data());
+
+        _names = name_table::create(_layers, [](const validation_layer& layer) { return layer.layerName; });
     }
 
     bool validation_layer_handler::is_supported(const char* layer_name) const noexcept
     {
-        for (const auto& layer : _layers)
-        {
-            if (strcmp(layer_name, layer.layerName) == 0)
-            {
-                return true;
-            }
-        }
-
-        return false;
+        return _names.contains(layer_name);
     }
 
-    expected<std::vector<const char*>, const char*> validation_layer_handler::get_requested(std::span<requested_layer> requested_layers) const noexcept
+    expected<std::span<const char* const>, const char*> validation_layer_handler::get_requested(std::span<const requested_layer> requested_layers) noexcept
     {
-        std::vector<const char*> found_layers;
+        _enabled.clear();
 
         for (const auto& layer : requested_layers)
         {
-            if (!is_supported(layer.layer_name))
+            const char* name = _names.find(layer.layer_name);
+            if (name == nullptr)
             {
                 if (layer.required)
                 {
@@ -46,13 +41,18 @@ namespace rhi::vk
             else
             {
                 std::cout << "Found extension " << layer.layer_name << std::endl;
-                found_layers.push_back(layer.layer_name);
+                _enabled.push_back(name);
             }
         }
 
+        // The table hands out one pointer per name, so duplicates compare equal
+        std::ranges::sort(_enabled);
+        const auto [first_duplicate, end] = std::ranges::unique(_enabled);
+        _enabled.erase(first_duplicate, end);
+
         std::cout << "Found all required extensions" << std::endl;
 
-        return ok(found_layers);
+        return ok(std::span<const char* const> { _enabled });
     }
 
 
@@ -1,17 +1,20 @@
 #include "vk/device_vk.h"
 
-#include "core/format.h"
+#include <algorithm>
+#include <map>
+
 #include "core/log.h"
 #include "vk/core/utils.h"
 
 namespace rhi::vk
 {
-    expected<device, std::string> device::builder::build() noexcept
+    expected<device, error> device::builder::build() noexcept
     {
         class device device {};
         const auto& indices = _info.physical_device.get_queue_family_indices(_info.surface);
 
-        const std::vector<VkDeviceQueueCreateInfo> queue_create_infos = indices.get_create_infos();
+        const std::vector<VkDeviceQueueCreateInfo> queue_create_infos = indices.get_create_infos(
+            _info.queues.graphics_count, _info.queues.compute_count, _info.queues.transfer_count);
         const auto features = _info.physical_device.get_features();
 
         log::debug("Creating device...");
@@ -21,25 +24,257 @@ namespace rhi::vk
             log::debug("\t{}", ext);
         }
 
+        // Features past 1.0 can only be queried and enabled through VkPhysicalDeviceFeatures2, which needs 1.1
+        const uint32_t api_version = std::min(_info.api_version, _info.physical_device.get_properties().apiVersion);
+        const bool has_features2 = api_version >= VK_API_VERSION_1_1;
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+            .pNext = nullptr,
+            .timelineSemaphore = VK_FALSE,
+        };
+
+        VkPhysicalDeviceFeatures2 features2 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = nullptr,
+            .features = features,
+        };
+
+        const bool timeline_core = api_version >= VK_API_VERSION_1_2;
+        if (has_features2 && (timeline_core || _info.physical_device.is_extension_supported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)))
+        {
+            features2.pNext = &timeline_features;
+            vkGetPhysicalDeviceFeatures2(_info.physical_device.get(), &features2);
+            features2.features = features;
+
+            device._timeline_semaphores = timeline_features.timelineSemaphore == VK_TRUE;
+            if (device._timeline_semaphores && !timeline_core)
+            {
+                const char* timeline_extension[] = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+                (void)request_extensions(timeline_extension);
+            }
+        }
+
+        // Only the features the bindless heap relies on are turned on
+        const auto& indexing = _info.physical_device.get_descriptor_indexing();
+        VkPhysicalDeviceDescriptorIndexingFeatures indexing_features {};
+        indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+        if (_info.bindless.has_value())
+        {
+            if (!has_features2 || !indexing.is_bindless_capable())
+            {
+                return unexpected(error(error::code::DEVICE_FAIL, error::message_id::BINDLESS_UNSUPPORTED).with_context(_info.physical_device.name()));
+            }
+
+            indexing_features.pNext = features2.pNext;
+            indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexing_features.shaderStorageBufferArrayNonUniformIndexing = indexing.storage_buffer_non_uniform_indexing ? VK_TRUE : VK_FALSE;
+            indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+            indexing_features.runtimeDescriptorArray = VK_TRUE;
+            features2.pNext = &indexing_features;
+
+            if (api_version < VK_API_VERSION_1_2)
+            {
+                const char* indexing_extensions[] = { VK_KHR_MAINTENANCE_3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
+                (void)request_extensions(indexing_extensions);
+            }
+        }
+
+        const bool calibrated_timestamps = _info.profiling.has_value()
+            && _info.physical_device.is_extension_supported(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+        if (calibrated_timestamps)
+        {
+            (void)request_extension(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+        }
+
+        log::debug("Device API version {}.{}, timeline semaphores {}",
+            VK_API_VERSION_MAJOR(api_version), VK_API_VERSION_MINOR(api_version), device._timeline_semaphores ? "enabled" : "unavailable");
+
         const VkDeviceCreateInfo create_info {
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-            .pNext = nullptr,
+            .pNext = has_features2 ? &features2 : nullptr,
             .queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
             .pQueueCreateInfos = queue_create_infos.data(),
             .enabledExtensionCount = static_cast<uint32_t>(_info.extensions.size()),
             .ppEnabledExtensionNames = _info.extensions.data(),
-            .pEnabledFeatures = std::addressof(features)
+            .pEnabledFeatures = has_features2 ? nullptr : std::addressof(features)
         };
 
         const VkResult create_result = vkCreateDevice(_info.physical_device.get(), &create_info, nullptr, &device._handle);
 
         if (!vk_check(create_result))
         {
-            const auto message = format_str("Failed to create device. vkCreateDevice failed with {}", vulkan_result_to_string(create_result));
-            return unexpected(message);
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::CREATE_DEVICE_FAILED, create_result));
+        }
+
+        device._physical_device = _info.physical_device;
+        device._surface = _info.surface;
+        device._api_version = api_version;
+        device._graphics_family_index = indices.get_graphics();
+
+        // Hand out the created queues role by role. Each family keeps a cursor that wraps around once its queues run out
+        std::map<uint32_t, uint32_t> family_queue_counts {};
+        for (const auto& queue_info : queue_create_infos)
+        {
+            family_queue_counts[queue_info.queueFamilyIndex] = queue_info.queueCount;
+        }
+
+        std::map<uint32_t, uint32_t> family_cursors {};
+        std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<device_queue>> created_queues {};
+        const auto next_queue = [&](const uint32_t family_index) -> std::shared_ptr<device_queue>
+        {
+            const uint32_t queue_index = family_cursors[family_index]++ % family_queue_counts[family_index];
+            auto& queue = created_queues[{ family_index, queue_index }];
+            if (!queue)
+            {
+                VkQueue handle { VK_NULL_HANDLE };
+                vkGetDeviceQueue(device._handle, family_index, queue_index, &handle);
+                queue = std::make_shared<device_queue>(handle, family_index, queue_index);
+            }
+            return queue;
+        };
+
+        const auto take_queues = [&](std::vector<std::shared_ptr<device_queue>>& queues, const uint32_t family_index, const uint32_t count)
+        {
+            for (uint32_t i = 0; i < std::max(count, 1u); i++)
+            {
+                queues.push_back(next_queue(family_index));
+            }
+        };
+
+        take_queues(device._graphics_queues, indices.get_graphics(), _info.queues.graphics_count);
+        take_queues(device._compute_queues, indices.get_compute(), _info.queues.compute_count);
+        take_queues(device._transfer_queues, indices.get_transfer(), _info.queues.transfer_count);
+
+        if (indices.has_present())
+        {
+            // Present from the first graphics queue when possible, presentation then needs no extra ownership transfer
+            device._present_queue = indices.get_present() == indices.get_graphics()
+                ? device._graphics_queues.front()
+                : next_queue(indices.get_present());
         }
 
-        return ok(device);
+        log::debug("Device queues: {}. {} graphics, {} compute, {} transfer",
+            indices.get_formatted(), device._graphics_queues.size(), device._compute_queues.size(), device._transfer_queues.size());
+
+        device._allocator = std::make_shared<memory_allocator>(device._handle, _info.physical_device, _info.allocator);
+
+        if (_info.transient_memory.frame_size > 0)
+        {
+            auto transient_exp = transient_allocator::create(device._handle, *device._allocator, _info.physical_device, _info.transient_memory);
+            if (!transient_exp.has_value())
+            {
+                device.destroy();
+                return unexpected(transient_exp.unwrap_error());
+            }
+            device._transient_allocator = std::move(transient_exp).unwrap();
+        }
+
+        device._jobs = std::make_shared<thread_pool>(_info.worker_threads);
+
+        auto recorder_exp = command_recorder::create(device._handle, device._graphics_family_index, device._jobs, _info.command_recording);
+        if (!recorder_exp.has_value())
+        {
+            device.destroy();
+            return unexpected(recorder_exp.unwrap_error());
+        }
+        device._command_recorder = std::move(recorder_exp).unwrap();
+
+        auto descriptors_exp = descriptor_allocator::create(device._handle, device._jobs, _info.descriptors);
+        if (!descriptors_exp.has_value())
+        {
+            device.destroy();
+            return unexpected(descriptors_exp.unwrap_error());
+        }
+        device._descriptor_allocator = std::move(descriptors_exp).unwrap();
+
+        auto cache_exp = pipeline_cache::create(device._handle, _info.physical_device, _info.cache);
+        if (!cache_exp.has_value())
+        {
+            device.destroy();
+            return unexpected(cache_exp.unwrap_error());
+        }
+        device._pipeline_cache = std::move(cache_exp).unwrap();
+        device._pipeline_compiler = std::make_shared<pipeline_compiler>(device._handle, device._pipeline_cache->get(), device._jobs);
+
+        if (_info.bindless.has_value())
+        {
+            auto bindless_exp = bindless_descriptor_heap::create(device._handle, _info.physical_device, _info.bindless.value());
+            if (!bindless_exp.has_value())
+            {
+                device.destroy();
+                return unexpected(bindless_exp.unwrap_error());
+            }
+            device._bindless = std::move(bindless_exp).unwrap();
+        }
+
+        if (_info.profiling.has_value())
+        {
+            auto profiler_exp = gpu_profiler::create(device._handle, _info.physical_device, device.graphics_queue(),
+                calibrated_timestamps, _info.profiling.value());
+            if (!profiler_exp.has_value())
+            {
+                device.destroy();
+                return unexpected(profiler_exp.unwrap_error());
+            }
+            device._profiler = std::move(profiler_exp).unwrap();
+        }
+
+        if (_info.uploads.staging_size > 0 && device._timeline_semaphores)
+        {
+            auto uploads_exp = upload_manager::create(device._handle, *device._allocator, _info.physical_device,
+                device.transfer_queue(), device._graphics_family_index, _info.uploads);
+            if (!uploads_exp.has_value())
+            {
+                device.destroy();
+                return unexpected(uploads_exp.unwrap_error());
+            }
+            device._upload_manager = std::move(uploads_exp).unwrap();
+        }
+        else if (_info.uploads.staging_size > 0)
+        {
+            log::warn("Timeline semaphores are unavailable, the device has no upload manager");
+        }
+
+        return ok(std::move(device));
+    }
+
+    device::builder& device::builder::bindless(const bindless_descriptor_heap_description& description) noexcept
+    {
+        _info.bindless = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::profiling(const gpu_profiler_description& description) noexcept
+    {
+        _info.profiling = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::descriptors(const descriptor_allocator_description& description) noexcept
+    {
+        _info.descriptors = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::uploads(const upload_manager_description& description) noexcept
+    {
+        _info.uploads = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::queues(const device_queue_description& description) noexcept
+    {
+        _info.queues = description;
+
+        return *this;
     }
 
     device::builder& device::builder::surface(const VkSurfaceKHR& surface) noexcept
@@ -49,42 +284,146 @@ namespace rhi::vk
         return *this;
     }
 
+    device::builder& device::builder::allocator(const memory_allocator_description& description) noexcept
+    {
+        _info.allocator = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::transient_memory(const transient_allocator_description& description) noexcept
+    {
+        _info.transient_memory = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::worker_threads(const uint32_t count) noexcept
+    {
+        _info.worker_threads = count;
+
+        return *this;
+    }
+
+    device::builder& device::builder::command_recording(const command_recorder_description& description) noexcept
+    {
+        _info.command_recording = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::cache(const pipeline_cache_description& description) noexcept
+    {
+        _info.cache = description;
+
+        return *this;
+    }
+
+    device::builder& device::builder::api_version(const uint32_t version) noexcept
+    {
+        _info.api_version = version;
+
+        return *this;
+    }
+
     device::builder& device::builder::request_extension(const char* extension) noexcept
     {
-        _info.extensions.push_back(extension);
+        if (_info.extension_set.emplace(extension).second)
+        {
+            _info.extensions.push_back(extension);
+        }
 
         return *this;
     }
 
     device::builder& device::builder::request_extensions(const std::span<const char*> extensions) noexcept
     {
-        auto& existing_extensions = _info.extensions;
-        auto already_requested = [&existing_extensions](const char* new_extension) noexcept
+        for (const char* extension : extensions)
         {
-            for (const char* ext : existing_extensions)
-            {
-                if (strcmp(new_extension, ext) == 0)
-                {
-                    return true;
-                }
-            }
+            (void)request_extension(extension);
+        }
 
-            return false;
-        };
+        return *this;
+    }
 
-        for (auto& extension: extensions)
+    auto device::create_swapchain(const swapchain_description& description) noexcept -> expected<std::shared_ptr<swapchain>, error>
+    {
+        if (_surface == VK_NULL_HANDLE || !_present_queue)
         {
-            if (!already_requested(extension))
-            {
-                existing_extensions.push_back(extension);
-            }
+            return unexpected(error(error::code::SWAPCHAIN_FAIL, error::message_id::NO_PRESENT_SURFACE));
         }
 
-        return *this;
+        auto support_exp = _physical_device.get_swapchain_support(_surface);
+        if (!support_exp.has_value())
+        {
+            return unexpected(std::move(support_exp).unwrap_error());
+        }
+
+        auto swapchain_exp = swapchain::create(_handle, _physical_device.get(), _surface, *_present_queue, support_exp.unwrap(), description);
+        if (!swapchain_exp.has_value())
+        {
+            return unexpected(swapchain_exp.unwrap_error());
+        }
+
+        return ok(std::move(swapchain_exp).unwrap());
     }
 
     void device::destroy() noexcept
     {
+        // The subsystems below free pools, buffers and memory the GPU may still be reading
+        if (_handle != VK_NULL_HANDLE)
+        {
+            if (const VkResult result = vkDeviceWaitIdle(_handle); !vk_check(result))
+            {
+                log::warn("vkDeviceWaitIdle failed with {} while destroying the device", vulkan_result_to_string(result));
+            }
+        }
+
+        if (_profiler)
+        {
+            _profiler->destroy();
+        }
+
+        if (_bindless)
+        {
+            _bindless->destroy();
+        }
+
+        if (_upload_manager)
+        {
+            _upload_manager->destroy();
+        }
+
+        if (_pipeline_compiler)
+        {
+            _pipeline_compiler->destroy();
+        }
+
+        if (_pipeline_cache)
+        {
+            _pipeline_cache->destroy();
+        }
+
+        if (_descriptor_allocator)
+        {
+            _descriptor_allocator->destroy();
+        }
+
+        if (_command_recorder)
+        {
+            _command_recorder->destroy();
+        }
+
+        if (_transient_allocator)
+        {
+            _transient_allocator->destroy();
+        }
+
+        if (_allocator)
+        {
+            _allocator->destroy();
+        }
+
         vkDestroyDevice(_handle, nullptr);
     }
 
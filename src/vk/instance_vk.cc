@@ -1,5 +1,7 @@
 #include "vk/instance_vk.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 
@@ -17,6 +19,17 @@ namespace rhi::vk
     {
         instance inst {};
 
+        using clock = std::chrono::steady_clock;
+        const auto build_start = clock::now();
+        auto phase_start = build_start;
+        const auto lap = [&phase_start]() noexcept
+        {
+            const auto now = clock::now();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start);
+            phase_start = now;
+            return elapsed;
+        };
+
         validation_layer_handler validation_handler {};
         std::vector<requested_layer> requested_layers {};
 
@@ -52,7 +65,7 @@ namespace rhi::vk
             requested_extensions.emplace_back(true, VK_KHR_SURFACE_EXTENSION_NAME);
 #ifdef RHI_PLATFORM_WINDOWS
             requested_extensions.emplace_back(true, VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
-#elif defined(RHI_PLATFORM_LINUX)
+#elif defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
             requested_extensions.emplace_back(true, VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
 #endif
         }
@@ -67,20 +80,36 @@ namespace rhi::vk
 
         if (!validation_layers_exp.has_value())
         {
-            const auto error_string = validation_layers_exp.unwrap_error();
-            log::error("Instance creation failed with message: [{}]", error_string);
-            return unexpected(error(error::code::INSTANCE_FAIL, error_string));
+            const auto missing = error(error::code::INSTANCE_FAIL, error::message_id::MISSING_VALIDATION_LAYER).with_context(validation_layers_exp.unwrap_error());
+            log::error("Instance creation failed with message: [{}]", missing);
+            return unexpected(missing);
         }
 
         if (!extensions_exp.has_value())
         {
-            const auto error_string = extensions_exp.unwrap_error();
-            log::error("Instance creation failed with message: [{}]", error_string);
-            return unexpected(error(error::code::INSTANCE_FAIL, error_string.c_str()));
+            const auto missing = error(error::code::INSTANCE_FAIL, error::message_id::MISSING_INSTANCE_EXTENSION).with_context(extensions_exp.unwrap_error());
+            log::error("Instance creation failed with message: [{}]", missing);
+            return unexpected(missing);
         }
 
-        auto found_validation_layers = validation_layers_exp.unwrap();
-        auto found_extensions = extensions_exp.unwrap();
+        const auto found_validation_layers = validation_layers_exp.unwrap();
+        const auto found_extensions = extensions_exp.unwrap();
+
+        // vkEnumerateInstanceVersion only exists on 1.1+ loaders, a missing entry point means 1.0
+        uint32_t loader_version { VK_API_VERSION_1_0 };
+        if (const auto enumerate_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"))
+        {
+            if (!vk_check(enumerate_version(&loader_version)))
+            {
+                loader_version = VK_API_VERSION_1_0;
+            }
+        }
+        inst._api_version = std::min(_info.api_version, loader_version);
+        log::debug("Using Vulkan {}.{} (loader supports {}.{})",
+            VK_API_VERSION_MAJOR(inst._api_version), VK_API_VERSION_MINOR(inst._api_version),
+            VK_API_VERSION_MAJOR(loader_version), VK_API_VERSION_MINOR(loader_version));
+
+        inst._build_timings.extensions = lap();
 
         VkApplicationInfo app_info {
             .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -89,23 +118,24 @@ namespace rhi::vk
             .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
             .pEngineName = "NO_ENGINE",
             .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-            .apiVersion = VK_API_VERSION_1_0
+            .apiVersion = inst._api_version
         };
 
         VkInstanceCreateInfo instance_info {
             .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
             .pNext = nullptr,
             .pApplicationInfo = &app_info,
-            .enabledLayerCount = static_cast<uint32_t>(requested_layers.size()),
+            .enabledLayerCount = static_cast<uint32_t>(found_validation_layers.size()),
             .ppEnabledLayerNames = found_validation_layers.data(),
-            .enabledExtensionCount = static_cast<uint32_t>(requested_extensions.size()),
+            .enabledExtensionCount = static_cast<uint32_t>(found_extensions.size()),
             .ppEnabledExtensionNames = found_extensions.data()
         };
 
         std::unique_ptr<VkDebugUtilsMessengerCreateInfoEXT> debug_create_info;
         if (_info.enable_debug)
         {
-            debug_create_info = std::make_unique<VkDebugUtilsMessengerCreateInfoEXT>(debug_messenger::get_create_info());
+            inst._validation_filter = std::make_shared<validation_filter>(_info.validation_limits);
+            debug_create_info = std::make_unique<VkDebugUtilsMessengerCreateInfoEXT>(debug_messenger::get_create_info(inst._validation_filter.get()));
             instance_info.pNext = debug_create_info.get();
         }
 
@@ -114,24 +144,26 @@ namespace rhi::vk
             nullptr,
             &inst._handle
         );
+        inst._build_timings.instance_creation = lap();
+
+        if (!vk_check(create_result))
+        {
+            return unexpected(error(error::code::INSTANCE_FAIL, error::message_id::CREATE_INSTANCE_FAILED, create_result));
+        }
+        log::debug("Instance creation completed successfully.");
 
         if (_info.window.has_value())
         {
             auto surface_exp = inst.create_surface(_info.window.value());
             if (!surface_exp.has_value())
             {
-                return unexpected(error(error::code::INSTANCE_FAIL, "Failed to create instance -> [instance::create_surface]"));
+                return unexpected(surface_exp.unwrap_error());
             }
 
             inst._surface = surface_exp.unwrap();
             log::debug("Surface created.");
         }
-
-        if (!vk_check(create_result))
-        {
-            return unexpected(error(error::code::INSTANCE_FAIL, "Failed to create instance -> [vkCreateInstance"));
-        }
-        log::debug("Instance creation completed successfully.");
+        inst._build_timings.surface_creation = lap();
 
 
         if (_info.enable_debug)
@@ -141,87 +173,114 @@ namespace rhi::vk
             if (!messenger_exp.has_value())
             {
                 log::error("Failed to create debug messenger: [{}]", messenger_exp.unwrap_error());
-                return unexpected(error(error::code::INSTANCE_FAIL, "Failed to create debug messenger"));
+                return unexpected(messenger_exp.unwrap_error());
             }
-            auto messenger = messenger_exp.unwrap();
-            inst._debug_messenger = std::make_unique<debug_messenger>(messenger);
+            inst._debug_messenger = std::make_unique<debug_messenger>(std::move(messenger_exp).unwrap());
             log::debug("Debug messenger created.");
         }
+        inst._build_timings.messenger_creation = lap();
 
         // Handle the physical devices
         log::debug("Retrieving suitable physical devices...");
-        physical_device_handler pd_handler { inst._handle, inst._surface };
+        std::unique_ptr<device_capability_cache> capability_cache { nullptr };
+        if (!_info.capability_cache_directory.empty())
+        {
+            capability_cache = std::make_unique<device_capability_cache>(_info.capability_cache_directory);
+        }
+
+        physical_device_handler pd_handler { inst._handle, inst._surface, inst._api_version, capability_cache.get() };
+        inst._build_timings.device_enumeration = lap();
+        pd_handler.require_descriptor_indexing(_info.bindless);
+        pd_handler.score_weights(_info.score_weights);
+        inst._bindless = _info.bindless;
         if (!_info.headless)
         {
-            inst._device_extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
-            pd_handler.request_extension(VK_KHR_SURFACE_EXTENSION_NAME, true);
+            // VK_KHR_surface is an instance extension, presenting needs the swapchain extension on the device
+            inst._device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+            pd_handler.request_extension(VK_KHR_SWAPCHAIN_EXTENSION_NAME, true);
         }
         inst._suitable_devices = pd_handler.get_suitable_devices();
+        inst._build_timings.device_selection = lap();
+        inst._build_timings.total = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - build_start);
+
+        const auto& timings = inst._build_timings;
+        log::debug("Instance build took {} us: extensions {} us, instance {} us, surface {} us, debug messenger {} us, device enumeration {} us, device selection {} us",
+            timings.total.count() / 1000, timings.extensions.count() / 1000, timings.instance_creation.count() / 1000,
+            timings.surface_creation.count() / 1000, timings.messenger_creation.count() / 1000,
+            timings.device_enumeration.count() / 1000, timings.device_selection.count() / 1000);
 
         if (inst._suitable_devices.empty())
         {
-            return unexpected(error(error::code::INSTANCE_FAIL, "No suitable physical devices found"));
+            return unexpected(error(error::code::INSTANCE_FAIL, error::message_id::NO_SUITABLE_DEVICE));
         }
 
         // return ok<instance>(std::move(inst));
-        return ok(inst);
+        return ok(std::move(inst));
     }
 
-    expected<class device, std::string> instance::create_device() noexcept
+    std::future<expected<instance, error>> instance::builder::build_async() const noexcept
     {
-        const auto pd = _suitable_devices[0];
+        // The builder is copied so the caller may drop or reuse theirs before the build finishes
+        return std::async(std::launch::async, [builder = *this]() noexcept
+        {
+            return builder.build();
+        });
+    }
 
-        auto device_exp = device::builder(pd)
+    expected<class device, error> instance::create_device() noexcept
+    {
+        // Suitable devices are ordered by score
+        const auto& pd = _suitable_devices[0];
+
+        auto builder = device::builder(pd)
             .surface(_surface)
             .request_extensions(_device_extensions)
-            .build();
+            .api_version(_api_version);
+
+        if (_bindless)
+        {
+            (void)builder.bindless();
+        }
+
+        auto device_exp = builder.build();
 
         if (!device_exp.has_value())
         {
-            return unexpected(device_exp.unwrap_error());
+            return unexpected(std::move(device_exp).unwrap_error());
         }
 
+        // The instance keeps its own handle to destroy it later, the caller gets the original
         _managed_devices.push_back(device_exp.unwrap());
 
         return device_exp;
     }
 
-    auto instance::create_device(uint32_t physical_device_id) noexcept -> expected<class device, std::string>
+    auto instance::create_device(uint32_t physical_device_id) noexcept -> expected<class device, error>
     {
-        const auto device_attempt = [this, physical_device_id]() -> std::tuple<physical_device, bool>
+        const auto pd = std::ranges::find(_suitable_devices, physical_device_id, &physical_device::id);
+        if (pd == _suitable_devices.end())
         {
-            constexpr bool device_found = true;
-            constexpr bool device_not_found = false;
-
-            for (auto& device : this->_suitable_devices)
-            {
-                if (device.id() == physical_device_id)
-                {
-                    return std::make_tuple(device, device_found);
-                }
-            }
+            return unexpected(error(error::code::DEVICE_FAIL, error::message_id::DEVICE_ID_NOT_FOUND).with_context("{}", physical_device_id));
+        }
 
-            return std::make_tuple(_suitable_devices[0], device_not_found);
-        }();
+        auto builder = device::builder(*pd)
+            .surface(_surface)
+            .request_extensions(_device_extensions)
+            .api_version(_api_version);
 
-        if (!std::get<bool>(device_attempt))
+        if (_bindless)
         {
-            std::string message = format_str("Device with id {} was not found in list of suitable devices.", physical_device_id);
-            return unexpected(message);
+            (void)builder.bindless();
         }
 
-        const auto pd = std::get<physical_device>(device_attempt);
-
-        auto device_exp = device::builder(pd)
-            .surface(_surface)
-            .request_extensions(_device_extensions)
-            .build();
+        auto device_exp = builder.build();
 
         if (!device_exp.has_value())
         {
-            return unexpected(device_exp.unwrap_error());
+            return unexpected(std::move(device_exp).unwrap_error());
         }
 
+        // The instance keeps its own handle to destroy it later, the caller gets the original
         _managed_devices.push_back(device_exp.unwrap());
 
         return device_exp;
@@ -229,14 +288,14 @@ namespace rhi::vk
 
 
 
-    expected<VkSurfaceKHR, surface_create_error> instance::create_surface(const window_data& window) const noexcept
+    expected<VkSurfaceKHR, error> instance::create_surface(const window_data& window) const noexcept
     {
         VkSurfaceKHR surface { VK_NULL_HANDLE };
 
 #if defined(RHI_PLATFORM_WINDOWS)
         if (!std::get_if<window_data_win32>(&window))
         {
-            return unexpected(surface_create_error::INVALID_WINDOW_DATA_NOT_WIN32);
+            return unexpected(error(error::code::SURFACE_FAIL, error::message_id::WINDOW_DATA_MISMATCH).with_context("expected win32 window data"));
         }
 
         const auto& window_description = std::get<window_data_win32>(window);
@@ -256,10 +315,37 @@ namespace rhi::vk
 
         if (!vk_check(result))
         {
-            return unexpected(surface_create_error::CREATE_SURFACE_FAILED);
+            return unexpected(error(error::code::SURFACE_FAIL, error::message_id::CREATE_SURFACE_FAILED, result));
         }
+#elif defined(RHI_PLATFORM_LINUX) && defined(RHI_WITH_XLIB)
+        const auto* window_description = std::get_if<window_data_x11>(&window);
+        if (window_description == nullptr || window_description->display == nullptr || window_description->window == 0)
+        {
+            return unexpected(error(error::code::SURFACE_FAIL, error::message_id::WINDOW_DATA_MISMATCH).with_context("expected an Xlib display and window"));
+        }
+
+        const VkXlibSurfaceCreateInfoKHR xlib_surface_create_info {
+            .sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR,
+            .pNext = nullptr,
+            .flags = 0,
+            .dpy = window_description->display,
+            .window = window_description->window
+        };
+
+        const VkResult result = vkCreateXlibSurfaceKHR(
+            _handle,
+            &xlib_surface_create_info,
+            nullptr,
+            &surface
+        );
+
+        if (!vk_check(result))
+        {
+            return unexpected(error(error::code::SURFACE_FAIL, error::message_id::CREATE_SURFACE_FAILED, result));
+        }
+#else
+        return unexpected(error(error::code::SURFACE_FAIL, error::message_id::UNSUPPORTED_WINDOW_PLATFORM));
 #endif // PLATFORM DETECTION
-        // TODO: perform surface creation for other windowing platforms
 
         return ok(surface);
     }
@@ -267,8 +353,11 @@ namespace rhi::vk
     void instance::destroy() noexcept
     {
         log::debug("Destroying instance...");
-        _debug_messenger->destroy();
-        _debug_messenger.reset();
+        if (_debug_messenger)
+        {
+            _debug_messenger->destroy();
+            _debug_messenger.reset();
+        }
 
         for (auto& device : _managed_devices)
         {
@@ -282,6 +371,10 @@ namespace rhi::vk
         }
 
         vkDestroyInstance(_handle, nullptr);
+        if (_validation_filter)
+        {
+            _validation_filter->log_summary();
+        }
         log::debug("Instance destroyed");
     }
 
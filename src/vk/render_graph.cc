@@ -0,0 +1,865 @@
+#include "vk/render_graph.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "core/format.h"
+#include "core/log.h"
+#include "vk/core/utils.h"
+
+namespace rhi::vk
+{
+    namespace
+    {
+        struct usage_info
+        {
+            VkPipelineStageFlags2 stages;
+            VkAccessFlags2 access;
+            VkImageLayout layout;
+            VkImageUsageFlags image_usage;
+        };
+
+        // Only stage and access bits that also exist in the legacy enums are used, so the
+        // vkCmdPipelineBarrier fallback can narrow the masks without losing anything
+        usage_info get_usage_info(const resource_usage usage) noexcept
+        {
+            switch (usage)
+            {
+            case resource_usage::COLOR_ATTACHMENT:
+                return {
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                };
+            case resource_usage::DEPTH_ATTACHMENT:
+                return {
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                };
+            case resource_usage::DEPTH_READ:
+                return {
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                };
+            case resource_usage::FRAGMENT_SAMPLED:
+                return {
+                    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_USAGE_SAMPLED_BIT
+                };
+            case resource_usage::COMPUTE_SAMPLED:
+                return {
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_USAGE_SAMPLED_BIT
+                };
+            case resource_usage::COMPUTE_STORAGE_READ:
+                return {
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL,
+                    VK_IMAGE_USAGE_STORAGE_BIT
+                };
+            case resource_usage::COMPUTE_STORAGE_WRITE:
+                return {
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL,
+                    VK_IMAGE_USAGE_STORAGE_BIT
+                };
+            case resource_usage::TRANSFER_SRC:
+                return {
+                    VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                    VK_ACCESS_2_TRANSFER_READ_BIT,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                };
+            case resource_usage::TRANSFER_DST:
+                return {
+                    VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                    VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                };
+            case resource_usage::VERTEX_BUFFER:
+                return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+            case resource_usage::INDEX_BUFFER:
+                return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+            case resource_usage::INDIRECT_BUFFER:
+                return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+            case resource_usage::UNIFORM_BUFFER:
+                return {
+                    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_UNIFORM_READ_BIT,
+                    VK_IMAGE_LAYOUT_UNDEFINED,
+                    0
+                };
+            case resource_usage::PRESENT:
+                return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0 };
+            }
+
+            return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, 0 };
+        }
+
+        constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+            | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+            | VK_ACCESS_2_SHADER_WRITE_BIT
+            | VK_ACCESS_2_TRANSFER_WRITE_BIT
+            | VK_ACCESS_2_HOST_WRITE_BIT
+            | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+        /// What the last accesses to a resource left behind that the next access has to wait on
+        struct resource_state
+        {
+            VkImageLayout layout { VK_IMAGE_LAYOUT_UNDEFINED };
+            VkPipelineStageFlags2 write_stages { VK_PIPELINE_STAGE_2_NONE };
+            VkAccessFlags2 write_access { VK_ACCESS_2_NONE };
+
+            /// Stages that read the resource since the last write. A later write or layout change waits on them
+            VkPipelineStageFlags2 read_stages { VK_PIPELINE_STAGE_2_NONE };
+
+            /// Stages the last write is already visible to, reads from them need no further barrier
+            VkPipelineStageFlags2 visible_stages { VK_PIPELINE_STAGE_2_NONE };
+        };
+
+        struct barrier_scope
+        {
+            VkPipelineStageFlags2 src_stages { VK_PIPELINE_STAGE_2_NONE };
+            VkAccessFlags2 src_access { VK_ACCESS_2_NONE };
+            VkPipelineStageFlags2 dst_stages { VK_PIPELINE_STAGE_2_NONE };
+            VkAccessFlags2 dst_access { VK_ACCESS_2_NONE };
+        };
+
+        /// @brief Advance the state by one access and return the dependency it needs, if any
+        std::optional<barrier_scope> transition(resource_state& state, const usage_info& info, const VkImageLayout layout) noexcept
+        {
+            const bool is_write = (info.access & WRITE_ACCESS_MASK) != 0;
+            const bool layout_change = state.layout != layout;
+
+            barrier_scope scope {
+                .src_stages = state.write_stages,
+                .src_access = state.write_access,
+                .dst_stages = info.stages,
+                .dst_access = info.access,
+            };
+
+            if (is_write || layout_change)
+            {
+                // Write-after-read only needs execution ordering, the read stages carry no access to flush
+                scope.src_stages |= state.read_stages;
+
+                // A layout transition counts as a write that completes before the destination stages,
+                // so later readers in other stages still chain their dependency through those stages
+                state.layout = layout;
+                state.write_stages = info.stages;
+                state.write_access = is_write ? info.access & WRITE_ACCESS_MASK : VK_ACCESS_2_NONE;
+                state.read_stages = is_write ? VK_PIPELINE_STAGE_2_NONE : info.stages;
+                state.visible_stages = is_write ? VK_PIPELINE_STAGE_2_NONE : info.stages;
+
+                return scope;
+            }
+
+            state.read_stages |= info.stages;
+            if (state.write_stages == VK_PIPELINE_STAGE_2_NONE || (info.stages & ~state.visible_stages) == 0)
+            {
+                return std::nullopt;
+            }
+
+            state.visible_stages |= info.stages;
+            return scope;
+        }
+
+        constexpr VkDeviceSize align_up(const VkDeviceSize value, const VkDeviceSize alignment) noexcept
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    pass_builder& pass_builder::read(const image_handle image, const resource_usage usage) noexcept
+    {
+        _graph._passes[_pass].accesses.push_back({ image.index, true, false, usage });
+        return *this;
+    }
+
+    pass_builder& pass_builder::write(const image_handle image, const resource_usage usage) noexcept
+    {
+        _graph._passes[_pass].accesses.push_back({ image.index, true, true, usage });
+        return *this;
+    }
+
+    pass_builder& pass_builder::read(const buffer_handle buffer, const resource_usage usage) noexcept
+    {
+        _graph._passes[_pass].accesses.push_back({ buffer.index, false, false, usage });
+        return *this;
+    }
+
+    pass_builder& pass_builder::write(const buffer_handle buffer, const resource_usage usage) noexcept
+    {
+        _graph._passes[_pass].accesses.push_back({ buffer.index, false, true, usage });
+        return *this;
+    }
+
+    pass_builder& pass_builder::side_effect() noexcept
+    {
+        _graph._passes[_pass].side_effect = true;
+        return *this;
+    }
+
+    render_graph::render_graph(device& device, const render_graph_description& description) noexcept
+        : _device { device.get() }
+        , _allocator { &device.allocator() }
+        , _description { description }
+    {}
+
+    image_handle render_graph::create_image(const transient_image_description& description) noexcept
+    {
+        image_resource& image = _images.emplace_back();
+        image.name = description.name;
+        image.transient = description;
+        image.range = { description.aspect, 0, 1, 0, 1 };
+
+        return { static_cast<uint32_t>(_images.size() - 1) };
+    }
+
+    image_handle render_graph::import_image(const imported_image_description& description) noexcept
+    {
+        image_resource& image = _images.emplace_back();
+        image.name = description.name;
+        image.is_imported = true;
+        image.external = description;
+        image.image = description.image;
+        image.view = description.view;
+        image.range = description.range;
+
+        return { static_cast<uint32_t>(_images.size() - 1) };
+    }
+
+    buffer_handle render_graph::import_buffer(const imported_buffer_description& description) noexcept
+    {
+        _buffers.push_back({ description });
+        return { static_cast<uint32_t>(_buffers.size() - 1) };
+    }
+
+    void render_graph::add_pass(std::string name, const setup_function& setup, execute_function execute) noexcept
+    {
+        _passes.push_back({ .name = std::move(name), .execute = std::move(execute) });
+
+        pass_builder builder { *this, static_cast<uint32_t>(_passes.size() - 1) };
+        setup(builder);
+
+        _compiled = false;
+    }
+
+    expected<render_graph_statistics, std::string> render_graph::compile() noexcept
+    {
+        _destroy_transients();
+        _statistics = {};
+
+        for (const auto& pass : _passes)
+        {
+            for (const auto& access : pass.accesses)
+            {
+                const size_t count = access.is_image ? _images.size() : _buffers.size();
+                if (access.resource >= count)
+                {
+                    return unexpected(format_str("Pass {} uses an invalid {} handle", pass.name, access.is_image ? "image" : "buffer"));
+                }
+            }
+        }
+
+        _cull();
+
+        auto transients_exp = _allocate_transients();
+        if (!transients_exp.has_value())
+        {
+            _destroy_transients();
+            return unexpected(std::move(transients_exp).unwrap_error());
+        }
+
+        _build_barriers();
+        _compiled = true;
+
+        log::debug("Compiled render graph: {} passes ({} culled), {} barrier batches, transient memory {} KiB (unaliased {} KiB).",
+            _statistics.pass_count, _statistics.culled_pass_count, _statistics.barrier_batch_count,
+            _statistics.transient_bytes_allocated / 1024, _statistics.transient_bytes_requested / 1024);
+
+        return ok(_statistics);
+    }
+
+    void render_graph::_cull() noexcept
+    {
+        // Walk backwards: a pass survives if something after it (or outside the graph) consumes what it writes
+        std::vector<bool> image_needed(_images.size(), false);
+        std::vector<bool> buffer_needed(_buffers.size(), true);
+        for (size_t i = 0; i < _images.size(); ++i)
+        {
+            image_needed[i] = _images[i].is_imported;
+        }
+
+        for (auto it = _passes.rbegin(); it != _passes.rend(); ++it)
+        {
+            pass& current = *it;
+
+            bool alive = current.side_effect;
+            for (const auto& access : current.accesses)
+            {
+                if (access.is_write)
+                {
+                    alive = alive || (access.is_image ? image_needed[access.resource] : buffer_needed[access.resource]);
+                }
+            }
+
+            current.culled = !alive;
+            if (!alive)
+            {
+                continue;
+            }
+
+            for (const auto& access : current.accesses)
+            {
+                if (access.is_write)
+                {
+                    continue;
+                }
+
+                if (access.is_image)
+                {
+                    image_needed[access.resource] = true;
+                }
+                else
+                {
+                    buffer_needed[access.resource] = true;
+                }
+            }
+        }
+
+        for (uint32_t p = 0; p < _passes.size(); ++p)
+        {
+            if (_passes[p].culled)
+            {
+                ++_statistics.culled_pass_count;
+                continue;
+            }
+
+            ++_statistics.pass_count;
+            for (const auto& access : _passes[p].accesses)
+            {
+                if (access.is_image)
+                {
+                    image_resource& image = _images[access.resource];
+                    image.first_pass = std::min(image.first_pass, p);
+                    image.last_pass = std::max(image.last_pass, p);
+                }
+            }
+        }
+    }
+
+    expected<bool, std::string> render_graph::_allocate_transients() noexcept
+    {
+        struct placement
+        {
+            uint32_t image;
+            VkMemoryRequirements requirements;
+        };
+
+        struct memory_group
+        {
+            uint32_t type_bits { ~0u };
+            VkDeviceSize alignment { 1 };
+            VkDeviceSize size { 0 };
+            std::vector<uint32_t> images {};
+        };
+
+        std::vector<VkImageUsageFlags> usages(_images.size(), 0);
+        for (const auto& pass : _passes)
+        {
+            for (const auto& access : pass.accesses)
+            {
+                if (!pass.culled && access.is_image)
+                {
+                    usages[access.resource] |= get_usage_info(access.usage).image_usage;
+                }
+            }
+        }
+
+        std::vector<placement> placements {};
+        for (uint32_t i = 0; i < _images.size(); ++i)
+        {
+            image_resource& image = _images[i];
+            if (image.is_imported || image.first_pass == UINT32_MAX)
+            {
+                continue;
+            }
+
+            const VkImageCreateInfo image_info {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = image.transient.format,
+                .extent = { image.transient.extent.width, image.transient.extent.height, 1 },
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .samples = image.transient.samples,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = usages[i],
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices = nullptr,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            };
+
+            if (const VkResult result = vkCreateImage(_device, &image_info, nullptr, &image.image); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to create transient image {}. vkCreateImage failed with {}", image.name, vulkan_result_to_string(result)));
+            }
+
+            placement& entry = placements.emplace_back(placement { i, {} });
+            vkGetImageMemoryRequirements(_device, image.image, &entry.requirements);
+            image.memory_size = entry.requirements.size;
+            _statistics.transient_bytes_requested += entry.requirements.size;
+        }
+
+        // Largest first keeps the greedy first fit from stranding small holes under big images
+        std::sort(placements.begin(), placements.end(), [](const placement& a, const placement& b)
+        {
+            return a.requirements.size > b.requirements.size;
+        });
+
+        std::vector<memory_group> groups {};
+        for (const placement& entry : placements)
+        {
+            image_resource& image = _images[entry.image];
+
+            auto group = std::find_if(groups.begin(), groups.end(), [&entry](const memory_group& candidate)
+            {
+                return (candidate.type_bits & entry.requirements.memoryTypeBits) != 0;
+            });
+            if (group == groups.end())
+            {
+                group = groups.emplace(groups.end());
+            }
+
+            // Ranges already claimed by images that are alive at the same time
+            std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied {};
+            for (const uint32_t other_index : group->images)
+            {
+                const image_resource& other = _images[other_index];
+                if (other.first_pass <= image.last_pass && image.first_pass <= other.last_pass)
+                {
+                    occupied.emplace_back(other.memory_offset, other.memory_offset + other.memory_size);
+                }
+            }
+            std::sort(occupied.begin(), occupied.end());
+
+            VkDeviceSize offset { 0 };
+            for (const auto& [begin, end] : occupied)
+            {
+                offset = align_up(offset, entry.requirements.alignment);
+                if (offset + entry.requirements.size <= begin)
+                {
+                    break;
+                }
+                offset = std::max(offset, end);
+            }
+            offset = align_up(offset, entry.requirements.alignment);
+
+            image.memory_offset = offset;
+            image.memory_group = static_cast<uint32_t>(group - groups.begin());
+            group->type_bits &= entry.requirements.memoryTypeBits;
+            group->alignment = std::max(group->alignment, entry.requirements.alignment);
+            group->size = std::max(group->size, offset + entry.requirements.size);
+            group->images.push_back(entry.image);
+        }
+
+        for (const memory_group& group : groups)
+        {
+            const VkMemoryRequirements requirements { group.size, group.alignment, group.type_bits };
+            auto memory_exp = _allocator->allocate(requirements, allocation_create_info { .usage = memory_usage::GPU_ONLY, .kind = memory_resource_kind::OPTIMAL });
+            if (!memory_exp.has_value())
+            {
+                return unexpected(format_str("Failed to allocate transient image memory: {}", memory_exp.unwrap_error()));
+            }
+
+            _memory.push_back(memory_exp.unwrap());
+            _statistics.transient_bytes_allocated += group.size;
+        }
+
+        for (const placement& entry : placements)
+        {
+            image_resource& image = _images[entry.image];
+            const memory_allocation& memory = _memory[image.memory_group];
+
+            if (const VkResult result = vkBindImageMemory(_device, image.image, memory.memory, memory.offset + image.memory_offset); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to bind transient image {}: {}", image.name, vulkan_result_to_string(result)));
+            }
+
+            const VkImageViewCreateInfo view_info {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .image = image.image,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = image.transient.format,
+                .components = {
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY
+                },
+                .subresourceRange = image.range,
+            };
+
+            if (const VkResult result = vkCreateImageView(_device, &view_info, nullptr, &image.view); !vk_check(result))
+            {
+                return unexpected(format_str("Failed to create view for transient image {}: {}", image.name, vulkan_result_to_string(result)));
+            }
+        }
+
+        return ok(true);
+    }
+
+    void render_graph::_build_barriers() noexcept
+    {
+        _batches.clear();
+        _final_batch = {};
+
+        std::vector<resource_state> image_states(_images.size());
+        std::vector<resource_state> buffer_states(_buffers.size());
+        for (size_t i = 0; i < _images.size(); ++i)
+        {
+            if (_images[i].is_imported)
+            {
+                // Work from before the graph is not known here, so a defined starting layout waits on everything
+                image_states[i].layout = _images[i].external.initial_layout;
+                if (image_states[i].layout != VK_IMAGE_LAYOUT_UNDEFINED)
+                {
+                    image_states[i].write_stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                    image_states[i].write_access = VK_ACCESS_2_MEMORY_WRITE_BIT;
+                }
+            }
+        }
+
+        // Stages and accesses that last touched each transient image, needed when its memory is handed to the next one
+        std::vector<barrier_scope> last_use(_images.size());
+
+        const auto image_barrier = [this](const uint32_t index, const barrier_scope& scope, const VkImageLayout old_layout, const VkImageLayout new_layout)
+        {
+            return VkImageMemoryBarrier2 {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .pNext = nullptr,
+                .srcStageMask = scope.src_stages,
+                .srcAccessMask = scope.src_access,
+                .dstStageMask = scope.dst_stages,
+                .dstAccessMask = scope.dst_access,
+                .oldLayout = old_layout,
+                .newLayout = new_layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = _images[index].image,
+                .subresourceRange = _images[index].range,
+            };
+        };
+
+        for (uint32_t p = 0; p < _passes.size(); ++p)
+        {
+            pass& current = _passes[p];
+            if (current.culled)
+            {
+                continue;
+            }
+
+            // Accesses to the same resource in one pass are merged so it gets at most one barrier
+            std::vector<std::pair<resource_access, usage_info>> merged {};
+            for (const auto& access : current.accesses)
+            {
+                usage_info info = get_usage_info(access.usage);
+                auto existing = std::find_if(merged.begin(), merged.end(), [&access](const auto& entry)
+                {
+                    return entry.first.is_image == access.is_image && entry.first.resource == access.resource;
+                });
+
+                if (existing == merged.end())
+                {
+                    merged.emplace_back(access, info);
+                    continue;
+                }
+
+                existing->second.stages |= info.stages;
+                existing->second.access |= info.access;
+                if (existing->second.layout != info.layout)
+                {
+                    existing->second.layout = VK_IMAGE_LAYOUT_GENERAL;
+                }
+            }
+
+            barrier_batch batch {};
+            for (const auto& [access, info] : merged)
+            {
+                if (!access.is_image)
+                {
+                    const imported_buffer_description& buffer = _buffers[access.resource].imported;
+                    if (const auto scope = transition(buffer_states[access.resource], info, VK_IMAGE_LAYOUT_UNDEFINED); scope.has_value())
+                    {
+                        batch.buffers.push_back({
+                            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                            .pNext = nullptr,
+                            .srcStageMask = scope->src_stages,
+                            .srcAccessMask = scope->src_access,
+                            .dstStageMask = scope->dst_stages,
+                            .dstAccessMask = scope->dst_access,
+                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .buffer = buffer.buffer,
+                            .offset = buffer.offset,
+                            .size = buffer.size,
+                        });
+                    }
+                    continue;
+                }
+
+                const image_resource& image = _images[access.resource];
+                resource_state& state = image_states[access.resource];
+
+                if (!image.is_imported && image.first_pass == p)
+                {
+                    // First use of aliased memory: wait for the images that used the same bytes before
+                    for (uint32_t other = 0; other < _images.size(); ++other)
+                    {
+                        const image_resource& previous = _images[other];
+                        const bool overlaps = previous.memory_offset < image.memory_offset + image.memory_size
+                            && image.memory_offset < previous.memory_offset + previous.memory_size;
+
+                        if (previous.is_imported || previous.first_pass == UINT32_MAX || previous.last_pass >= p
+                            || previous.memory_group != image.memory_group || !overlaps)
+                        {
+                            continue;
+                        }
+
+                        state.write_stages |= last_use[other].src_stages;
+                        state.write_access |= last_use[other].src_access;
+                    }
+                }
+
+                // Transient images start out UNDEFINED, so their first transition also discards the aliased contents
+                const VkImageLayout old_layout = state.layout;
+                if (const auto scope = transition(state, info, info.layout); scope.has_value())
+                {
+                    batch.images.push_back(image_barrier(access.resource, *scope, old_layout, info.layout));
+                }
+
+                last_use[access.resource] = {
+                    .src_stages = state.write_stages | state.read_stages,
+                    .src_access = state.write_access,
+                };
+            }
+
+            if (!batch.images.empty() || !batch.buffers.empty())
+            {
+                _statistics.image_barrier_count += static_cast<uint32_t>(batch.images.size());
+                _statistics.buffer_barrier_count += static_cast<uint32_t>(batch.buffers.size());
+                current.barrier_batch = static_cast<uint32_t>(_batches.size());
+                _batches.push_back(std::move(batch));
+            }
+            else
+            {
+                current.barrier_batch = UINT32_MAX;
+            }
+        }
+
+        for (uint32_t i = 0; i < _images.size(); ++i)
+        {
+            const image_resource& image = _images[i];
+            const VkImageLayout final_layout = image.external.final_layout;
+            if (!image.is_imported || final_layout == VK_IMAGE_LAYOUT_UNDEFINED || final_layout == image_states[i].layout)
+            {
+                continue;
+            }
+
+            const barrier_scope scope {
+                .src_stages = image_states[i].write_stages | image_states[i].read_stages,
+                .src_access = image_states[i].write_access,
+                .dst_stages = VK_PIPELINE_STAGE_2_NONE,
+                .dst_access = VK_ACCESS_2_NONE,
+            };
+            _final_batch.images.push_back(image_barrier(i, scope, image_states[i].layout, final_layout));
+        }
+
+        _statistics.image_barrier_count += static_cast<uint32_t>(_final_batch.images.size());
+        _statistics.barrier_batch_count = static_cast<uint32_t>(_batches.size()) + (_final_batch.images.empty() ? 0 : 1);
+    }
+
+    void render_graph::execute(const VkCommandBuffer command_buffer) const noexcept
+    {
+        if (!_compiled)
+        {
+            log::error("render_graph::execute called before compile");
+            return;
+        }
+
+        for (const pass& current : _passes)
+        {
+            if (current.culled)
+            {
+                continue;
+            }
+
+            if (current.barrier_batch != UINT32_MAX)
+            {
+                _record_barriers(command_buffer, _batches[current.barrier_batch]);
+            }
+
+            if (current.execute)
+            {
+                current.execute(command_buffer, *this);
+            }
+        }
+
+        if (!_final_batch.images.empty())
+        {
+            _record_barriers(command_buffer, _final_batch);
+        }
+    }
+
+    void render_graph::_record_barriers(const VkCommandBuffer command_buffer, const barrier_batch& batch) const noexcept
+    {
+        if (_description.use_synchronization2)
+        {
+            const VkDependencyInfo dependency_info {
+                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                .pNext = nullptr,
+                .dependencyFlags = 0,
+                .memoryBarrierCount = 0,
+                .pMemoryBarriers = nullptr,
+                .bufferMemoryBarrierCount = static_cast<uint32_t>(batch.buffers.size()),
+                .pBufferMemoryBarriers = batch.buffers.data(),
+                .imageMemoryBarrierCount = static_cast<uint32_t>(batch.images.size()),
+                .pImageMemoryBarriers = batch.images.data(),
+            };
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+            return;
+        }
+
+        // The legacy call takes one stage mask pair for the whole batch
+        VkPipelineStageFlags src_stages { 0 };
+        VkPipelineStageFlags dst_stages { 0 };
+
+        std::vector<VkImageMemoryBarrier> images {};
+        images.reserve(batch.images.size());
+        for (const auto& barrier : batch.images)
+        {
+            src_stages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+            dst_stages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+            images.push_back({
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask),
+                .dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask),
+                .oldLayout = barrier.oldLayout,
+                .newLayout = barrier.newLayout,
+                .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                .image = barrier.image,
+                .subresourceRange = barrier.subresourceRange,
+            });
+        }
+
+        std::vector<VkBufferMemoryBarrier> buffers {};
+        buffers.reserve(batch.buffers.size());
+        for (const auto& barrier : batch.buffers)
+        {
+            src_stages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+            dst_stages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+            buffers.push_back({
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask),
+                .dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask),
+                .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                .buffer = barrier.buffer,
+                .offset = barrier.offset,
+                .size = barrier.size,
+            });
+        }
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            src_stages != 0 ? src_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+            dst_stages != 0 ? dst_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+            0,
+            0, nullptr,
+            static_cast<uint32_t>(buffers.size()), buffers.data(),
+            static_cast<uint32_t>(images.size()), images.data()
+        );
+    }
+
+    VkImage render_graph::image(const image_handle handle) const noexcept
+    {
+        return _images[handle.index].image;
+    }
+
+    VkImageView render_graph::image_view(const image_handle handle) const noexcept
+    {
+        return _images[handle.index].view;
+    }
+
+    VkBuffer render_graph::buffer(const buffer_handle handle) const noexcept
+    {
+        return _buffers[handle.index].imported.buffer;
+    }
+
+    void render_graph::_destroy_transients() noexcept
+    {
+        for (auto& image : _images)
+        {
+            image.first_pass = UINT32_MAX;
+            image.last_pass = 0;
+            if (image.is_imported)
+            {
+                continue;
+            }
+
+            if (image.view != VK_NULL_HANDLE)
+            {
+                vkDestroyImageView(_device, image.view, nullptr);
+                image.view = VK_NULL_HANDLE;
+            }
+
+            if (image.image != VK_NULL_HANDLE)
+            {
+                vkDestroyImage(_device, image.image, nullptr);
+                image.image = VK_NULL_HANDLE;
+            }
+        }
+
+        for (auto& memory : _memory)
+        {
+            _allocator->free(memory);
+        }
+
+        _memory.clear();
+        _batches.clear();
+        _final_batch = {};
+        _compiled = false;
+    }
+
+    void render_graph::reset() noexcept
+    {
+        _destroy_transients();
+        _passes.clear();
+        _images.clear();
+        _buffers.clear();
+        _statistics = {};
+    }
+} // namespace rhi::vk
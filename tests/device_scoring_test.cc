@@ -0,0 +1,168 @@
+#include "vk/core/physical_device_handler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+using namespace rhi::vk;
+
+namespace
+{
+    int failures { 0 };
+
+    void expect(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    constexpr VkDeviceSize gib { 1024ull * 1024 * 1024 };
+
+    /// A single graphics + compute + transfer family, what most integrated GPUs expose
+    const std::vector<VkQueueFamilyProperties> universal_family {
+        { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 16, 64, { 1, 1, 1 } },
+    };
+
+    /// Universal family plus an async compute and a transfer-only family
+    const std::vector<VkQueueFamilyProperties> dedicated_families {
+        { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 16, 64, { 1, 1, 1 } },
+        { VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 8, 64, { 1, 1, 1 } },
+        { VK_QUEUE_TRANSFER_BIT, 2, 64, { 1, 1, 1 } },
+    };
+
+    [[nodiscard]] device_score_input make_input(
+        const VkPhysicalDeviceType type,
+        const VkDeviceSize device_local,
+        const std::vector<VkQueueFamilyProperties>& families = universal_family,
+        const std::initializer_list<std::string_view> extensions = {}
+    )
+    {
+        device_score_input input {};
+        input.properties.deviceType = type;
+        input.properties.limits.maxImageDimension2D = 16384;
+
+        input.memory_properties.memoryHeapCount = 2;
+        input.memory_properties.memoryHeaps[0] = { device_local, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+        input.memory_properties.memoryHeaps[1] = { 16 * gib, 0 };
+
+        input.queue_families = families;
+        input.extensions = name_table::create(extensions, [](const std::string_view name) { return name; });
+        return input;
+    }
+
+    [[nodiscard]] bool ranked_as(const std::vector<device_score_input>& inputs, const device_score_weights& weights, const std::initializer_list<size_t> expected)
+    {
+        const std::vector<size_t> order = rank_physical_devices(inputs, weights);
+        return std::vector<size_t>(expected) == order;
+    }
+}
+
+int main()
+{
+    const device_score_weights defaults {};
+
+    // The type bonus outweighs an integrated GPU reporting all of system memory as device local
+    {
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 32 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+        };
+        expect(score_physical_device(inputs[1], defaults) > score_physical_device(inputs[0], defaults), "discrete beats a large integrated heap");
+        expect(ranked_as(inputs, defaults, { 1, 0 }), "discrete ranks first");
+    }
+
+    // With everything else equal, the device type alone breaks the tie
+    {
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_CPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+        };
+        expect(ranked_as(inputs, defaults, { 3, 2, 1, 0 }), "discrete, integrated, virtual, then CPU");
+    }
+
+    // Dedicated queue families add their bonus on top of an otherwise identical device
+    {
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib, dedicated_families),
+        };
+        const float difference = score_physical_device(inputs[1], defaults) - score_physical_device(inputs[0], defaults);
+        expect(difference == defaults.dedicated_compute + defaults.dedicated_transfer, "dedicated compute and transfer bonuses");
+        expect(ranked_as(inputs, defaults, { 1, 0 }), "dedicated families rank first");
+    }
+
+    // Custom weights: ignore the device type and rank by memory alone
+    {
+        device_score_weights memory_only {
+            .discrete_gpu = 0.0f,
+            .integrated_gpu = 0.0f,
+            .virtual_gpu = 0.0f,
+            .device_local_gib = 1.0f,
+            .dedicated_compute = 0.0f,
+            .dedicated_transfer = 0.0f,
+            .max_image_dimension_2d = 0.0f,
+        };
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib, dedicated_families),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 32 * gib),
+        };
+        expect(score_physical_device(inputs[1], memory_only) == 32.0f, "score is the device local GiB");
+        expect(ranked_as(inputs, memory_only, { 1, 0 }), "the larger heap wins once the type is ignored");
+    }
+
+    // Custom weights: an optional extension worth more than the type bonus
+    {
+        device_score_weights extension_first {};
+        extension_first.optional_extension = 5000.0f;
+        extension_first.optional_extensions = { "VK_KHR_ray_query", "VK_EXT_mesh_shader" };
+
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 8 * gib, universal_family, { "VK_KHR_ray_query" }),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 8 * gib, universal_family, { "VK_EXT_mesh_shader", "VK_KHR_ray_query" }),
+        };
+        expect(ranked_as(inputs, extension_first, { 2, 1, 0 }), "each supported optional extension adds its weight");
+        expect(ranked_as(inputs, defaults, { 0, 1, 2 }), "extensions outside the weights do not count");
+    }
+
+    // Ties keep their enumeration order, also between devices that tie in the middle of the ranking
+    {
+        const std::vector inputs {
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 4 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 4 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * gib),
+            make_input(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 4 * gib),
+        };
+        expect(ranked_as(inputs, defaults, { 1, 3, 0, 2, 4 }), "equal scores keep their order");
+
+        const device_score_weights nothing {
+            .discrete_gpu = 0.0f,
+            .integrated_gpu = 0.0f,
+            .virtual_gpu = 0.0f,
+            .device_local_gib = 0.0f,
+            .dedicated_compute = 0.0f,
+            .dedicated_transfer = 0.0f,
+            .max_image_dimension_2d = 0.0f,
+        };
+        expect(score_physical_device(inputs[1], nothing) == 0.0f, "all weights at zero score nothing");
+        expect(ranked_as(inputs, nothing, { 0, 1, 2, 3, 4 }), "an all zero ranking is the enumeration order");
+    }
+
+    expect(rank_physical_devices({}, defaults).empty(), "no devices, no ranking");
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#ifndef RHI_TESTS_HEADLESS_DEVICE_H
+#define RHI_TESTS_HEADLESS_DEVICE_H
+
+#include <cstdio>
+#include <optional>
+
+#include "vk/instance_vk.h"
+
+namespace rhi::tests
+{
+    /// ctest reports a test exiting with this code as skipped, e.g. on a machine without any Vulkan driver
+    constexpr int skip_return_code = 77;
+
+    /// Instance and the best device it found. Destroying the instance destroys the device too
+    struct headless_device
+    {
+        vk::instance instance;
+        vk::device device;
+    };
+
+    /// @brief Instance without a surface and its highest scoring device. Any driver works, including a software
+    /// one such as lavapipe selected through VK_ICD_FILENAMES
+    [[nodiscard]] inline std::optional<headless_device> create_headless_device() noexcept
+    {
+        auto instance_exp = vk::instance::builder().headless().build();
+        if (!instance_exp.has_value())
+        {
+            std::fprintf(stderr, "SKIPPED: no Vulkan instance\n");
+            return std::nullopt;
+        }
+
+        vk::instance instance = std::move(instance_exp).unwrap();
+        auto device_exp = instance.create_device();
+        if (!device_exp.has_value())
+        {
+            std::fprintf(stderr, "SKIPPED: no suitable Vulkan device\n");
+            instance.destroy();
+            return std::nullopt;
+        }
+
+        vk::device device = std::move(device_exp).unwrap();
+        std::printf("Running on %.*s\n", static_cast<int>(device.get_physical_device().name().size()), device.get_physical_device().name().data());
+        return headless_device { std::move(instance), std::move(device) };
+    }
+} // namespace rhi::tests
+
+#endif //RHI_TESTS_HEADLESS_DEVICE_H
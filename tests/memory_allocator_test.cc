@@ -0,0 +1,227 @@
+#include "vk/core/memory_allocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "headless_device.h"
+
+using namespace rhi::vk;
+
+namespace
+{
+    int failures { 0 };
+
+    void expect(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    constexpr uint32_t buffer_count { 1024 };
+
+    struct test_buffer
+    {
+        VkBuffer buffer { VK_NULL_HANDLE };
+        memory_allocation memory {};
+    };
+
+    /// Totals over every heap, the device's own subsystems allocate from some of them too
+    struct totals
+    {
+        VkDeviceSize allocation_bytes { 0 };
+        VkDeviceSize peak_allocation_bytes { 0 };
+        VkDeviceSize block_bytes { 0 };
+        uint32_t allocation_count { 0 };
+        uint32_t device_memory_count { 0 };
+        float fragmentation { 0.0f };
+    };
+
+    [[nodiscard]] totals sum(const memory_statistics& statistics)
+    {
+        totals result { .device_memory_count = statistics.device_memory_count, .fragmentation = statistics.fragmentation };
+        for (const auto& heap : statistics.heaps)
+        {
+            result.allocation_bytes += heap.allocation_bytes;
+            result.peak_allocation_bytes += heap.peak_allocation_bytes;
+            result.block_bytes += heap.block_bytes;
+            result.allocation_count += heap.allocation_count;
+        }
+
+        return result;
+    }
+
+    /// Sizes between 256 bytes and 256 KiB, the same sequence on every run
+    [[nodiscard]] VkDeviceSize next_size(uint32_t& state)
+    {
+        state = state * 1664525u + 1013904223u;
+        return 256ull << ((state >> 16) % 11);
+    }
+
+    [[nodiscard]] double microseconds(const std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    [[nodiscard]] double percentile(std::vector<double> samples, const double fraction)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples[static_cast<size_t>(fraction * static_cast<double>(samples.size() - 1))];
+    }
+
+    /// Create the buffer and give it memory, timing only the allocator
+    [[nodiscard]] bool create_buffer(device& dev, const VkDeviceSize size, test_buffer& out, std::vector<double>& latencies)
+    {
+        const VkBufferCreateInfo buffer_info {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = size,
+            .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+        };
+
+        if (vkCreateBuffer(dev.get(), &buffer_info, nullptr, &out.buffer) != VK_SUCCESS)
+        {
+            out.buffer = VK_NULL_HANDLE;
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto memory_exp = dev.allocator().allocate_for_buffer(out.buffer, {});
+        latencies.push_back(microseconds(std::chrono::steady_clock::now() - start));
+
+        if (!memory_exp.has_value())
+        {
+            std::fprintf(stderr, "  %s\n", memory_exp.unwrap_error().c_str());
+            vkDestroyBuffer(dev.get(), out.buffer, nullptr);
+            out.buffer = VK_NULL_HANDLE;
+            return false;
+        }
+
+        out.memory = memory_exp.unwrap();
+        return true;
+    }
+
+    void destroy_buffer(device& dev, test_buffer& buffer)
+    {
+        dev.allocator().free(buffer.memory);
+        vkDestroyBuffer(dev.get(), buffer.buffer, nullptr);
+        buffer = {};
+    }
+
+    void destroy_all(device& dev, std::vector<test_buffer>& buffers)
+    {
+        for (test_buffer& buffer : buffers)
+        {
+            if (buffer.buffer != VK_NULL_HANDLE)
+            {
+                destroy_buffer(dev, buffer);
+            }
+        }
+    }
+}
+
+int main()
+{
+    auto context = rhi::tests::create_headless_device();
+    if (!context)
+    {
+        return rhi::tests::skip_return_code;
+    }
+
+    device& dev = context->device;
+    const totals baseline = sum(dev.allocator().get_statistics());
+
+    std::vector<test_buffer> buffers(buffer_count);
+    std::vector<VkDeviceSize> sizes(buffer_count);
+    std::vector<double> latencies {};
+    latencies.reserve(buffer_count * 2);
+
+    // Fill: every request is sub-allocated, so the allocation count grows by one per buffer while vkAllocateMemory
+    // is only hit once per block
+    uint32_t seed { 1 };
+    bool created { true };
+    for (uint32_t i = 0; i < buffer_count && created; ++i)
+    {
+        sizes[i] = next_size(seed);
+        created = create_buffer(dev, sizes[i], buffers[i], latencies);
+    }
+    expect(created, "every buffer gets memory");
+    if (!created)
+    {
+        destroy_all(dev, buffers);
+        context->instance.destroy();
+        return EXIT_FAILURE;
+    }
+
+    VkDeviceSize live_bytes { 0 };
+    for (const test_buffer& buffer : buffers)
+    {
+        live_bytes += buffer.memory.size;
+    }
+
+    const totals filled = sum(dev.allocator().get_statistics());
+    std::printf("fill: %u allocations, p50 %.2f us, p99 %.2f us, max %.2f us, %u new VkDeviceMemory, %llu KiB live in %llu KiB of blocks\n",
+        buffer_count, percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 1.0),
+        filled.device_memory_count - baseline.device_memory_count,
+        static_cast<unsigned long long>(live_bytes / 1024), static_cast<unsigned long long>((filled.block_bytes - baseline.block_bytes) / 1024));
+
+    expect(filled.allocation_count - baseline.allocation_count == buffer_count, "allocation count tracks every buffer");
+    expect(filled.allocation_bytes - baseline.allocation_bytes == live_bytes, "allocation bytes track every buffer");
+    expect(filled.device_memory_count - baseline.device_memory_count < buffer_count / 16, "buffers share VkDeviceMemory blocks");
+    expect(filled.block_bytes - baseline.block_bytes >= live_bytes, "blocks hold every live byte");
+    expect(percentile(latencies, 0.5) < 1000.0, "a typical sub-allocation takes well under a millisecond");
+
+    // Punch holes: freeing every other buffer leaves the free space split into many ranges
+    for (uint32_t i = 0; i < buffer_count; i += 2)
+    {
+        destroy_buffer(dev, buffers[i]);
+    }
+
+    const totals holed = sum(dev.allocator().get_statistics());
+    std::printf("holes: fragmentation %.3f, %llu KiB free in blocks\n", holed.fragmentation,
+        static_cast<unsigned long long>(dev.allocator().get_statistics().free_block_bytes / 1024));
+    expect(holed.fragmentation > filled.fragmentation, "freeing every other buffer fragments the blocks");
+    expect(holed.allocation_count - baseline.allocation_count == buffer_count / 2, "freed buffers leave the allocation count");
+
+    // Refill the holes with the same sizes. They fit exactly, so no block is added and the fragmentation drops back
+    latencies.clear();
+    for (uint32_t i = 0; i < buffer_count && created; i += 2)
+    {
+        created = create_buffer(dev, sizes[i], buffers[i], latencies);
+    }
+    expect(created, "every hole is refilled");
+
+    const totals refilled = sum(dev.allocator().get_statistics());
+    std::printf("refill: p50 %.2f us, p99 %.2f us, fragmentation %.3f, %u VkDeviceMemory\n",
+        percentile(latencies, 0.5), percentile(latencies, 0.99), refilled.fragmentation, refilled.device_memory_count);
+    expect(refilled.device_memory_count <= filled.device_memory_count, "the holes are reused instead of new blocks");
+    expect(refilled.fragmentation < holed.fragmentation, "refilling the holes undoes the fragmentation");
+
+    destroy_all(dev, buffers);
+
+    const totals drained = sum(dev.allocator().get_statistics());
+    std::printf("peak: %llu KiB allocated, %llu KiB live at the end\n",
+        static_cast<unsigned long long>(drained.peak_allocation_bytes / 1024), static_cast<unsigned long long>(drained.allocation_bytes / 1024));
+    expect(drained.allocation_bytes == baseline.allocation_bytes && drained.allocation_count == baseline.allocation_count, "everything is returned");
+    expect(drained.peak_allocation_bytes >= baseline.allocation_bytes + live_bytes, "the peak covers the full set of buffers");
+
+    context->instance.destroy();
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
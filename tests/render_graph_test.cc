@@ -0,0 +1,220 @@
+#include "vk/render_graph.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "headless_device.h"
+
+using namespace rhi::vk;
+
+namespace
+{
+    int failures { 0 };
+
+    void expect(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    constexpr VkExtent2D extent { 64, 64 };
+    constexpr VkDeviceSize image_bytes { extent.width * extent.height * 4 };
+    constexpr VkImageSubresourceRange color_range { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    constexpr VkImageSubresourceLayers color_layers { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+
+    void clear(const VkCommandBuffer command_buffer, const VkImage image, const float red, const float green)
+    {
+        const VkClearColorValue color { .float32 = { red, green, 0.0f, 1.0f } };
+        vkCmdClearColorImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &color_range);
+    }
+
+    void copy_to_buffer(const VkCommandBuffer command_buffer, const VkImage image, const VkBuffer buffer, const VkDeviceSize offset)
+    {
+        const VkBufferImageCopy region {
+            .bufferOffset = offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = color_layers,
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = { extent.width, extent.height, 1 },
+        };
+        vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+    }
+
+    /// Every texel of the range holds the same RGBA8 value
+    [[nodiscard]] bool filled_with(const uint8_t* texels, const uint8_t red, const uint8_t green)
+    {
+        for (VkDeviceSize i = 0; i < image_bytes; i += 4)
+        {
+            if (texels[i] != red || texels[i + 1] != green || texels[i + 2] != 0 || texels[i + 3] != 255)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+    auto context = rhi::tests::create_headless_device();
+    if (!context)
+    {
+        return rhi::tests::skip_return_code;
+    }
+
+    device& dev = context->device;
+
+    // Host visible target the last pass copies both images into
+    const VkBufferCreateInfo buffer_info {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .size = image_bytes * 2,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+    };
+
+    VkBuffer readback { VK_NULL_HANDLE };
+    expect(vkCreateBuffer(dev.get(), &buffer_info, nullptr, &readback) == VK_SUCCESS, "readback buffer is created");
+    auto memory_exp = dev.allocator().allocate_for_buffer(readback, { .usage = memory_usage::GPU_TO_CPU });
+    expect(memory_exp.has_value() && memory_exp.unwrap().mapped_data != nullptr, "readback buffer gets mapped memory");
+    if (failures > 0)
+    {
+        context->instance.destroy();
+        return EXIT_FAILURE;
+    }
+    memory_allocation memory = memory_exp.unwrap();
+
+    render_graph graph { dev };
+    const image_handle albedo = graph.create_image({ .name = "albedo", .format = VK_FORMAT_R8G8B8A8_UNORM, .extent = extent });
+    const image_handle unused = graph.create_image({ .name = "unused", .format = VK_FORMAT_R8G8B8A8_UNORM, .extent = extent });
+    const image_handle lit = graph.create_image({ .name = "lit", .format = VK_FORMAT_R8G8B8A8_UNORM, .extent = extent });
+    const image_handle bloom = graph.create_image({ .name = "bloom", .format = VK_FORMAT_R8G8B8A8_UNORM, .extent = extent });
+    const buffer_handle output = graph.import_buffer({ .name = "readback", .buffer = readback });
+
+    uint32_t executed { 0 };
+    bool culled_ran { false };
+
+    graph.add_pass("albedo", [&](pass_builder& builder)
+    {
+        builder.write(albedo, resource_usage::TRANSFER_DST);
+    }, [&](const VkCommandBuffer command_buffer, const render_graph& g)
+    {
+        clear(command_buffer, g.image(albedo), 1.0f, 0.0f);
+        executed++;
+    });
+
+    // Nothing reads this image, so the pass has to be culled and the image never created
+    graph.add_pass("unused", [&](pass_builder& builder)
+    {
+        builder.write(unused, resource_usage::TRANSFER_DST);
+    }, [&](const VkCommandBuffer, const render_graph&)
+    {
+        culled_ran = true;
+    });
+
+    graph.add_pass("lighting", [&](pass_builder& builder)
+    {
+        builder.read(albedo, resource_usage::TRANSFER_SRC).write(lit, resource_usage::TRANSFER_DST);
+    }, [&](const VkCommandBuffer command_buffer, const render_graph& g)
+    {
+        const VkImageCopy region {
+            .srcSubresource = color_layers,
+            .srcOffset = { 0, 0, 0 },
+            .dstSubresource = color_layers,
+            .dstOffset = { 0, 0, 0 },
+            .extent = { extent.width, extent.height, 1 },
+        };
+        vkCmdCopyImage(command_buffer, g.image(albedo), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, g.image(lit), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        executed++;
+    });
+
+    // Albedo is dead from here on, bloom can take its memory. The clear must not land on lit
+    graph.add_pass("bloom", [&](pass_builder& builder)
+    {
+        builder.write(bloom, resource_usage::TRANSFER_DST);
+    }, [&](const VkCommandBuffer command_buffer, const render_graph& g)
+    {
+        clear(command_buffer, g.image(bloom), 0.0f, 1.0f);
+        executed++;
+    });
+
+    graph.add_pass("readback", [&](pass_builder& builder)
+    {
+        builder.read(lit, resource_usage::TRANSFER_SRC).read(bloom, resource_usage::TRANSFER_SRC).write(output, resource_usage::TRANSFER_DST);
+    }, [&](const VkCommandBuffer command_buffer, const render_graph& g)
+    {
+        copy_to_buffer(command_buffer, g.image(lit), g.buffer(output), 0);
+        copy_to_buffer(command_buffer, g.image(bloom), g.buffer(output), image_bytes);
+        executed++;
+    });
+
+    const auto statistics_exp = graph.compile();
+    expect(statistics_exp.has_value(), "graph compiles");
+    if (statistics_exp.has_value())
+    {
+        const render_graph_statistics& statistics = statistics_exp.unwrap();
+        std::printf("%u passes, %u culled, %u barrier batches, %u image barriers, transient memory %llu of %llu bytes\n",
+            statistics.pass_count, statistics.culled_pass_count, statistics.barrier_batch_count, statistics.image_barrier_count,
+            static_cast<unsigned long long>(statistics.transient_bytes_allocated), static_cast<unsigned long long>(statistics.transient_bytes_requested));
+
+        expect(statistics.pass_count == 4 && statistics.culled_pass_count == 1, "the unused pass is culled");
+        expect(graph.image(unused) == VK_NULL_HANDLE, "the culled pass's image is never created");
+        expect(statistics.barrier_batch_count == 4, "every live pass starts with a barrier batch");
+
+        // albedo: undefined -> dst -> src, lit: undefined -> dst -> src, bloom: undefined -> dst -> src
+        expect(statistics.image_barrier_count >= 6, "every layout change gets a barrier");
+        expect(statistics.transient_bytes_allocated < statistics.transient_bytes_requested, "bloom aliases albedo");
+
+        expect(dev.commands().begin_frame(0) == VK_SUCCESS, "command pools reset");
+        auto command_buffer_exp = dev.commands().begin_primary();
+        expect(command_buffer_exp.has_value(), "primary command buffer begins");
+        if (command_buffer_exp.has_value())
+        {
+            const VkCommandBuffer command_buffer = command_buffer_exp.unwrap();
+            graph.execute(command_buffer);
+            expect(vkEndCommandBuffer(command_buffer) == VK_SUCCESS, "command buffer ends");
+
+            const VkSubmitInfo submit {
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .pNext = nullptr,
+                .waitSemaphoreCount = 0,
+                .pWaitSemaphores = nullptr,
+                .pWaitDstStageMask = nullptr,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &command_buffer,
+                .signalSemaphoreCount = 0,
+                .pSignalSemaphores = nullptr,
+            };
+            expect(dev.graphics_queue().submit(submit) == VK_SUCCESS, "graph is submitted");
+            expect(dev.graphics_queue().wait_idle() == VK_SUCCESS, "graph finishes");
+            expect(dev.allocator().invalidate(memory) == VK_SUCCESS, "readback is visible to the host");
+
+            const auto* texels = static_cast<const uint8_t*>(memory.mapped_data);
+            expect(executed == 4 && !culled_ran, "only the live passes run");
+            expect(filled_with(texels, 255, 0), "lit holds the albedo copy, untouched by the aliased bloom clear");
+            expect(filled_with(texels + image_bytes, 0, 255), "bloom holds its own clear");
+        }
+    }
+
+    graph.reset();
+    dev.allocator().free(memory);
+    vkDestroyBuffer(dev.get(), readback, nullptr);
+    context->instance.destroy();
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include "vk/core/tlsf_allocator.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using rhi::vk::tlsf_allocator;
+
+namespace
+{
+    int failures { 0 };
+
+    void expect(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    /// A request the size of the whole range has to succeed, power of two or not
+    void exact_fit(const uint64_t size, const uint64_t alignment)
+    {
+        tlsf_allocator allocator { size };
+        const auto allocation = allocator.allocate(size, alignment);
+        expect(allocation.has_value(), "exact fit allocates");
+        if (!allocation)
+        {
+            std::fprintf(stderr, "  size %llu, alignment %llu\n", static_cast<unsigned long long>(size), static_cast<unsigned long long>(alignment));
+            return;
+        }
+
+        expect(allocation->offset == 0 && allocation->size == size, "exact fit takes the whole range");
+        expect(allocator.free_size() == 0, "nothing left after an exact fit");
+
+        allocator.free(allocation->node);
+        expect(allocator.free_size() == size && allocator.empty(), "exact fit is released");
+    }
+}
+
+int main()
+{
+    for (const uint64_t size : { 1ull, 17ull, 1000ull, 4097ull, 1ull << 20, (1ull << 20) + 1, 20ull << 20, (20ull << 20) + 4096, (256ull << 20) - 64 })
+    {
+        exact_fit(size, 1);
+        exact_fit(size, 256);
+    }
+
+    // A freed non power of two range is found again at its exact size
+    {
+        tlsf_allocator allocator { 3000 };
+        const auto first = allocator.allocate(1000, 1);
+        const auto second = allocator.allocate(1000, 1);
+        const auto third = allocator.allocate(1000, 1);
+        expect(first && second && third, "three ranges of 1000 fill 3000");
+        expect(!allocator.allocate(1, 1).has_value(), "a full allocator refuses more");
+
+        if (second)
+        {
+            allocator.free(second->node);
+            const auto again = allocator.allocate(1000, 1);
+            expect(again.has_value() && again->offset == second->offset, "the freed hole is reused at its exact size");
+        }
+    }
+
+    // Alignment padding still counts against the range
+    {
+        tlsf_allocator allocator { 1000 };
+        const auto head = allocator.allocate(8, 1);
+        expect(head.has_value(), "small head allocation");
+        expect(!allocator.allocate(992, 256).has_value(), "padding does not fit");
+        expect(allocator.allocate(992, 8).has_value(), "the rest fits when already aligned");
+    }
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "core/binary_log.h"
+
+/// Turns a binary log written by rhi::log::log_initializer::set_binary back into text:
+///     rhi_log_decoder <file>
+/// Every message is printed as "[+seconds] [Tthread] [LEVEL] text" like the text logger, seconds counting from the creation of the file
+
+namespace
+{
+    using namespace rhi::log::binary;
+
+    struct pointer
+    {
+        uint64_t address;
+    };
+
+    using argument = std::variant<int64_t, uint64_t, double, bool, char, std::string_view, pointer>;
+
+    template <typename T>
+    T read(const char* source) noexcept
+    {
+        T value;
+        std::memcpy(&value, source, sizeof(T));
+        return value;
+    }
+
+    /// Arguments stop early when the record is cut short, the missing ones are shown as such
+    std::vector<argument> decode_arguments(const char* next, const char* end, const uint8_t count)
+    {
+        std::vector<argument> arguments {};
+        const auto fits = [&](const size_t size) { return static_cast<size_t>(end - next) >= size; };
+
+        while (arguments.size() < count && fits(1))
+        {
+            const auto type = static_cast<argument_type>(*next++);
+            switch (type)
+            {
+            case argument_type::SIGNED:
+                if (!fits(8)) return arguments;
+                arguments.emplace_back(read<int64_t>(next));
+                next += 8;
+                break;
+            case argument_type::UNSIGNED:
+                if (!fits(8)) return arguments;
+                arguments.emplace_back(read<uint64_t>(next));
+                next += 8;
+                break;
+            case argument_type::FLOATING:
+                if (!fits(8)) return arguments;
+                arguments.emplace_back(read<double>(next));
+                next += 8;
+                break;
+            case argument_type::BOOLEAN:
+                if (!fits(1)) return arguments;
+                arguments.emplace_back(*next != 0);
+                next += 1;
+                break;
+            case argument_type::CHARACTER:
+                if (!fits(1)) return arguments;
+                arguments.emplace_back(*next);
+                next += 1;
+                break;
+            case argument_type::STRING:
+            {
+                if (!fits(4)) return arguments;
+                const auto length = read<uint32_t>(next);
+                next += 4;
+                if (!fits(length)) return arguments;
+                arguments.emplace_back(std::string_view { next, length });
+                next += length;
+                break;
+            }
+            case argument_type::POINTER:
+                if (!fits(8)) return arguments;
+                arguments.emplace_back(pointer { read<uint64_t>(next) });
+                next += 8;
+                break;
+            default:
+                return arguments;
+            }
+        }
+
+        return arguments;
+    }
+
+    std::string format_argument(const argument& value, const std::string_view spec)
+    {
+        const std::string replacement = std::format("{{:{}}}", spec);
+        return std::visit([&](const auto& alternative) -> std::string
+        {
+            using T = std::decay_t<decltype(alternative)>;
+            if constexpr (std::is_same_v<T, pointer>)
+            {
+                const auto* address = reinterpret_cast<const void*>(static_cast<uintptr_t>(alternative.address));
+                return std::vformat(replacement, std::make_format_args(address));
+            }
+            else
+            {
+                return std::vformat(replacement, std::make_format_args(alternative));
+            }
+        }, value);
+    }
+
+    /// Replays std::format's replacement fields: automatic or explicit indices and a format spec after ':'
+    std::string format_message(const std::string_view format, const std::vector<argument>& arguments)
+    {
+        std::string text {};
+        size_t next_index { 0 };
+
+        for (size_t i = 0; i < format.size(); i++)
+        {
+            const char c = format[i];
+            if (c == '}' && i + 1 < format.size() && format[i + 1] == '}')
+            {
+                text += '}';
+                i++;
+                continue;
+            }
+
+            if (c != '{')
+            {
+                text += c;
+                continue;
+            }
+
+            if (i + 1 < format.size() && format[i + 1] == '{')
+            {
+                text += '{';
+                i++;
+                continue;
+            }
+
+            const size_t close = format.find('}', i);
+            if (close == std::string_view::npos)
+            {
+                text += format.substr(i);
+                break;
+            }
+
+            const std::string_view field = format.substr(i + 1, close - i - 1);
+            const size_t colon = field.find(':');
+            const std::string_view index_text = field.substr(0, colon);
+            const std::string_view spec = colon == std::string_view::npos ? std::string_view {} : field.substr(colon + 1);
+
+            size_t index = next_index++;
+            if (!index_text.empty())
+            {
+                index = std::stoul(std::string { index_text });
+            }
+
+            if (index >= arguments.size())
+            {
+                text += "<missing>";
+            }
+            else
+            {
+                try
+                {
+                    text += format_argument(arguments[index], spec);
+                }
+                catch (const std::exception&)
+                {
+                    text += format.substr(i, close - i + 1);
+                }
+            }
+
+            i = close;
+        }
+
+        return text;
+    }
+} // namespace
+
+int main(const int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log>\n";
+        return 1;
+    }
+
+    std::ifstream file { argv[1], std::ios::binary };
+    if (!file)
+    {
+        std::cerr << "Failed to open " << argv[1] << '\n';
+        return 1;
+    }
+
+    const std::vector<char> data { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+    if (data.size() < sizeof(file_header))
+    {
+        std::cerr << argv[1] << " is too small to be a binary log\n";
+        return 1;
+    }
+
+    const auto header = read<file_header>(data.data());
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+    {
+        std::cerr << argv[1] << " is not a version " << FILE_VERSION << " binary log\n";
+        return 1;
+    }
+
+    // The writer cuts the file to its records on close, a log from a crashed process still has its full capacity
+    const size_t end = std::min<uint64_t>({ header.end, header.capacity, data.size() });
+
+    constexpr std::string_view prefixes[] = { "[TRACE] ", "[DEBUG] ", "[INFO]  ", "[WARN]  ", "[ERROR] ", "[FATAL] " };
+    std::unordered_map<uint32_t, std::string_view> formats {};
+    size_t skipped { 0 };
+
+    size_t offset = header.header_size;
+    while (offset + sizeof(record_header) <= end)
+    {
+        const auto record = read<record_header>(data.data() + offset);
+        if (record.size < sizeof(record_header) || offset + record.size > end)
+        {
+            // Reserved but never written, nothing after it can be trusted
+            break;
+        }
+
+        const char* body = data.data() + offset + sizeof(record_header);
+        const char* body_end = data.data() + offset + record.size;
+        offset += record.size;
+
+        if (record.committed == 0)
+        {
+            skipped++;
+            continue;
+        }
+
+        if (record.kind == record_kind::FORMAT && static_cast<size_t>(body_end - body) >= sizeof(format_record))
+        {
+            const auto definition = read<format_record>(body);
+            const size_t length = std::min<size_t>(definition.length, body_end - body - sizeof(format_record));
+            formats[definition.id] = std::string_view { body + sizeof(format_record), length };
+        }
+        else if (record.kind == record_kind::MESSAGE && static_cast<size_t>(body_end - body) >= sizeof(message_record))
+        {
+            const auto message = read<message_record>(body);
+            const auto format = formats.find(message.format_id);
+            const std::string text = format == formats.end()
+                ? std::format("<unknown format {}>", message.format_id)
+                : format_message(format->second, decode_arguments(body + sizeof(message_record), body_end, record.argument_count));
+
+            const std::string_view prefix = record.level < std::size(prefixes) ? prefixes[record.level] : "[?????] ";
+            std::cout << std::format("[+{:.6f}] [T{}] ", static_cast<double>(message.timestamp) / 1e9, message.thread_id) << prefix << text << '\n';
+        }
+    }
+
+    if (skipped > 0)
+    {
+        std::cerr << skipped << " records were not finished when the log was written and were skipped\n";
+    }
+
+    return 0;
+}